@@ -35,6 +35,7 @@ extern "C" {
 
 #include "FixedScalarRecordDeviceSupport.h"
 #include "RecordDirection.h"
+#include "RecordLinkPreResolver.h"
 
 namespace ChimeraTK {
 namespace EPICS {
@@ -59,13 +60,23 @@ public:
    */
   AnalogScalarRecordDeviceSupportTrait(
       RecordType *record, ::DBLINK const &linkField) {
-    auto address = RecordAddress::parse(linkField);
-    auto pvProvider = PVProviderRegistry::getPVProvider(
-      address.getApplicationOrDeviceName());
-    std::type_info const &valueType(
-      address.hasValueType() ? address.getValueType()
-      : pvProvider->getDefaultType(address.getProcessVariableName()));
-    this->noConvert = valueType == typeid(float) || valueType == typeid(double);
+    // If the link has been resolved in advance, we can use the value type from
+    // the resolved link. The resolved link itself is picked up by the
+    // underlying device support.
+    auto resolvedLink = RecordLinkPreResolver::find(record);
+    std::type_info const *valueType;
+    if (resolvedLink) {
+      valueType = &resolvedLink->valueType;
+    } else {
+      auto address = RecordAddress::parse(linkField);
+      auto pvProvider = PVProviderRegistry::getPVProvider(
+        address.getApplicationOrDeviceName());
+      valueType = &RecordDeviceSupportBase::getRecordValueType(
+        address, address.hasValueType() ? address.getValueType()
+        : pvProvider->getDefaultType(address.getProcessVariableName()));
+    }
+    this->noConvert =
+      *valueType == typeid(float) || *valueType == typeid(double);
     if (this->isNoConvert()) {
       this->valDeviceSupport =
         std::make_unique<FixedScalarRecordDeviceSupport<RecordType, Direction, RecordValueFieldName::VAL>>(
@@ -20,6 +20,7 @@
 #ifndef CHIMERATK_EPICS_ARRAY_RECORD_DEVICE_SUPPORT_H
 #define CHIMERATK_EPICS_ARRAY_RECORD_DEVICE_SUPPORT_H
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
@@ -32,16 +33,22 @@
 
 extern "C" {
 #include <callback.h>
+#include <dbAccessDefs.h>
 #include <dbFldTypes.h>
 #include <dbLink.h>
 #include <dbScan.h>
 #include <epicsTypes.h>
 } // extern "C"
 
+#include "NotificationBuffer.h"
+#include "ParallelCopyEngine.h"
+#include "RecordBufferAllocator.h"
 #include "RecordDeviceSupportBase.h"
 #include "RecordDirection.h"
+#include "RecordMutexPool.h"
 #include "RecordValueFieldName.h"
 #include "ensureScanIoRequest.h"
+#include "detail/FixedStrideStrings.h"
 
 namespace ChimeraTK {
 namespace EPICS {
@@ -50,8 +57,7 @@ namespace detail {
 
 /**
  * Helper structure for reading and writing data from and to the record's value
- * buffer. This structure also provides a function for initializing the buffer
- * that stores the record's value.
+ * buffer.
  *
  * This structure is used so that we can implement a different logic for dealing
  * with an array of strings, where we cannot simply copy a block of memory.
@@ -65,15 +71,9 @@ namespace detail {
 template<typename RecordType, typename T>
 struct ArrayRecordBufferHelper {
 
-  inline static void initializeBuffer(RecordType *record) {
-    record->bptr = new T[record->nelm];
-    // Ensure that the buffer is clean.
-    std::memset(record->bptr, 0, sizeof(T) * record->nelm);
-  }
-
   inline static std::vector<T> readValue(RecordType *record) {
     std::vector<T> value(record->nelm);
-    std::memcpy(
+    ParallelCopyEngine::copy(
       value.data(),
       record->bptr,
       record->nelm * sizeof(T));
@@ -81,7 +81,7 @@ struct ArrayRecordBufferHelper {
   }
 
   inline static void writeValue(RecordType *record, std::vector<T> const &value) {
-    std::memcpy(
+    ParallelCopyEngine::copy(
         record->bptr,
         value.data(),
         record->nelm * sizeof(T));
@@ -92,38 +92,27 @@ struct ArrayRecordBufferHelper {
 template<typename RecordType>
 struct ArrayRecordBufferHelper<RecordType, std::string> {
 
-  inline static void initializeBuffer(RecordType *record) {
-    record->bptr = new char[MAX_STRING_SIZE * record->nelm];
-    std::memset(record->bptr, 0, MAX_STRING_SIZE * record->nelm);
-  }
-
   inline static std::vector<std::string> readValue(RecordType *record) {
     std::vector<std::string> value(record->nelm);
     // The EPICS Base code ensure that all strings are null-terminated. The
     // relevant code can be found in dbConvert.c and dbFastLinkConv.c.
     // However, if NORD < NELM, the rest of the array might contain garbage, so
-    // we ensure that any extra elements are empty strings.
-    char *buffer = static_cast<char *>(record->bptr);
-    for (auto i = record->nord; i < record->nelm; ++i) {
-      buffer[i * MAX_STRING_SIZE] = '\0';
-    }
-    for (std::size_t i = 0; i < record->nelm; ++i) {
-      // There is an assignment operator that expects a pointer to a
-      // null-terminated string, so that the following line is perfectly legal.
-      value[i] = buffer + i * MAX_STRING_SIZE;
-    }
+    // we only unpack the first NORD elements. The remaining elements of the
+    // vector stay empty strings, and the record's buffer is not modified.
+    std::size_t numberOfElements = std::min(record->nord, record->nelm);
+    detail::unpackFixedStrideStrings(
+      static_cast<char const *>(record->bptr), MAX_STRING_SIZE,
+      numberOfElements, value);
     return value;
   }
 
   inline static void writeValue(RecordType *record, std::vector<std::string> const &value) {
-    char *buffer = static_cast<char *>(record->bptr);
-    for (std::size_t i = 0; i < record->nelm; ++i) {
-      auto element = buffer + i * MAX_STRING_SIZE;
-      std::strncpy(element, value[i].c_str(), MAX_STRING_SIZE);
-      // We have to ensure that the string is null-terminated, even if it
-      // exceeds the size allowed by EPICS.
-      element[MAX_STRING_SIZE - 1] = '\0';
-    }
+    // The strings are truncated to MAX_STRING_SIZE - 1 characters, so that
+    // each element is null-terminated, even if the string exceeds the size
+    // allowed by EPICS.
+    detail::packFixedStrideStrings(
+      static_cast<char *>(record->bptr), MAX_STRING_SIZE, record->nelm,
+      value);
   }
 
 };
@@ -131,11 +120,6 @@ struct ArrayRecordBufferHelper<RecordType, std::string> {
 template<typename RecordType>
 struct ArrayRecordBufferHelper<RecordType, ChimeraTK::Boolean> {
 
-  inline static void initializeBuffer(RecordType *record) {
-    record->bptr = new char[MAX_STRING_SIZE * record->nelm];
-    std::memset(record->bptr, 0, MAX_STRING_SIZE * record->nelm);
-  }
-
   inline static std::vector<ChimeraTK::Boolean> readValue(RecordType *record) {
     switch (record->ftvl) {
     case DBF_CHAR:
@@ -176,9 +160,12 @@ private:
     std::vector<ChimeraTK::Boolean> value(record->nelm);
     RecordValueType *recordValueArray =
         static_cast<RecordValueType *>(record->bptr);
-    for (std::size_t i = 0; i < record->nelm; ++i) {
-      value[i] = recordValueArray[i];
-    }
+    ParallelCopyEngine::forEachChunk(record->nelm, sizeof(RecordValueType),
+      [&value, recordValueArray](std::size_t begin, std::size_t end){
+        for (std::size_t i = begin; i < end; ++i) {
+          value[i] = recordValueArray[i];
+        }
+      });
     return value;
   }
 
@@ -187,9 +174,12 @@ private:
       RecordType *record, std::vector<ChimeraTK::Boolean> const &value) {
     RecordValueType *recordValueArray =
         static_cast<RecordValueType *>(record->bptr);
-    for (std::size_t i = 0; i < record->nelm; ++i) {
-      recordValueArray[i] = value[i];
-    }
+    ParallelCopyEngine::forEachChunk(record->nelm, sizeof(RecordValueType),
+      [&value, recordValueArray](std::size_t begin, std::size_t end){
+        for (std::size_t i = begin; i < end; ++i) {
+          recordValueArray[i] = value[i];
+        }
+      });
   }
 
 };
@@ -211,7 +201,7 @@ public:
    */
   ArrayRecordDeviceSupportTrait(
       RecordType *record, ::DBLINK const &linkField)
-      : RecordDeviceSupportBase(RecordAddress::parse(linkField)),
+      : RecordDeviceSupportBase(record, linkField),
         record(record) {
     // TODO Allow a mismatch between the type and the FTVL and use a
     // ConvertingPVSupport in this case.
@@ -271,6 +261,14 @@ public:
           << " elements.";
       throw std::invalid_argument(oss.str());
     }
+    // We allocate the memory for the record's value, so that it is aligned and
+    // (if configured) backed by huge pages. The record support routine only
+    // allocates the memory after initializing the device support, but it will
+    // gladly use the memory allocated by us.
+    if (!record->bptr) {
+      record->bptr = RecordBufferAllocator::allocate(
+        static_cast<std::size_t>(record->nelm) * ::dbValueSize(record->ftvl));
+    }
   }
 
 protected:
@@ -344,6 +342,8 @@ public:
         ioIntrModeEnabled(false) {
     // Prepare the data structure needed when enabling I/O Intr mode.
     ::scanIoInit(&this->ioIntrModeScanPvt);
+    this->notificationBuffer = NotificationBuffer<std::shared_ptr<void const>>::create(
+      this->record->name, this->latest, this->queueSize);
   }
 
   /**
@@ -435,6 +435,15 @@ private:
    */
   VersionNumber readVersionNumber;
 
+  /**
+   * Buffer for passing values from the notify callback to processInternal().
+   * This is only allocated when the "latest" or "queue" option has been
+   * specified. Like
+   * notifyValue, the values are actually pointers to const vectors.
+   */
+  std::unique_ptr<NotificationBuffer<std::shared_ptr<void const>>>
+    notificationBuffer;
+
   /**
    * Internal implementation of getInterruptInfo(...). This is a template that
    * is instantiated for each supported element type. The calling method ensures
@@ -451,16 +460,34 @@ private:
           "I/O Intr mode is not supported for this record.");
       }
       // We can safely pass this to the callback because a record device support
-      // is never destroyed once successfully constructed.
+      // is never destroyed once successfully constructed. For the same reason,
+      // the callbacks can use a raw pointer to the PV support.
       pvSupport->notify(
-        [this](
+        [this, pvSupport = pvSupport.get()](
             typename PVSupport<T>::SharedValue const &value,
             VersionNumber const &versionNumber) {
+          if (this->notificationBuffer) {
+            auto &entry = this->notificationBuffer->getBackEntry();
+            entry.exception = std::exception_ptr();
+            entry.value = value;
+            entry.versionNumber = versionNumber;
+            this->notificationBuffer->publish(
+              *pvSupport, this->ioIntrModeScanPvt);
+            return;
+          }
           this->notifyValue = value;
           this->notifyVersionNumber = versionNumber;
           ensureScanIoRequest(this->ioIntrModeScanPvt);
         },
-        [this](std::exception_ptr const &error){
+        [this, pvSupport = pvSupport.get()](std::exception_ptr const &error){
+          if (this->notificationBuffer) {
+            auto &entry = this->notificationBuffer->getBackEntry();
+            entry.exception = error;
+            entry.value.reset();
+            this->notificationBuffer->publish(
+              *pvSupport, this->ioIntrModeScanPvt);
+            return;
+          }
           this->notifyException = error;
           ensureScanIoRequest(this->ioIntrModeScanPvt);
         });
@@ -522,6 +549,10 @@ private:
       }
       detail::ArrayRecordBufferHelper<RecordType, T>::writeValue(
           this->record, *value);
+      // We do not need the value any longer, so we release it. This allows
+      // the PV support to release its copy (see
+      // ControlSystemAdapterPVProvider::setLastValueReleaseThreshold(...)).
+      this->readValue.reset();
       this->record->nord = this->record->nelm;
       this->updateTimeStamp(this->readVersionNumber);
       return;
@@ -529,6 +560,38 @@ private:
 
     // If the ioIntrModeEnabled flag is set, this method is called because our
     // notify callback requested the record to be processed.
+    if (this->ioIntrModeEnabled && this->notificationBuffer) {
+      // The notification buffer takes care of acknowledging the notification,
+      // so we only have to process the next value from the buffer. If there is
+      // no value, it has already been processed when the record was processed
+      // last.
+      this->notificationBuffer->process(*pvSupport, this->ioIntrModeScanPvt,
+        [this](NotificationBuffer<std::shared_ptr<void const>>::Entry &entry) {
+          if (entry.exception) {
+            auto tempException = entry.exception;
+            entry.exception = std::exception_ptr();
+            std::rethrow_exception(tempException);
+          }
+          auto value = std::static_pointer_cast<std::vector<T> const>(
+            entry.value);
+          // We do not keep the value in the buffer, so that the PV support can
+          // release its copy (see
+          // ControlSystemAdapterPVProvider::setLastValueReleaseThreshold(...)).
+          entry.value.reset();
+          if (this->record->nelm != value->size()) {
+            std::ostringstream oss;
+            oss << "Unexpected got a vector of length " << value->size()
+                << " where a vector of length " << this->record->nelm
+                << " was expected.";
+            throw std::runtime_error(oss.str());
+          }
+          detail::ArrayRecordBufferHelper<RecordType, T>::writeValue(
+              this->record, *value);
+          this->record->nord = this->record->nelm;
+          this->updateTimeStamp(entry.versionNumber);
+        });
+      return;
+    }
     if (this->ioIntrModeEnabled) {
       if (this->notifyException) {
         auto tempException = this->notifyException;
@@ -551,6 +614,10 @@ private:
       }
       detail::ArrayRecordBufferHelper<RecordType, T>::writeValue(
           this->record, *value);
+      // We release the value before calling notifyFinished(), so that the PV
+      // support can release its copy when all records are finished.
+      value.reset();
+      this->notifyValue.reset();
       this->record->nord = this->record->nelm;
       this->updateTimeStamp(this->notifyVersionNumber);
       pvSupport->notifyFinished();
@@ -601,6 +668,7 @@ public:
       : detail::ArrayRecordDeviceSupportTrait<RecordType>(record, record->out),
       firstWritePending(false), notifyPending(false), versionNumberValid(false),
       writePending(false) {
+    this->checkOutputRecordOptions();
     this->template callForValueTypeNoVoid<CallInitializeValue>(this);
   }
 
@@ -646,16 +714,10 @@ private:
    */
   bool firstWritePending;
 
-  /**
-   * Mutex that is protecting access to notifyPending, value, versionNumber,
-   * versionNumberValid, and writePending.
-   */
-  std::recursive_mutex mutex;
-
   /**
    * Flag indicating whether a notification has been received that has not been
    * processed yet. This field must only be accessed while holding a lock on the
-   * mutex.
+   * record's mutex from the RecordMutexPool.
    */
   bool notifyPending;
 
@@ -663,7 +725,8 @@ private:
    * Value that was last written to the application or that we received with the
    * last notification. This is actually a pointer to a const vector, but we
    * only know the element type at runtime, so we have to use a pointer to void
-   * here. This field must only be accessed while holding a lock on the mutex.
+   * here. This field must only be accessed while holding a lock on the
+   * record's mutex.
    */
   std::shared_ptr<void const> value;
 
@@ -673,14 +736,14 @@ private:
    * the version received as part of the last notification. We use this in order
    * to decide whether a value received from the device (through a notification)
    * is older or newer than the value that we already have. This field must only
-   * be accessed while holding a lock on the mutex.
+   * be accessed while holding a lock on the record's mutex.
    */
   VersionNumber versionNumber;
 
   /**
    * Flag indicating whether the version number is valid.  If it is not valid,
    * any notification that is received is accepted. This field must only be
-   * accessed while holding a lock on the mutex.
+   * accessed while holding a lock on the record's mutex.
    */
   bool versionNumberValid;
 
@@ -694,10 +757,33 @@ private:
    * Basically, this is the same flag as the PACT field of the record, but the
    * PACT field may be modifed by the record support code while this one is
    * exclusively used by the device support. This field must only be accessed
-   * while holding a lock on the mutex.
+   * while holding a lock on the record's mutex.
    */
   bool writePending;
 
+  /**
+   * Resets the state of the record after starting a write operation failed. If
+   * a notification has been received while trying to start the write
+   * operation, the record is scheduled for processing, so that the
+   * notification is not lost.
+   */
+  void abortWrite() {
+    bool requestProcessing;
+    {
+      std::lock_guard<std::mutex> lock(
+        RecordMutexPool::getMutex(this->record));
+      this->record->pact = false;
+      this->writePending = false;
+      requestProcessing = this->notifyPending;
+    }
+    // callbackRequestProcessCallback acquires the lock of the callback queue,
+    // so we must not call it while holding the record's mutex.
+    if (requestProcessing) {
+      ::callbackRequestProcessCallback(
+        &this->processCallback, priorityMedium, this->record);
+    }
+  }
+
   /**
    * Tries to initialize the record's value with the initial value of the
    * underlying process variable.
@@ -708,39 +794,38 @@ private:
     // always accepted when the the initialization fails.
     this->versionNumberValid = false;
     auto pvSupport = this->template getPVSupport<T>();
-    try {
-      auto valueTimeStampAndVersion = pvSupport->initialValue();
-      auto &value = std::get<0>(valueTimeStampAndVersion);
-      // We already checked the number of elements in the parent constructor, so
-      // if the vector does not have the expected size, something funny is
-      // happening.
-      if (this->record->nelm != value.size()) {
-        std::ostringstream oss;
-        oss << "Unexpected got a vector of length " << value.size()
-            << " where a vector of length " << this->record->nelm
-            << " was expected.";
-        throw std::runtime_error(oss.str());
-      }
-      // When we initialize the value, we also have to allocate the memory. The
-      // record support routine only allocates the memory after initializing the
-      // device support, but it will gladly use the memory allocated by us.
-      if (!this->record->bptr) {
-        detail::ArrayRecordBufferHelper<RecordType, T>::initializeBuffer(
-          this->record);
+    // If the "noinitialread" option has been specified, we leave the record
+    // uninitialized and do not even try to read the initial value.
+    if (!this->noInitialRead) {
+      try {
+        auto valueTimeStampAndVersion = this->template initialValue<T>();
+        auto &value = std::get<0>(valueTimeStampAndVersion);
+        // We already checked the number of elements in the parent constructor,
+        // so if the vector does not have the expected size, something funny is
+        // happening.
+        if (this->record->nelm != value.size()) {
+          std::ostringstream oss;
+          oss << "Unexpected got a vector of length " << value.size()
+              << " where a vector of length " << this->record->nelm
+              << " was expected.";
+          throw std::runtime_error(oss.str());
+        }
+        // The memory for the value has already been allocated by the
+        // constructor.
+        detail::ArrayRecordBufferHelper<RecordType, T>::writeValue(
+            this->record, value);
+        this->value = std::make_shared<std::vector<T>>(std::move(value));
+        this->versionNumber = std::get<1>(valueTimeStampAndVersion);
+        this->versionNumberValid = true;
+        this->updateTimeStamp(this->versionNumber);
+        this->record->nord = this->record->nelm;
+        // Reset the UDF flag because we now have a valid value.
+        this->record->udf = 0;
+        recGblResetAlarms(this->record);
+      } catch (...) {
+        // It might not always be possible to get an initial value, so it is not
+        // an error if this fails.
       }
-      detail::ArrayRecordBufferHelper<RecordType, T>::writeValue(
-          this->record, value);
-      this->value = std::make_shared<std::vector<T>>(std::move(value));
-      this->versionNumber = std::get<1>(valueTimeStampAndVersion);
-      this->versionNumberValid = true;
-      this->updateTimeStamp(this->versionNumber);
-      this->record->nord = this->record->nelm;
-      // Reset the UDF flag because we now have a valid value.
-      this->record->udf = 0;
-      recGblResetAlarms(this->record);
-    } catch (...) {
-      // It might not always be possible to get an initial value, so it is not
-      // an error if this fails.
     }
     // If this record’s PINI field is set to YES, RUN, or RUNNING, we tell the
     // PV support that we are going to call write(). This will keep it from
@@ -770,7 +855,9 @@ private:
           // Unlike for input records we need a mutex here because processing of
           // the record may be triggered externally, so it can happen that the
           // records is processed while we are also in this callback.
-          std::lock_guard<std::recursive_mutex> lock(this->mutex);
+          bool requestProcessing = false;
+          std::unique_lock<std::mutex> lock(
+            RecordMutexPool::getMutex(this->record));
           // We only want to process the record if this update is newer than the
           // last value that we wrote. We consider a value with the same version
           // number as newer because it is coming back from the application,
@@ -790,10 +877,14 @@ private:
             // If another notify operation or a write operation is pending, the
             // record is going to be processed again when it has finished.
             // Otherwise, we schedule the record to be processed.
-            if (this->notifyPending && !oldNotifyPending && !this->writePending) {
-              ::callbackRequestProcessCallback(
-                  &this->processCallback, priorityMedium, this->record);
-            }
+            requestProcessing = !oldNotifyPending && !this->writePending;
+          }
+          lock.unlock();
+          // callbackRequestProcessCallback acquires the lock of the callback
+          // queue, so we must not call it while holding the record's mutex.
+          if (requestProcessing) {
+            ::callbackRequestProcessCallback(
+                &this->processCallback, priorityMedium, this->record);
           }
           // Four output records, we do not need a strict guarantee that we see
           // all values received from the device, so we can tell the PV support
@@ -817,9 +908,11 @@ private:
    */
   template<typename T>
   void processInternal() {
-    // We have to hold a lock on the notify mutex in this function because we
-    // access fields that are also accessed from the notify callback.
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    // We have to hold a lock on the record's mutex in this function because we
+    // access fields that are also accessed from the notify callback. The mutex
+    // may be shared with other records, so we must not hold it while calling
+    // the PV support.
+    std::unique_lock<std::mutex> lock(RecordMutexPool::getMutex(this->record));
     // If the first write has not happened yet, we ensure that it happens now
     // (instead of processing a notification that might have been received).
     if (this->firstWritePending) {
@@ -840,7 +933,9 @@ private:
         // If a notification is pending, we want that notification to be
         // processed after we have signaled the failure of the last write
         // operation to the user.
-        if (notifyPending) {
+        bool requestProcessing = this->notifyPending;
+        lock.unlock();
+        if (requestProcessing) {
           ::callbackRequestProcessCallback(
             &this->processCallback, priorityMedium, this->record);
         }
@@ -867,32 +962,47 @@ private:
     this->value = std::make_shared<std::vector<T>>(
         detail::ArrayRecordBufferHelper<RecordType, T>::readValue(
             this->record));
-    // We can safely pass this to the callback because a record device support
-    // is never destroyed once successfully constructed.
     auto pvSupport = this->template getPVSupport<T>();
     // We generate a new version number for the write operation. This ensures
     // that we will only accept value updates recevied from the application that
     // are newer than the value that we are writing now.
     this->versionNumber = VersionNumber();
     this->updateTimeStamp(this->versionNumber);
-    bool immediate = pvSupport->write(
-      *std::static_pointer_cast<std::vector<T> const>(this->value),
-      this->versionNumber,
-      [this](bool immediate) {
-        if (!immediate) {
-          ::callbackRequestProcessCallback(
-            &this->processCallback, priorityMedium, this->record);
-        }
-      },
-      [this](bool immediate, std::exception_ptr const &error){
-        this->writeException = error;
-        if (!immediate) {
-          ::callbackRequestProcessCallback(
-            &this->processCallback, priorityMedium, this->record);
-        }
-      });
+    // The vector is never modified once it has been stored in the value field,
+    // so we can keep using it after releasing the mutex.
+    auto writeValue = std::static_pointer_cast<std::vector<T> const>(
+      this->value);
+    VersionNumber writeVersionNumber = this->versionNumber;
+    // We mark the write operation as pending before releasing the mutex, so
+    // that a notification that is received while the write operation is in
+    // progress does not trigger processing of the record.
     this->record->pact = true;
     this->writePending = true;
+    lock.unlock();
+    // We can safely pass this to the callback because a record device support
+    // is never destroyed once successfully constructed.
+    bool immediate;
+    try {
+      immediate = pvSupport->write(
+        *writeValue,
+        writeVersionNumber,
+        [this](bool immediate) {
+          if (!immediate) {
+            ::callbackRequestProcessCallback(
+              &this->processCallback, priorityMedium, this->record);
+          }
+        },
+        [this](bool immediate, std::exception_ptr const &error){
+          this->writeException = error;
+          if (!immediate) {
+            ::callbackRequestProcessCallback(
+              &this->processCallback, priorityMedium, this->record);
+          }
+        });
+    } catch (...) {
+      this->abortWrite();
+      throw;
+    }
     if (immediate) {
       this->template processInternal<T>();
     }
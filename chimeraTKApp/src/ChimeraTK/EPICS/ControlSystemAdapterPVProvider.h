@@ -20,13 +20,17 @@
 #ifndef CHIMERATK_EPICS_CONTROL_SYSTEM_ADAPTER_PV_PROVIDER_H
 #define CHIMERATK_EPICS_CONTROL_SYSTEM_ADAPTER_PV_PROVIDER_H
 
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <forward_list>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <string>
 #include <thread>
 #include <typeindex>
 #include <unordered_map>
@@ -34,11 +38,15 @@
 
 #include <ChimeraTK/ControlSystemAdapter/ControlSystemPVManager.h>
 #include <ChimeraTK/ControlSystemAdapter/UnidirectionalProcessArray.h>
+#include <ChimeraTK/ReadAnyGroup.h>
 #include <ChimeraTK/cppext/future_queue.hpp>
 
 #include "ControlSystemAdapterSharedPVSupportFwdDecl.h"
+#include "FlightRecorder.h"
 #include "PVProvider.h"
 #include "PVSupport.h"
+#include "SharedMemoryMirror.h"
+#include "ThreadSettings.h"
 
 namespace ChimeraTK {
 namespace EPICS {
@@ -58,13 +66,49 @@ public:
    */
   using SharedPtr = std::shared_ptr<ControlSystemAdapterPVProvider>;
 
+  /**
+   * Priority with which notifications for a process variable are delivered.
+   * Process variables with a high priority are served by a separate thread.
+   * Process variables with a low priority are switched to coalescing mode when
+   * the notification delivery is overloaded (see setOverloadGovernor(...)).
+   */
+  enum class NotificationPriority {
+
+    /**
+     * Notifications are delivered by a separate thread, so that they never
+     * have to wait for notifications of process variables with a normal or
+     * low priority.
+     */
+    high,
+
+    /**
+     * Notifications are always delivered one after another.
+     */
+    normal,
+
+    /**
+     * When notification delivery is overloaded, a new value that arrives while
+     * the records are still processing the previous value is held back and
+     * only the latest of these values is delivered once the records have
+     * finished.
+     */
+    low
+
+  };
+
   /**
    * Creates a PV provider for the specified PV manager. Only one PV provider
    * must be created for each PV manager and the PV manager must not be used
    * by other code.
+   *
+   * The thread settings are applied to the notification thread and the
+   * high-priority notification thread when they are started.
    */
   ControlSystemAdapterPVProvider(
-      ControlSystemPVManager::SharedPtr const & pvManager);
+      ControlSystemPVManager::SharedPtr const & pvManager,
+      ThreadSettings const &notificationThreadSettings = ThreadSettings(),
+      ThreadSettings const &highPriorityNotificationThreadSettings =
+        ThreadSettings());
 
   /**
    * Destroys this PV provider. The destructor shuts down the notification
@@ -72,6 +116,44 @@ public:
    */
   virtual ~ControlSystemAdapterPVProvider();
 
+  /**
+   * Adds the specified process variable to the shared-memory mirror (see
+   * setSharedMemoryMirror(...)). Each value that is received through a
+   * notification is published in the mirror.
+   *
+   * Throws an exception if the process variable does not exist, does not
+   * support notifications, or is of type string or void, or if this method is
+   * called after finalizeInitialization().
+   */
+  void addSharedMemoryMirrorPV(std::string const &processVariableName);
+
+  // Declared in PVProvider.
+  virtual PVSupportBase::SharedPtr createFlightRecorderPVSupport(
+      std::string const &processVariableName,
+      std::type_info const &elementType) override;
+
+  /**
+   * Writes the contents of all flight recorders to the specified file. Throws
+   * an exception if the file cannot be written. The format of the file is
+   * described in the README.
+   */
+  void dumpFlightRecorders(std::string const &fileName);
+
+  /**
+   * Enables the flight recorder for the specified process variable. The
+   * flight recorder stores the last depth values (and their version numbers)
+   * that have been received through notifications. It can be frozen with
+   * setFlightRecordersFrozen(...) or through a trigger PV (see
+   * setFlightRecorderTrigger(...)), and its contents are provided to records
+   * that use the "flightrecorder" address option.
+   *
+   * Throws an exception if the process variable does not exist or does not
+   * support notifications, if the depth is zero, or if this method is called
+   * after finalizeInitialization().
+   */
+  void enableFlightRecorder(
+      std::string const &processVariableName, std::size_t depth);
+
   // Declared in PVProvider.
   virtual void finalizeInitialization() override;
 
@@ -79,6 +161,161 @@ public:
   virtual std::type_info const &getDefaultType(
       std::string const &processVariableName) override;
 
+  // Declared in PVProvider.
+  virtual MemoryUsage getMemoryUsage() override;
+
+  // Declared in PVProvider.
+  virtual void report(int level) override;
+
+  /**
+   * Freezes (frozen is true) or unfreezes (frozen is false) all flight
+   * recorders of this PV provider. The records using the contents of the
+   * flight recorders are notified when the flight recorders are frozen.
+   */
+  void setFlightRecordersFrozen(bool frozen);
+
+  /**
+   * Makes the specified process variable a trigger for the flight recorders.
+   * When the process variable receives a value that is not zero (or a
+   * non-empty string), all flight recorders of this PV provider are frozen.
+   *
+   * Throws an exception if the process variable does not exist or does not
+   * support notifications, or if this method is called after
+   * finalizeInitialization().
+   */
+  void setFlightRecorderTrigger(std::string const &processVariableName);
+
+  /**
+   * Sets the parameters used when delivering initial notifications.
+   *
+   * When a record registers for notifications, it first receives the current
+   * value of the process variable. During IOC startup, this happens for all
+   * records in I/O Intr mode at once, so these initial notifications are
+   * delivered in batches. The batch size is the max. number of process
+   * variables for which initial notifications are delivered in one batch (zero
+   * means unlimited). The batch interval is the min. time between the start of
+   * two batches.
+   *
+   * These settings apply to all instances of this class.
+   */
+  static void setInitialNotificationBatching(
+      std::size_t batchSize, std::chrono::milliseconds batchInterval);
+
+  /**
+   * Sets the min. size (in bytes) of the values of a process variable for
+   * which the last value is released when it is not needed.
+   *
+   * Normally, the last value that has been read or written is kept, in
+   * addition to the buffer of the underlying ProcessArray and the buffers of
+   * the records. For process variables with very large values, this can use a
+   * lot of memory, so for these process variables, the last value is moved
+   * back into the ProcessArray's buffer once all records have finished
+   * processing it. It is moved out of there again when it is needed. Zero
+   * (the default) disables this feature.
+   *
+   * This setting applies to all instances of this class.
+   */
+  static void setLastValueReleaseThreshold(std::size_t threshold);
+
+  /**
+   * Sets the parameters of the busy-poll mode of the high-priority
+   * notification thread.
+   *
+   * Usually, the notification threads block while waiting for the next
+   * notification, so delivering a notification includes the time needed for
+   * waking the thread up. In busy-poll mode, the high-priority notification
+   * thread instead keeps checking for new notifications without blocking.
+   * After spinCount unsuccessful checks, it starts backing off by sleeping
+   * between checks, starting with one microsecond and doubling the sleep time
+   * up to maxBackoff. If maxBackoff is zero, the thread never sleeps, but only
+   * yields the CPU after spinCount unsuccessful checks.
+   *
+   * Busy polling keeps a CPU core busy all the time, so it should only be used
+   * if the high-priority notification thread has a dedicated core. The mode
+   * is disabled by default.
+   *
+   * These settings only apply to this PV provider. They can be changed while
+   * the high-priority notification thread is running.
+   */
+  void setNotificationBusyPoll(
+      bool enabled, std::size_t spinCount,
+      std::chrono::microseconds maxBackoff);
+
+  /**
+   * Sets the priority with which notifications for the specified process
+   * variable are delivered. Throws an exception if the process variable does
+   * not exist or does not support notifications.
+   *
+   * The high-priority notification thread is started by
+   * finalizeInitialization(), so after that, a process variable cannot be
+   * given the high priority and process variables that have the high
+   * priority cannot be given a different priority.
+   */
+  void setNotificationPriority(
+      std::string const &processVariableName, NotificationPriority priority);
+
+  /**
+   * Sets the parameters of the notification watchdog.
+   *
+   * A record that is notified about a new value has to signal when it has
+   * finished processing the value, and the next value of the same process
+   * variable is only delivered after all records have done so. If a record
+   * never does this (e.g. because of a bug), notifications for this process
+   * variable stop, and the notification thread may even block completely.
+   *
+   * The notification watchdog periodically checks for process variables with
+   * notifications that have been pending for longer than the specified
+   * timeout and prints an error message listing the records that have not
+   * finished processing. The notifications are not released, because such a
+   * record might only be slow and must not be notified again before it has
+   * finished. A timeout of zero (the default) disables the watchdog.
+   *
+   * The watchdog is only scheduled with the timer while it is enabled, and it
+   * only checks process variables that currently have pending notifications.
+   *
+   * These settings only apply to this PV provider.
+   */
+  void setNotificationWatchdog(std::chrono::milliseconds timeout);
+
+  /**
+   * Sets the parameters of the overload governor.
+   *
+   * The notification thread delivers the notifications for all process
+   * variables one after another, and it has to wait for the records of a
+   * process variable to finish processing a value before it can deliver the
+   * next value for that process variable. When the update rate spikes, this
+   * causes the delivery of all notifications to lag behind.
+   *
+   * The overload governor detects this situation: Notification delivery is
+   * considered overloaded when more than backlogThreshold process variables
+   * have notifications that have not been finished by their records or when
+   * a notification has been waiting for more than latencyThreshold. While
+   * notification delivery is overloaded, process variables with a low
+   * priority are switched to coalescing mode, so that only their latest value
+   * is delivered. When the load has stayed below both thresholds for
+   * restoreDelay, all process variables are switched back to regular mode.
+   *
+   * A threshold of zero disables the respective check. If both thresholds are
+   * zero (the default), the overload governor is disabled.
+   *
+   * These settings only apply to this PV provider.
+   */
+  void setOverloadGovernor(
+      std::size_t backlogThreshold, std::chrono::milliseconds latencyThreshold,
+      std::chrono::milliseconds restoreDelay);
+
+  /**
+   * Sets the name of the POSIX shared-memory segment and of the index file
+   * for the shared-memory mirror. The segment is created and the index file
+   * is written by finalizeInitialization() if at least one process variable
+   * has been added with addSharedMemoryMirrorPV(...).
+   *
+   * Throws an exception if this method is called after
+   * finalizeInitialization().
+   */
+  void setSharedMemoryMirror(
+      std::string const &segmentName, std::string const &indexFileName);
+
 protected:
 
   // Declared in PVProvider.
@@ -90,11 +327,56 @@ private:
 
   /**
    * The ControlSystemAdapterSharedPVSupport is a friend so that it can call
-   * wakeUpNotificationThread().
+   * freezeFlightRecorders(...), queueInitialNotifications(...), and
+   * wakeUpNotificationThread() and update the pendingNotificationPVs.
    */
   template <typename T>
   friend class ControlSystemAdapterSharedPVSupport;
 
+  /**
+   * Statistics about the time between receiving a notification and passing it
+   * on to the PV support.
+   */
+  struct DeliveryLatencyStatistics {
+
+    /**
+     * Number of notifications that have been delivered.
+     */
+    std::size_t count;
+
+    /**
+     * Latency of the last notification.
+     */
+    std::chrono::steady_clock::duration last;
+
+    /**
+     * Longest latency of all notifications.
+     */
+    std::chrono::steady_clock::duration max;
+
+    /**
+     * Sum of the latencies of all notifications.
+     */
+    std::chrono::steady_clock::duration total;
+
+    /**
+     * Number of values for which the age has been recorded.
+     */
+    std::size_t valueAgeCount;
+
+    /**
+     * Age of the last value, measured from the time stored in its version
+     * number to the time when it was passed on to the PV support.
+     */
+    std::chrono::system_clock::duration valueAgeLast;
+
+    /**
+     * Sum of the ages of all values.
+     */
+    std::chrono::system_clock::duration valueAgeTotal;
+
+  };
+
   /**
    * Map of member functions used for creating PV supports of different types.
    * This map is initialized by the constructor by calling
@@ -102,15 +384,195 @@ private:
    */
   std::unordered_map<std::type_index, std::shared_ptr<PVSupportBase> (ControlSystemAdapterPVProvider::*)(std::string const &)> createPVSupportFuncs;
 
+  /**
+   * Max. number of process variables for which initial notifications are
+   * delivered in a single batch. Zero means that there is no limit.
+   */
+  static std::atomic<std::size_t> initialNotificationBatchSize;
+
+  /**
+   * Min. time (in milliseconds) between the start of two batches of initial
+   * notifications.
+   */
+  static std::atomic<std::chrono::milliseconds::rep> initialNotificationBatchIntervalMs;
+
+  /**
+   * Min. size (in bytes) of a value for which the last value is released when
+   * it is not needed. Zero means that the last value is never released.
+   */
+  static std::atomic<std::size_t> lastValueReleaseThreshold;
+
+  /**
+   * Number of checks for notifications that did not find a notification in
+   * busy-poll mode.
+   */
+  std::size_t busyPollEmptyCount;
+
+  /**
+   * Number of notifications that have been received in busy-poll mode.
+   */
+  std::size_t busyPollNotificationCount;
+
+  /**
+   * Number of notifications that have been coalesced because the process
+   * variable had a low priority and notification delivery was overloaded.
+   */
+  std::size_t coalescedNotificationCount;
+
+  /**
+   * Number of coalesced values that have been replaced by a newer value before
+   * they could be delivered.
+   */
+  std::size_t coalescedNotificationReplacedCount;
+
+  /**
+   * Shared PV supports that hold a coalesced value which has not been
+   * delivered yet.
+   */
+  std::vector<std::weak_ptr<ControlSystemAdapterSharedPVSupportBase>> coalescedPVSupports;
+
+  /**
+   * Delivery latency statistics for each notification priority. The
+   * NotificationPriority is used as the index into this array.
+   */
+  std::array<DeliveryLatencyStatistics, 3> deliveryLatencies;
+
+  /**
+   * Number of times that the flight recorders have been frozen.
+   */
+  std::size_t flightRecorderFreezeCount;
+
+  /**
+   * Flight recorders that have been enabled by enableFlightRecorder(...).
+   */
+  std::vector<FlightRecorderBase::SharedPtr> flightRecorders;
+
+  /**
+   * Tells whether the flight recorders are frozen.
+   */
+  bool flightRecordersFrozen;
+
+  /**
+   * Name of the trigger PV (or "iocsh") that froze the flight recorders last.
+   */
+  std::string flightRecordersFrozenBy;
+
+  /**
+   * Thread responsible for delivering notifications for process variables
+   * with a high priority. This thread is only started if there is at least
+   * one such process variable.
+   */
+  std::thread highPriorityNotificationThread;
+
+  /**
+   * Settings applied to the high-priority notification thread when it is
+   * started.
+   */
+  ThreadSettings highPriorityNotificationThreadSettings;
+
+  /**
+   * PV used to wake up the high-priority notification thread when it is
+   * waiting for the next notification. This works like the wakeUpPV, but is
+   * only used for shutting that thread down.
+   */
+  ProcessArray<int>::SharedPtr highPriorityWakeUpPV;
+
+  /**
+   * Receiving side of the highPriorityWakeUpPV. This is included in the
+   * read-any group of the high-priority notification thread.
+   */
+  ProcessVariable::SharedPtr highPriorityWakeUpPVReceiver;
+
+  /**
+   * Number of batches of initial notifications that have been delivered.
+   */
+  std::size_t initialNotificationBatchCount;
+
+  /**
+   * Point in time when the first initial notification of the current burst has
+   * been queued. A burst ends when the initialNotificationQueue is empty again.
+   */
+  std::chrono::steady_clock::time_point initialNotificationBurstStart;
+
+  /**
+   * Number of process variables for which initial notifications have been
+   * delivered.
+   */
+  std::size_t initialNotificationCount;
+
+  /**
+   * Shared PV supports that have initial notifications pending, in the order in
+   * which the first initial notification was requested.
+   */
+  std::queue<std::weak_ptr<ControlSystemAdapterSharedPVSupportBase>> initialNotificationQueue;
+
+  /**
+   * Flag indicating whether a task that wakes up the notification thread when
+   * the next batch of initial notifications is due has been scheduled.
+   */
+  bool initialNotificationWakeUpScheduled;
+
+  /**
+   * PV supports that have been created for the process variables that have a
+   * flight recorder, are a flight recorder trigger, or are mirrored to shared
+   * memory. Keeping them ensures that the shared PV supports receive
+   * notifications even if no record uses the process variable.
+   */
+  std::vector<PVSupportBase::SharedPtr> keptPVSupports;
+
+  /**
+   * Duration of the last burst of initial notifications that has completed.
+   */
+  std::chrono::steady_clock::duration lastInitialNotificationBurstDuration;
+
+  /**
+   * Point in time when the last batch of initial notifications was started.
+   */
+  std::chrono::steady_clock::time_point lastInitialNotificationBatchStart;
+
+  /**
+   * Duration of the longest burst of initial notifications that has
+   * completed.
+   */
+  std::chrono::steady_clock::duration longestInitialNotificationBurstDuration;
+
   /**
    * Mutex protecting access to the PVManager and all other shared resources in
    * this object and its associated PV supports.
    */
   std::recursive_mutex mutex;
 
+  /**
+   * Flag indicating whether the high-priority notification thread uses
+   * busy polling instead of blocking while waiting for notifications. The
+   * busy-poll settings are atomic because the high-priority notification
+   * thread reads them without holding a lock on the mutex.
+   */
+  std::atomic<bool> notificationBusyPollEnabled;
+
+  /**
+   * Max. backoff (in microseconds) between two checks for notifications in
+   * busy-poll mode. Zero means that the thread only yields the CPU.
+   */
+  std::atomic<std::chrono::microseconds::rep> notificationBusyPollMaxBackoffUs;
+
+  /**
+   * Number of unsuccessful checks for notifications after which the thread
+   * starts backing off in busy-poll mode.
+   */
+  std::atomic<std::size_t> notificationBusyPollSpinCount;
+
+  /**
+   * Flag indicating whether finalizeInitialization() has started the delivery
+   * of regular notifications. Before that, the notification thread only
+   * delivers initial notifications and runs tasks.
+   */
+  bool notificationDeliveryStarted;
+
   /**
    * Thread responsible for waiting on PV updates and calling the shared PV
-   * supports' doNotify() methods.
+   * supports' doNotify() methods. This thread handles all process variables
+   * that do not have a high priority.
    */
   std::thread notificationThread;
 
@@ -131,6 +593,76 @@ private:
    */
   bool notificationThreadShutdownRequested;
 
+  /**
+   * Flag indicating whether the notification watchdog has been scheduled with
+   * the timer.
+   */
+  bool notificationWatchdogScheduled;
+
+  /**
+   * Time after which the notification watchdog considers a pending
+   * notification stuck. Zero disables the watchdog.
+   */
+  std::chrono::milliseconds notificationWatchdogTimeout;
+
+  /**
+   * Number of times that the notification watchdog has detected stuck
+   * notifications.
+   */
+  std::size_t notificationWatchdogTriggerCount;
+
+  /**
+   * Priorities of the process variables in pvsForNotification. This vector
+   * uses exactly the same indices as pvsForNotification.
+   */
+  std::vector<NotificationPriority> notificationPriorities;
+
+  /**
+   * Tells whether notification delivery is currently considered overloaded.
+   */
+  bool overloaded;
+
+  /**
+   * Number of process variables with pending notifications above which
+   * notification delivery is considered overloaded. Zero disables this check.
+   */
+  std::size_t overloadBacklogThreshold;
+
+  /**
+   * Number of times that the overload mode has been entered.
+   */
+  std::size_t overloadEnteredCount;
+
+  /**
+   * Last point in time when the load was above one of the thresholds.
+   */
+  std::chrono::steady_clock::time_point overloadLastSeen;
+
+  /**
+   * Delivery latency above which notification delivery is considered
+   * overloaded. Zero disables this check.
+   */
+  std::chrono::milliseconds overloadLatencyThreshold;
+
+  /**
+   * Number of times that the overload mode has been left.
+   */
+  std::size_t overloadLeftCount;
+
+  /**
+   * Time for which the load has to stay below the thresholds before the
+   * overload mode is left.
+   */
+  std::chrono::milliseconds overloadRestoreDelay;
+
+  /**
+   * Shared PV supports that have notifications which have not been finished
+   * yet, so that the notification watchdog does not have to look at all PVs.
+   * This map is updated by the shared PV supports.
+   */
+  std::unordered_map<ControlSystemAdapterSharedPVSupportBase *,
+    std::weak_ptr<ControlSystemAdapterSharedPVSupportBase>> pendingNotificationPVs;
+
   /**
    * PV manager used to access the process variables.
    */
@@ -166,6 +698,29 @@ private:
    */
   std::unordered_map<std::string, std::weak_ptr<ControlSystemAdapterSharedPVSupportBase>> sharedPVSupports;
 
+  /**
+   * Shared-memory mirror created by finalizeInitialization(). Null if no
+   * process variables are mirrored or the mirror could not be created.
+   */
+  SharedMemoryMirror::SharedPtr sharedMemoryMirror;
+
+  /**
+   * Name of the index file of the shared-memory mirror.
+   */
+  std::string sharedMemoryMirrorIndexFileName;
+
+  /**
+   * Shared PV supports of the process variables that have been added with
+   * addSharedMemoryMirrorPV(...), in the order of their slots.
+   */
+  std::vector<std::shared_ptr<ControlSystemAdapterSharedPVSupportBase>> sharedMemoryMirrorPVSupports;
+
+  /**
+   * Name of the shared-memory segment of the shared-memory mirror. Empty if
+   * setSharedMemoryMirror(...) has not been called.
+   */
+  std::string sharedMemoryMirrorSegmentName;
+
   /**
    * Tasks that have been submitted to be executed in the notfication thread,
    * but have not been run yet.
@@ -206,6 +761,114 @@ private:
   template<typename T>
   void insertCreatePVSupportFunc();
 
+  /**
+   * Creates the shared-memory mirror for the process variables that have been
+   * added with addSharedMemoryMirrorPV(...) and assigns a slot to each of
+   * them. Does nothing if no process variables have been added. Errors are
+   * reported, but do not prevent the application from being started.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  void createSharedMemoryMirror();
+
+  /**
+   * Waits for notifications for the process variables with the specified
+   * indices (in pvsForNotification) and delivers them. The wake-up PV is
+   * included in the read-any group, so that the thread can be woken up. Only
+   * the main notification thread runs pending tasks, initial notifications,
+   * and coalesced notifications.
+   *
+   * This method is called by the notification threads and only returns when
+   * this PV provider is being destroyed.
+   */
+  void deliverNotifications(
+      std::vector<std::size_t> const &pvIndices,
+      ProcessVariable::SharedPtr const &wakeUpPVReceiver, bool mainThread);
+
+  /**
+   * Freezes all flight recorders and returns the function that notifies the
+   * PV supports using their contents. This function has to be called after
+   * releasing the lock on the mutex. The reason is the name of the trigger PV
+   * or "iocsh" and is shown by report(...). If the flight recorders already
+   * are frozen, an empty function is returned.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  std::function<void()> freezeFlightRecorders(std::string const &reason);
+
+  /**
+   * Creates a PV support for the specified process variable and keeps it in
+   * keptPVSupports. Returns the shared PV support. Throws an exception if the
+   * process variable does not support notifications or if
+   * finalizeInitialization() has already been called.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  std::shared_ptr<ControlSystemAdapterSharedPVSupportBase> getKeptSharedPVSupport(
+      std::string const &processVariableName);
+
+  /**
+   * Returns the indices (in pvsForNotification) of the process variables that
+   * have (highPriority is true) or do not have (highPriority is false) a high
+   * priority. The internal wake-up PV is never included.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  std::vector<std::size_t> getNotificationPVIndices(bool highPriority);
+
+  /**
+   * Tells whether there are initial notifications that may be delivered right
+   * now. This is false if there are no pending initial notifications or if the
+   * next batch is not due yet.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  bool initialNotificationBatchDue();
+
+  /**
+   * Checks for the next notification of the specified read-any group without
+   * blocking until a notification is found, backing off as configured through
+   * setNotificationBusyPoll(...). The number of unsuccessful checks is stored
+   * in emptyPolls. If busy-poll mode is disabled while waiting, this method
+   * falls back to blocking in waitAny().
+   *
+   * This method must only be called by a notification thread without holding
+   * a lock on the mutex.
+   */
+  ReadAnyGroup::Notification pollNotification(
+      ReadAnyGroup &group, std::size_t &emptyPolls);
+
+  /**
+   * Queues initial notifications for the specified shared PV support. The
+   * shared PV support must only be queued once, until its
+   * doInitialNotifications() method has been called.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  void queueInitialNotifications(
+      std::shared_ptr<ControlSystemAdapterSharedPVSupportBase> const &sharedPVSupport);
+
+  /**
+   * Delivers the next batch of initial notifications. The lock is released
+   * while calling the notification callbacks.
+   *
+   * This method must only be called by the notification thread while holding
+   * the specified lock on the mutex.
+   */
+  void runInitialNotificationBatch(
+      std::unique_lock<std::recursive_mutex> &lock);
+
+  /**
+   * Delivers the coalesced values of all shared PV supports that are ready for
+   * the next notification. The lock is released while calling the
+   * notification callbacks.
+   *
+   * This method must only be called by the notification thread while holding
+   * the specified lock on the mutex.
+   */
+  void runCoalescedNotifications(
+      std::unique_lock<std::recursive_mutex> &lock);
+
   /**
    * Runs a task inside the notification thread. This is primarily intended for
    * use by the PV supports so that they can run a task for which they know that
@@ -214,12 +877,70 @@ private:
    */
   void runInNotificationThread(std::function<void()> const &task);
 
+  /**
+   * Implements the notification logic for process variables with a high
+   * priority. This method is called by the high-priority notification thread
+   * created by startNotificationDelivery().
+   */
+  void runHighPriorityNotificationThread();
+
   /**
    * Implements the notification logic. This method is called by the
    * notification thread created by the constructor.
    */
   void runNotificationThread();
 
+  /**
+   * Runs the tasks that have been submitted through
+   * runInNotificationThread(...) and delivers the next batch of initial
+   * notifications if it is due. If it is not due yet, a task that wakes up the
+   * notification thread when it is due is scheduled. The lock is released while
+   * running tasks and calling notification callbacks.
+   *
+   * This method must only be called by the notification thread while holding
+   * the specified lock on the mutex.
+   */
+  void runPendingTasks(std::unique_lock<std::recursive_mutex> &lock);
+
+  /**
+   * Runs the notification watchdog for the shared PV supports that have pending
+   * notifications and schedules the next run with the timer. Returns the error
+   * messages for the stuck notifications that have been found.
+   *
+   * The code calling this method must hold a lock on the mutex. It should
+   * print the returned messages after releasing the lock.
+   */
+  std::vector<std::string> runNotificationWatchdog();
+
+  /**
+   * Schedules the next run of the notification watchdog with the timer. The
+   * delay depends on the configured timeout. Does nothing if the watchdog is
+   * disabled.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  void scheduleNotificationWatchdog();
+
+  /**
+   * Starts the delivery of regular notifications. This creates the read-any
+   * groups according to the priorities of the process variables and starts
+   * the high-priority notification thread if needed.
+   *
+   * The code calling this method must hold a lock on the mutex.
+   */
+  void startNotificationDelivery();
+
+  /**
+   * Checks the current load against the thresholds of the overload governor
+   * and enters or leaves the overload mode if necessary. The latency is the
+   * time that has passed since the notification that is currently being
+   * handled was received.
+   *
+   * This method must only be called by the notification thread while holding
+   * a lock on the mutex.
+   */
+  void updateOverloadState(std::chrono::steady_clock::duration latency);
+
   /**
    * Wakes the notification thread up.
    *
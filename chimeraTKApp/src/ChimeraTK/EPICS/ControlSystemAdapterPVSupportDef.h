@@ -122,6 +122,9 @@ public:
       ReadCallback const &successCallback,
       ErrorCallback const &errorCallback) override;
 
+  // Declared in PVSupport.
+  virtual void setRecordName(char const *recordName) override;
+
   // Declared in PVSupport.
   virtual void willWrite() override;
 
@@ -168,6 +171,12 @@ private:
    */
   NotifyCallback notifyCallback;
 
+  /**
+   * Name of the record using this PV support. This is only used in diagnostic
+   * messages and may be null if the name has not been set.
+   */
+  char const *recordName;
+
   /**
    * Pointer to the shared instance. This pointer is initialized during
    * construction and kept alive as long as this object exists.
@@ -40,7 +40,8 @@ namespace EPICS {
 template<typename T>
 ControlSystemAdapterPVSupport<T>::ControlSystemAdapterPVSupport(
     std::shared_ptr<ControlSystemAdapterSharedPVSupport<T>> shared)
-    : mutex(shared->mutex), notificationPending(false), shared(shared) {
+    : mutex(shared->mutex), notificationPending(false), recordName(nullptr),
+      shared(shared) {
 }
 
 template<typename T>
@@ -150,6 +151,14 @@ bool ControlSystemAdapterPVSupport<T>::read(
   return this->shared->read(successCallback, errorCallback);
 }
 
+template<typename T>
+void ControlSystemAdapterPVSupport<T>::setRecordName(char const *recordName) {
+  // The record name is read by the notification watchdog, so we have to hold
+  // the lock when setting it.
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  this->recordName = recordName;
+}
+
 template<typename T>
 void ControlSystemAdapterPVSupport<T>::willWrite() {
   this->shared->willWrite();
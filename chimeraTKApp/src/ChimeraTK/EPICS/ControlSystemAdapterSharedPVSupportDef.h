@@ -20,16 +20,22 @@
 #ifndef CHIMERATK_EPICS_CONTROL_SYSTEM_ADAPTER_SHARED_PV_SUPPORT_DEF_H
 #define CHIMERATK_EPICS_CONTROL_SYSTEM_ADAPTER_SHARED_PV_SUPPORT_DEF_H
 
+#include <chrono>
 #include <cstdint>
 #include <forward_list>
 #include <memory>
+#include <typeinfo>
+#include <vector>
 
+#include <ChimeraTK/ReadAnyGroup.h>
 #include <ChimeraTK/RegisterPath.h>
 #include <ChimeraTK/ControlSystemAdapter/ProcessArray.h>
 
 #include "ControlSystemAdapterPVProvider.h"
 #include "ControlSystemAdapterPVSupportFwdDecl.h"
+#include "FlightRecorder.h"
 #include "PVSupport.h"
+#include "SharedMemoryMirror.h"
 
 #include "ControlSystemAdapterSharedPVSupportFwdDecl.h"
 
@@ -56,7 +62,8 @@ protected:
   /**
    * Constructor. Sets the index to the specified number.
    */
-  ControlSystemAdapterSharedPVSupportBase(std::size_t index) : index(index) {
+  ControlSystemAdapterSharedPVSupportBase(std::size_t index)
+      : flightRecorderTrigger(false), index(index) {
   }
 
   /**
@@ -66,6 +73,66 @@ protected:
   virtual ~ControlSystemAdapterSharedPVSupportBase() noexcept {
   }
 
+  /**
+   * Checks whether the notifications for this PV have been pending for longer
+   * than the specified timeout. In this case, an error message listing the
+   * records that have not finished processing the notification is stored in
+   * the specified string and true is returned. The caller is responsible for
+   * printing the message after releasing the lock on the mutex.
+   *
+   * The pending notifications are never released, because a record that has
+   * not finished might only be slow, and notifying it again while it is still
+   * processing the previous value would not be safe.
+   *
+   * True is only returned once until all pending notifications have been
+   * finished.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual bool checkNotificationWatchdog(
+      std::chrono::steady_clock::time_point now,
+      std::chrono::steady_clock::duration timeout, std::string &message) = 0;
+
+  /**
+   * Accepts the specified notification and keeps the new value as the
+   * coalesced value instead of notifying the callbacks. The coalesced value is
+   * delivered later by calling doCoalescedNotify(). Returns true if there
+   * already was a coalesced value that has not been delivered yet (and has
+   * now been replaced).
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual bool coalesceNotification(
+      ReadAnyGroup::Notification &notification) = 0;
+
+  /**
+   * Creates a PV support that provides the contents of the flight recorder of
+   * this PV. Throws an exception if no flight recorder has been enabled or if
+   * the element type does not match the element type of the PV.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual PVSupportBase::SharedPtr createFlightRecorderPVSupport(
+      std::type_info const &elementType) = 0;
+
+  /**
+   * Notifies the registered callbacks with the coalesced value. This works
+   * like doNotify(), but uses the value stored by coalesceNotification(...)
+   * instead of reading a new value.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual std::function<void()> doCoalescedNotify() = 0;
+
+  /**
+   * Notifies the callbacks that have been queued by doInitialNotification(...)
+   * with the current value. The returned function has to be called after
+   * releasing the lock on the mutex.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual std::function<void()> doInitialNotifications() = 0;
+
   /**
    * Triggers notification of registered callbacks. This is called by the
    * PVProvider when it determines that a new value might be available for the
@@ -75,6 +142,17 @@ protected:
    */
   virtual std::function<void()> doNotify() = 0;
 
+  /**
+   * Enables the flight recorder for this PV, storing up to depth values.
+   * Returns the existing flight recorder if the flight recorder has already
+   * been enabled with the same depth. Throws an exception if it has been
+   * enabled with a different depth.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual FlightRecorderBase::SharedPtr enableFlightRecorder(
+      std::size_t depth) = 0;
+
   /**
    * Returns the index that is internally assigned to this PV by the PV
    * provider. This is primarily used by the PV provider to quickly find related
@@ -88,6 +166,20 @@ protected:
     return this->index;
   }
 
+  /**
+   * Returns information about the memory used by this shared PV support.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual PVProvider::ProcessVariableMemoryUsage getMemoryUsage() = 0;
+
+  /**
+   * Returns the definition of the slot that holds the values of this PV in a
+   * shared-memory mirror. Throws an exception if the values of this PV cannot
+   * be mirrored because the elements do not have a fixed size.
+   */
+  virtual SharedMemoryMirror::SlotDefinition getSharedMemoryMirrorSlotDefinition() = 0;
+
   /**
    * Calls the underlying ProcessArray’s write() method, but only if willWrite()
    * has not been called.
@@ -97,6 +189,13 @@ protected:
    */
   virtual void initialWriteIfNeeded() = 0;
 
+  /**
+   * Tells whether there is a coalesced value that has not been delivered yet.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual bool hasCoalescedNotification() = 0;
+
   /**
    * Tells whether doNotify() may be called. The PVProvider will only call
    * doNotify() when this method returns true. Otherwise, it will periodically
@@ -106,6 +205,24 @@ protected:
    */
   virtual bool readyForNextNotification() = 0;
 
+  /**
+   * Sets the shared-memory mirror and the index of the slot in which the
+   * values of this PV are published. The current value is published right
+   * away, each value received through a notification is published when it is
+   * received.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  virtual void setSharedMemoryMirrorSlot(
+      SharedMemoryMirror::SharedPtr const &mirror, std::size_t slotIndex) = 0;
+
+  /**
+   * Flag indicating whether a new value of this PV that is not zero freezes
+   * the flight recorders of the PV provider. This flag is set by the PV
+   * provider while holding a lock on the mutex.
+   */
+  bool flightRecorderTrigger;
+
 private:
 
   /**
@@ -261,15 +378,53 @@ public:
 
 protected:
 
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual bool checkNotificationWatchdog(
+      std::chrono::steady_clock::time_point now,
+      std::chrono::steady_clock::duration timeout,
+      std::string &message) override;
+
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual bool coalesceNotification(
+      ReadAnyGroup::Notification &notification) override;
+
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual PVSupportBase::SharedPtr createFlightRecorderPVSupport(
+      std::type_info const &elementType) override;
+
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual std::function<void()> doCoalescedNotify() override;
+
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual std::function<void()> doInitialNotifications() override;
+
   // Declared in ControlSystemAdapterSharedPVSupportBase.
   virtual std::function<void()> doNotify() override;
 
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual FlightRecorderBase::SharedPtr enableFlightRecorder(
+      std::size_t depth) override;
+
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual PVProvider::ProcessVariableMemoryUsage getMemoryUsage() override;
+
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual SharedMemoryMirror::SlotDefinition getSharedMemoryMirrorSlotDefinition() override;
+
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual bool hasCoalescedNotification() override;
+
   // Declared in ControlSystemAdapterSharedPVSupportBase.
   virtual void initialWriteIfNeeded() override;
 
   // Declared in ControlSystemAdapterSharedPVSupportBase.
   virtual bool readyForNextNotification() override;
 
+  // Declared in ControlSystemAdapterSharedPVSupportBase.
+  virtual void setSharedMemoryMirrorSlot(
+      SharedMemoryMirror::SharedPtr const &mirror,
+      std::size_t slotIndex) override;
+
 private:
 
   /**
@@ -279,9 +434,39 @@ private:
    */
   friend class ControlSystemAdapterPVSupport<T>;
 
+  /**
+   * Value that has been stored by coalesceNotification(...), but has not been
+   * delivered by doCoalescedNotify() yet. Null if there is no such value.
+   */
+  std::shared_ptr<Value const> coalescedValue;
+
+  /**
+   * Version number / time stamp belonging to the value stored in
+   * coalescedValue.
+   */
+  VersionNumber coalescedVersionNumber;
+
+  /**
+   * Flight recorder storing the last values received through notifications.
+   * Null if the flight recorder has not been enabled for this PV.
+   */
+  std::shared_ptr<FlightRecorder<T>> flightRecorder;
+
+  /**
+   * Callbacks that have been passed to doInitialNotification(...), but have
+   * not been called yet. The shared PV support is queued with the PV provider
+   * when the first callback is added, so that all callbacks for the same PV
+   * are notified together.
+   */
+  std::vector<NotifyCallback> initialNotificationCallbacks;
+
   /**
    * Last value that his been read or written. This value might have been read by the
    * doNotify() or the read(...) method or written by the write(...) method.
+   *
+   * This pointer is null when the value has been released by
+   * releaseLastValueIfIdle(). In this case, the value is stored in the
+   * ProcessArray's buffer and getLastValue() has to be used in order to get it.
    */
   std::shared_ptr<Value const> lastValue;
 
@@ -316,6 +501,19 @@ private:
    */
   int notificationPendingCount;
 
+  /**
+   * Point in time when notificationPendingCount last changed from zero to a
+   * positive value.
+   */
+  std::chrono::steady_clock::time_point notificationPendingSince;
+
+  /**
+   * Flag indicating whether the notification watchdog has already reported
+   * the pending notifications. This flag is reset when
+   * notificationPendingCount drops back to zero.
+   */
+  bool notificationWatchdogTriggered;
+
   /**
    * Counter for the number of notify callbacks that are currently registered.
    * This counter is updated by the ControlSystemAdapterPVSupport when a notify
@@ -342,6 +540,18 @@ private:
    */
   std::forward_list<std::weak_ptr<ControlSystemAdapterPVSupport<T>>> pvSupports;
 
+  /**
+   * Shared-memory mirror in which the values of this PV are published. Null
+   * if the values are not mirrored.
+   */
+  SharedMemoryMirror::SharedPtr sharedMemoryMirror;
+
+  /**
+   * Slot of the sharedMemoryMirror in which the values of this PV are
+   * published. Null if the values are not mirrored.
+   */
+  SharedMemoryMirror::SlotHeader *sharedMemoryMirrorSlot;
+
   /**
    * Flag indicating whether at least one of the records that uses this PV
    * support is going to call write() during the initialization phase of the
@@ -354,11 +564,52 @@ private:
    * is guaranteed to happen before notifying it with a regular notification.
    * The callback must still take care of calling notifyFinished().
    *
+   * The callback is not called immediately. Instead, it is called by the
+   * notification thread when the PV provider delivers the next batch of initial
+   * notifications.
+   *
    * This method must only be called while holding a lock on the mutex. It is
    * intended for use by the ControlSystemAdapterPVSupport.
    */
   void doInitialNotification(NotifyCallback const &callback);
 
+  /**
+   * Checks whether this PV is a flight recorder trigger and the last value
+   * is not zero. In this case, the flight recorders of the PV provider are
+   * frozen and the function that notifies their PV supports is returned.
+   * Otherwise, an empty function is returned.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  std::function<void()> checkFlightRecorderTrigger();
+
+  /**
+   * Publishes the specified value in the shared-memory mirror. Does nothing if
+   * the values of this PV are not mirrored.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  void publishToSharedMemoryMirror(
+      Value const &value, VersionNumber const &versionNumber);
+
+  /**
+   * Notifies all registered callbacks with the last value. This is the part of
+   * doNotify() and doCoalescedNotify() that is the same for both of them. The
+   * returned function has to be called after releasing the lock on the mutex.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  std::function<void()> notifyCallbacksWithLastValue();
+
+  /**
+   * Returns the last value. If the last value has been released by
+   * releaseLastValueIfIdle(), it is moved back out of the ProcessArray's
+   * buffer.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  std::shared_ptr<Value const> const &getLastValue();
+
   /**
    * Called by each ControlSystemAdapterPVSupport when it has finished the
    * notification process. This is used to decrement the
@@ -367,6 +618,18 @@ private:
    */
   void notifyFinished();
 
+  /**
+   * Releases the last value if it is at least as large as the threshold set
+   * with ControlSystemAdapterPVProvider::setLastValueReleaseThreshold(...), no
+   * notifications are in progress, and no one else holds a reference to it.
+   * Instead of keeping a separate copy, the value is moved back into the
+   * ProcessArray's buffer, which is not used until the next read or write
+   * operation.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  void releaseLastValueIfIdle();
+
 };
 
 } // namespace EPICS
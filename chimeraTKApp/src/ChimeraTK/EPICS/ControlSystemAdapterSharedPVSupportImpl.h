@@ -20,8 +20,13 @@
 #ifndef CHIMERATK_EPICS_CONTROL_SYSTEM_ADAPTER_SHARED_PV_SUPPORT_IMPL_H
 #define CHIMERATK_EPICS_CONTROL_SYSTEM_ADAPTER_SHARED_PV_SUPPORT_IMPL_H
 
+#include <chrono>
 #include <exception>
 #include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
 
 #include "errorPrint.h"
 
@@ -43,7 +48,8 @@ ControlSystemAdapterSharedPVSupport<T>::ControlSystemAdapterSharedPVSupport(
     std::string const &name, std::size_t index)
     : ControlSystemAdapterSharedPVSupportBase(index),
       mutex(pvProvider->mutex), name(name), notificationPendingCount(0),
-      notifyCallbackCount(0), pvProvider(pvProvider), willWriteCalled(false) {
+      notificationWatchdogTriggered(false), notifyCallbackCount(0), pvProvider(pvProvider),
+      sharedMemoryMirrorSlot(nullptr), willWriteCalled(false) {
   {
     std::lock_guard<std::recursive_mutex> lock(this->mutex);
     this->processArray = this->pvProvider->pvManager
@@ -88,7 +94,7 @@ std::size_t ControlSystemAdapterSharedPVSupport<T>::getNumberOfElements() {
 template<typename T>
 std::tuple<typename PVSupport<T>::Value, VersionNumber> ControlSystemAdapterSharedPVSupport<T>::initialValue() {
   std::lock_guard<std::recursive_mutex> lock(this->mutex);
-  return std::make_tuple(*(this->lastValue), this->lastVersionNumber);
+  return std::make_tuple(*(this->getLastValue()), this->lastVersionNumber);
 }
 
 template<typename T>
@@ -127,7 +133,7 @@ bool ControlSystemAdapterSharedPVSupport<T>::read(
           "ProcessArray::readLatest() returned false even so AccessMode::wait_for_new_data is not set.");
       }
     }
-    value = this->lastValue;
+    value = this->getLastValue();
     versionNumber = this->lastVersionNumber;
   } catch (...) {
     if (errorCallback) {
@@ -139,6 +145,13 @@ bool ControlSystemAdapterSharedPVSupport<T>::read(
   if (successCallback) {
     successCallback(true, value, versionNumber);
   }
+  // The callback had to keep a reference to the value if it needed it any
+  // longer, so we can release our reference and possibly the last value.
+  if (ControlSystemAdapterPVProvider::lastValueReleaseThreshold.load()) {
+    value.reset();
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    this->releaseLastValueIfIdle();
+  }
   return true;
 }
 
@@ -186,6 +199,7 @@ bool ControlSystemAdapterSharedPVSupport<T>::write(
     std::swap(*sharedValue, this->processArray->accessChannel(0));
     this->lastValue = sharedValue;
     this->lastVersionNumber = versionNumber;
+    this->releaseLastValueIfIdle();
   } catch (...) {
     if (errorCallback) {
       errorCallback(true, std::current_exception());
@@ -201,6 +215,136 @@ bool ControlSystemAdapterSharedPVSupport<T>::write(
   return true;
 }
 
+template<typename T>
+bool ControlSystemAdapterSharedPVSupport<T>::checkNotificationWatchdog(
+    std::chrono::steady_clock::time_point now,
+    std::chrono::steady_clock::duration timeout, std::string &message) {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  // Initial notifications that have not been delivered yet are pending
+  // because of the batching, not because a record did not finish, so we do
+  // not consider the PV stuck in this case.
+  if (this->notificationPendingCount == 0
+      || this->notificationWatchdogTriggered
+      || !this->initialNotificationCallbacks.empty()
+      || now - this->notificationPendingSince < timeout) {
+    return false;
+  }
+  this->notificationWatchdogTriggered = true;
+  std::string recordNames;
+  for (auto &weakPVSupport : this->pvSupports) {
+    auto pvSupport = weakPVSupport.lock();
+    if (!pvSupport || !pvSupport->notificationPending) {
+      continue;
+    }
+    if (!recordNames.empty()) {
+      recordNames += ", ";
+    }
+    recordNames +=
+      pvSupport->recordName ? pvSupport->recordName : "<unknown record>";
+  }
+  message = "Notifications for process variable " + this->name
+    + " have been pending for "
+    + std::to_string(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          now - this->notificationPendingSince).count())
+    + " ms. Records that have not finished: " + recordNames + ".";
+  return true;
+}
+
+template<typename T>
+bool ControlSystemAdapterSharedPVSupport<T>::coalesceNotification(
+    ReadAnyGroup::Notification &notification) {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  // Accepting the notification overwrites the ProcessArray's buffer, so if the
+  // last value has been released into that buffer, we have to move it out of
+  // there first.
+  this->getLastValue();
+  if (!notification.accept()) {
+    return false;
+  }
+  // The logic here is the same as in doNotify(), except that we keep the value
+  // separately, so that the last value stays the one that has been delivered
+  // to the records.
+  auto newValue = std::make_shared<std::vector<T>>(
+    this->processArray->getNumberOfSamples());
+  std::swap(*newValue, this->processArray->accessChannel(0));
+  bool replaced = static_cast<bool>(this->coalescedValue);
+  this->coalescedValue = newValue;
+  this->coalescedVersionNumber = this->processArray->getVersionNumber();
+  // The flight recorder records every value that is received, even if it is
+  // replaced before it can be delivered.
+  if (this->flightRecorder) {
+    this->flightRecorder->record(*newValue, this->coalescedVersionNumber);
+  }
+  // The same applies to the shared-memory mirror, where readers should see
+  // the newest value as soon as possible.
+  this->publishToSharedMemoryMirror(*newValue, this->coalescedVersionNumber);
+  return replaced;
+}
+
+template<typename T>
+PVSupportBase::SharedPtr ControlSystemAdapterSharedPVSupport<T>::createFlightRecorderPVSupport(
+    std::type_info const &elementType) {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  if (!this->flightRecorder) {
+    throw std::invalid_argument(
+      std::string("The flight recorder has not been enabled for the process variable '")
+        + this->name + "'.");
+  }
+  if (elementType != typeid(T)) {
+    throw std::invalid_argument(
+      std::string("The type '") + elementType.name()
+        + "' is not supported for the process variable '" + this->name
+        + "'.");
+  }
+  return this->flightRecorder->createPVSupport();
+}
+
+template<typename T>
+std::function<void()> ControlSystemAdapterSharedPVSupport<T>::doCoalescedNotify() {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  assert(notificationPendingCount == 0);
+  if (!this->coalescedValue) {
+    return std::function<void()>();
+  }
+  this->lastValue = std::move(this->coalescedValue);
+  this->lastVersionNumber = this->coalescedVersionNumber;
+  auto freezeFunction = this->checkFlightRecorderTrigger();
+  return detail::chainFunctions(
+    this->notifyCallbacksWithLastValue(), std::move(freezeFunction));
+}
+
+template<typename T>
+std::function<void()> ControlSystemAdapterSharedPVSupport<T>::doInitialNotifications() {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  if (this->initialNotificationCallbacks.empty()) {
+    return std::function<void()>();
+  }
+  std::vector<NotifyCallback> callbacks;
+  callbacks.swap(this->initialNotificationCallbacks);
+  auto value = this->getLastValue();
+  auto versionNumber = this->lastVersionNumber;
+  return [value, versionNumber, callbacks = std::move(callbacks)](){
+      for (auto &callback : callbacks) {
+        try {
+          callback(value, versionNumber);
+        } catch (std::exception &e) {
+          errorPrintf(
+            "A notification callback threw an exception. This indicates a bug in the record device support code. The exception message was: %s",
+            e.what());
+        } catch (...) {
+          errorPrintf(
+            "A notification callback threw an exception. This indicates a bug in the record device support code.");
+        }
+      }
+    };
+}
+
 template<typename T>
 std::function<void()> ControlSystemAdapterSharedPVSupport<T>::doNotify() {
   // This method is only called while holding a lock on the mutex, so we do not
@@ -218,8 +362,41 @@ std::function<void()> ControlSystemAdapterSharedPVSupport<T>::doNotify() {
   std::swap(*newValue, this->processArray->accessChannel(0));
   this->lastValue = newValue;
   this->lastVersionNumber = this->processArray->getVersionNumber();
+  if (this->flightRecorder) {
+    this->flightRecorder->record(*newValue, this->lastVersionNumber);
+  }
+  this->publishToSharedMemoryMirror(*newValue, this->lastVersionNumber);
+  // We have to check the trigger before notifying the callbacks, because the
+  // last value might be released when there are no callbacks.
+  auto freezeFunction = this->checkFlightRecorderTrigger();
+  return detail::chainFunctions(
+    this->notifyCallbacksWithLastValue(), std::move(freezeFunction));
+}
+
+template<typename T>
+FlightRecorderBase::SharedPtr ControlSystemAdapterSharedPVSupport<T>::enableFlightRecorder(
+    std::size_t depth) {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  if (this->flightRecorder) {
+    if (this->flightRecorder->getDepth() != depth) {
+      throw std::invalid_argument(
+        std::string("The flight recorder for the process variable '")
+          + this->name + "' has already been enabled with a different depth.");
+    }
+    return this->flightRecorder;
+  }
+  this->flightRecorder = std::make_shared<FlightRecorder<T>>(
+    this->name, depth, this->processArray->getNumberOfSamples());
+  return this->flightRecorder;
+}
+
+template<typename T>
+std::function<void()> ControlSystemAdapterSharedPVSupport<T>::notifyCallbacksWithLastValue() {
+  // The code calling this method already acquires a lock on the shared mutex.
   // If there are no notify callbacks, we are done.
   if (this->notifyCallbackCount == 0) {
+    this->releaseLastValueIfIdle();
     return std::function<void()>();
   }
   // We have to make a copy of the list of PV supports because we want to
@@ -254,6 +431,11 @@ std::function<void()> ControlSystemAdapterSharedPVSupport<T>::doNotify() {
       --this->notificationPendingCount;
     }
   }
+  if (this->notificationPendingCount > 0) {
+    this->pvProvider->pendingNotificationPVs.emplace(
+      this, this->shared_from_this());
+    this->notificationPendingSince = std::chrono::steady_clock::now();
+  }
   auto &value = this->lastValue;
   auto &versionNumber = this->lastVersionNumber;
   return [value, versionNumber, callbacks = std::move(callbacks)](){
@@ -272,6 +454,46 @@ std::function<void()> ControlSystemAdapterSharedPVSupport<T>::doNotify() {
     };
 }
 
+template<typename T>
+PVProvider::ProcessVariableMemoryUsage ControlSystemAdapterSharedPVSupport<T>::getMemoryUsage() {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  PVProvider::ProcessVariableMemoryUsage usage{this->name, 0, 0, 0};
+  if (this->lastValue) {
+    usage.valueBytes = detail::valueMemorySize(*this->lastValue);
+  }
+  if (this->coalescedValue) {
+    usage.valueBytes += detail::valueMemorySize(*this->coalescedValue);
+  }
+  usage.transportBytes =
+    detail::valueMemorySize(this->processArray->accessChannel(0));
+  if (this->notificationPendingCount > 0) {
+    usage.pendingNotifications = this->notificationPendingCount;
+  }
+  return usage;
+}
+
+template<typename T>
+SharedMemoryMirror::SlotDefinition ControlSystemAdapterSharedPVSupport<T>::getSharedMemoryMirrorSlotDefinition() {
+  if (std::is_same<T, std::string>::value
+      || std::is_same<T, ChimeraTK::Void>::value) {
+    throw std::invalid_argument(
+      std::string("The process variable '") + this->name
+        + "' cannot be mirrored to shared memory because its type is "
+        + detail::flightRecorderTypeName<T>() + ".");
+  }
+  return SharedMemoryMirror::SlotDefinition{
+    this->name, detail::flightRecorderTypeName<T>(), sizeof(T),
+    this->processArray->getNumberOfSamples()};
+}
+
+template<typename T>
+bool ControlSystemAdapterSharedPVSupport<T>::hasCoalescedNotification() {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  return static_cast<bool>(this->coalescedValue);
+}
+
 template<typename T>
 void ControlSystemAdapterSharedPVSupport<T>::initialWriteIfNeeded() {
   std::lock_guard<std::recursive_mutex> lock(this->mutex);
@@ -300,18 +522,66 @@ bool ControlSystemAdapterSharedPVSupport<T>::readyForNextNotification() {
   return this->notificationPendingCount == 0;
 }
 
+template<typename T>
+void ControlSystemAdapterSharedPVSupport<T>::setSharedMemoryMirrorSlot(
+    SharedMemoryMirror::SharedPtr const &mirror, std::size_t slotIndex) {
+  // This method is only called while holding a lock on the mutex, so we do not
+  // have to acquire a lock here.
+  this->sharedMemoryMirror = mirror;
+  this->sharedMemoryMirrorSlot = mirror->getSlot(slotIndex);
+  auto &value = this->getLastValue();
+  if (value) {
+    this->publishToSharedMemoryMirror(*value, this->lastVersionNumber);
+  }
+}
+
 template<typename T>
 void ControlSystemAdapterSharedPVSupport<T>::doInitialNotification(
     NotifyCallback const &callback) {
   // The code calling this method already acquires a lock on the shared mutex.
-  std::shared_ptr<Value const> value;
-  VersionNumber versionNumber;
-  value = this->lastValue;
-  versionNumber = this->lastVersionNumber;
+  if (this->notificationPendingCount == 0) {
+    this->pvProvider->pendingNotificationPVs.emplace(
+      this, this->shared_from_this());
+    this->notificationPendingSince = std::chrono::steady_clock::now();
+  }
   ++this->notificationPendingCount;
-  this->pvProvider->runInNotificationThread([callback, value, versionNumber]() {
-        callback(value, versionNumber);
-      });
+  // We only have to queue this PV support with the PV provider when this is
+  // the first callback. Otherwise, it has already been queued and all
+  // callbacks are going to be notified together.
+  bool alreadyQueued = !this->initialNotificationCallbacks.empty();
+  this->initialNotificationCallbacks.push_back(callback);
+  if (!alreadyQueued) {
+    this->pvProvider->queueInitialNotifications(this->shared_from_this());
+  }
+}
+
+template<typename T>
+std::function<void()> ControlSystemAdapterSharedPVSupport<T>::checkFlightRecorderTrigger() {
+  // The code calling this method already acquires a lock on the shared mutex.
+  if (!this->flightRecorderTrigger
+      || !detail::isFlightRecorderTriggerValue(*this->lastValue)) {
+    return std::function<void()>();
+  }
+  return this->pvProvider->freezeFlightRecorders(this->name);
+}
+
+template<typename T>
+void ControlSystemAdapterSharedPVSupport<T>::publishToSharedMemoryMirror(
+    Value const &value, VersionNumber const &versionNumber) {
+  // This method is only called while holding a lock on the mutex, so there is
+  // only one writer for the slot at a time.
+  if (!this->sharedMemoryMirrorSlot) {
+    return;
+  }
+  // The number of elements of a ProcessArray never changes, but we check
+  // anyway, so that we never write beyond the end of the slot.
+  if (value.size() != this->sharedMemoryMirrorSlot->numberOfElements) {
+    return;
+  }
+  SharedMemoryMirror::publish(
+    this->sharedMemoryMirrorSlot, value.data(), value.size() * sizeof(T),
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      versionNumber.getTime().time_since_epoch()).count());
 }
 
 template<typename T>
@@ -322,10 +592,49 @@ void ControlSystemAdapterSharedPVSupport<T>::notifyFinished() {
   // because it might be waiting on this PV support to be ready for the next
   // notification.
   if (notificationPendingCount == 0) {
+    this->pvProvider->pendingNotificationPVs.erase(this);
+    this->notificationWatchdogTriggered = false;
+    this->releaseLastValueIfIdle();
     this->pvProvider->wakeUpNotificationThread();
   }
 }
 
+template<typename T>
+std::shared_ptr<typename ControlSystemAdapterSharedPVSupport<T>::Value const> const &ControlSystemAdapterSharedPVSupport<T>::getLastValue() {
+  // The code calling this method already acquires a lock on the shared mutex.
+  if (!this->lastValue) {
+    // The released value is stored in the ProcessArray's buffer. We move it
+    // out of there in the same way as doNotify() does it.
+    auto value = std::make_shared<std::vector<T>>(
+      this->processArray->getNumberOfSamples());
+    std::swap(*value, this->processArray->accessChannel(0));
+    this->lastValue = value;
+  }
+  return this->lastValue;
+}
+
+template<typename T>
+void ControlSystemAdapterSharedPVSupport<T>::releaseLastValueIfIdle() {
+  // The code calling this method already acquires a lock on the shared mutex.
+  auto threshold =
+    ControlSystemAdapterPVProvider::lastValueReleaseThreshold.load();
+  if (threshold == 0 || !this->lastValue
+      || this->notificationPendingCount != 0
+      || this->lastValue.use_count() != 1
+      || detail::valueMemorySize(*this->lastValue) < threshold) {
+    return;
+  }
+  // The ProcessArray's buffer is not used until the next read or write
+  // operation, and both of these operations replace the last value, so we can
+  // store the value there instead of keeping a separate copy. As we hold the
+  // only reference to the value and it has not been created as a const
+  // object, we may modify it.
+  std::swap(
+    *std::const_pointer_cast<Value>(this->lastValue),
+    this->processArray->accessChannel(0));
+  this->lastValue.reset();
+}
+
 } // namespace EPICS
 } // namespace ChimeraTK
 
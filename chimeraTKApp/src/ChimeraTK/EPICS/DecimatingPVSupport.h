@@ -0,0 +1,311 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_DECIMATING_PV_SUPPORT_H
+#define CHIMERATK_EPICS_DECIMATING_PV_SUPPORT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <ChimeraTK/SupportedUserTypes.h>
+
+#include "PVSupport.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace detail {
+
+/**
+ * Tells whether block averages can be calculated for the specified element
+ * type.
+ */
+template<typename T>
+constexpr bool canAverageElements() {
+  return std::is_arithmetic<T>::value;
+}
+
+/**
+ * Converts the average of a block back to the element type. Integer averages
+ * are rounded to the nearest integer.
+ */
+template<typename T>
+inline typename std::enable_if<std::is_integral<T>::value, T>::type
+    fromAverage(double average) {
+  // We cannot use std::llround because the average of 64-bit unsigned values
+  // may exceed the range of long long. For 64-bit types, the limits are not
+  // exactly representable as a double, so the rounded average may end up just
+  // outside the range of T and we have to clamp it.
+  auto rounded = std::round(average);
+  if (rounded <= static_cast<double>(std::numeric_limits<T>::min())) {
+    return std::numeric_limits<T>::min();
+  }
+  if (rounded >= static_cast<double>(std::numeric_limits<T>::max())) {
+    return std::numeric_limits<T>::max();
+  }
+  return static_cast<T>(rounded);
+}
+
+template<typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value, T>::type
+    fromAverage(double average) {
+  return static_cast<T>(average);
+}
+
+template<typename T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value, T>::type
+    fromAverage(double) {
+  throw std::logic_error("Block averages are not supported for this type.");
+}
+
+/**
+ * Adds the elements in the specified range. For element types that cannot be
+ * averaged, this function only exists so that the code compiles.
+ */
+template<typename T>
+inline typename std::enable_if<std::is_arithmetic<T>::value, double>::type
+    sumElements(T const *first, T const *last) {
+  // For integer types narrower than 64 bits, we accumulate in a 64-bit
+  // integer, so that the loop can be vectorized and does not suffer from
+  // rounding errors. The sum of 64-bit integers could overflow, so for those
+  // we accumulate in a double, like we do for floating-point types.
+  using Accumulator = typename std::conditional<
+    std::is_integral<T>::value && (sizeof(T) < 8),
+    typename std::conditional<std::is_signed<T>::value, std::int64_t,
+      std::uint64_t>::type,
+    double>::type;
+  Accumulator sum = 0;
+  for (; first != last; ++first) {
+    sum += *first;
+  }
+  return static_cast<double>(sum);
+}
+
+template<typename T>
+inline typename std::enable_if<!std::is_arithmetic<T>::value, double>::type
+    sumElements(T const *, T const *) {
+  throw std::logic_error("Block averages are not supported for this type.");
+}
+
+/**
+ * Returns the number of elements of a value with the specified number of
+ * elements after decimation by the specified factor.
+ */
+inline std::size_t decimatedSize(std::size_t size, std::size_t factor) {
+  return (size + factor - 1) / factor;
+}
+
+/**
+ * Decimates the specified value. If average is false, every factor-th
+ * element, starting with the first one, is used. If average is true, each
+ * element of the result is the average of a block of factor elements. If the
+ * number of elements is not a multiple of the factor, the last element is the
+ * average of the remaining elements.
+ */
+template<typename T>
+std::vector<T> decimate(
+    std::vector<T> const &value, std::size_t factor, bool average) {
+  auto size = value.size();
+  std::vector<T> result(decimatedSize(size, factor));
+  auto data = value.data();
+  if (!average) {
+    for (std::size_t i = 0, j = 0; j < size; ++i, j += factor) {
+      result[i] = data[j];
+    }
+    return result;
+  }
+  for (std::size_t i = 0, j = 0; j < size; ++i, j += factor) {
+    auto blockSize = std::min(factor, size - j);
+    result[i] = fromAverage<T>(
+      sumElements(data + j, data + j + blockSize) / blockSize);
+  }
+  return result;
+}
+
+} // namespace detail
+
+/**
+ * PVSupport providing a decimated version of another PVSupport's value.
+ *
+ * The value of this PV support only has every n-th element of the original
+ * value or, if averaging is enabled, the average of each block of n elements.
+ * The decimation is calculated directly from the shared value that is passed
+ * to the notification callback, so only the reduced array is copied into the
+ * record. Writing is not supported.
+ */
+template<typename T>
+class DecimatingPVSupport : public PVSupport<T> {
+
+public:
+
+  /**
+   * Type of the callback function that is called in case of an error.
+   */
+  using ErrorCallback = typename PVSupport<T>::ErrorCallback;
+
+  /**
+   * Type of the callback passed to notify(...).
+   */
+  using NotifyCallback = typename PVSupport<T>::NotifyCallback;
+
+  /**
+   * Type of the error callback passed to notify(...).
+   */
+  using NotifyErrorCallback = typename PVSupport<T>::NotifyErrorCallback;
+
+  /**
+   * Type of the callback passed to read(...).
+   */
+  using ReadCallback = typename PVSupport<T>::ReadCallback;
+
+  /**
+   * Type of a shared value vector.
+   */
+  using SharedValue = typename PVSupport<T>::SharedValue;
+
+  /**
+   * Type of a value vector.
+   */
+  using Value = typename PVSupport<T>::Value;
+
+  /**
+   * Creates a decimating PV support for the specified PV support. Throws an
+   * exception if averaging is requested, but not supported for the value
+   * type.
+   */
+  static std::shared_ptr<DecimatingPVSupport> create(
+      typename PVSupport<T>::SharedPtr originalPVSupport, std::size_t factor,
+      bool average) {
+    if (average && !detail::canAverageElements<T>()) {
+      throw std::invalid_argument(
+        "The avg option can only be used with process variables of a numeric type.");
+    }
+    if (factor == 0) {
+      throw std::invalid_argument("The decimation factor must not be zero.");
+    }
+    return std::make_shared<DecimatingPVSupport>(
+      originalPVSupport, factor, average);
+  }
+
+  /**
+   * Constructor. Use create(...) instead of calling this constructor
+   * directly.
+   */
+  DecimatingPVSupport(
+      typename PVSupport<T>::SharedPtr originalPVSupport, std::size_t factor,
+      bool average)
+      : average(average), factor(factor),
+        originalPVSupport(originalPVSupport) {
+  }
+
+  // Declared in PVSupport.
+  void cancelNotify() override {
+    originalPVSupport->cancelNotify();
+  }
+
+  // Declared in PVSupportBase.
+  bool canNotify() override {
+    return originalPVSupport->canNotify();
+  }
+
+  // Declared in PVSupportBase.
+  bool canRead() override {
+    return originalPVSupport->canRead();
+  }
+
+  // Declared in PVSupportBase.
+  std::size_t getNumberOfElements() override {
+    return detail::decimatedSize(
+      originalPVSupport->getNumberOfElements(), factor);
+  }
+
+  // Declared in PVSupport.
+  std::tuple<Value, VersionNumber> initialValue() override {
+    auto original = originalPVSupport->initialValue();
+    return std::make_tuple(
+      detail::decimate(std::get<0>(original), factor, average),
+      std::get<1>(original));
+  }
+
+  // Declared in PVSupport.
+  void notify(
+      NotifyCallback const &successCallback,
+      NotifyErrorCallback const &errorCallback) override {
+    NotifyCallback wrappedSuccessCallback;
+    if (successCallback) {
+      auto average = this->average;
+      auto factor = this->factor;
+      wrappedSuccessCallback = [successCallback, average, factor](
+            SharedValue const &value, VersionNumber const &versionNumber){
+          successCallback(
+            std::make_shared<Value>(
+              detail::decimate(*value, factor, average)),
+            versionNumber);
+        };
+    }
+    originalPVSupport->notify(wrappedSuccessCallback, errorCallback);
+  }
+
+  // Declared in PVSupport.
+  void notifyFinished() override {
+    originalPVSupport->notifyFinished();
+  }
+
+  // Declared in PVSupport.
+  bool read(
+      ReadCallback const &successCallback,
+      ErrorCallback const &errorCallback) override {
+    ReadCallback wrappedSuccessCallback;
+    if (successCallback) {
+      auto average = this->average;
+      auto factor = this->factor;
+      wrappedSuccessCallback = [successCallback, average, factor](
+            bool immediate, SharedValue const &value,
+            VersionNumber const &versionNumber){
+          successCallback(
+            immediate,
+            std::make_shared<Value>(
+              detail::decimate(*value, factor, average)),
+            versionNumber);
+        };
+    }
+    return originalPVSupport->read(wrappedSuccessCallback, errorCallback);
+  }
+
+private:
+
+  bool const average;
+  std::size_t const factor;
+  typename PVSupport<T>::SharedPtr originalPVSupport;
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_DECIMATING_PV_SUPPORT_H
@@ -20,20 +20,199 @@
 #ifndef CHIMERATK_EPICS_DEVICE_ACCESS_PV_PROVIDER_DEF_H
 #define CHIMERATK_EPICS_DEVICE_ACCESS_PV_PROVIDER_DEF_H
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <type_traits>
 #include <typeindex>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <ChimeraTK/Device.h>
+#include <ChimeraTK/TransferGroup.h>
 
 #include "PVProvider.h"
 #include "PVSupport.h"
 #include "ThreadPoolExecutor.h"
+#include "ThreadSettings.h"
 
 namespace ChimeraTK {
 namespace EPICS {
 
+namespace detail {
+
+/**
+ * Request for the initial value of a register. Such requests are collected by
+ * the DeviceAccessPVProvider, so that the initial values of many registers can
+ * be read with a single TransferGroup.
+ */
+class DeviceAccessInitialValueRequestBase {
+
+public:
+
+  /**
+   * Destructor.
+   */
+  virtual ~DeviceAccessInitialValueRequestBase() noexcept {
+  }
+
+  /**
+   * Adds the PV support's accessor for the register to the specified transfer
+   * group. Returns false (and does not add anything to the transfer group) if
+   * the register is not readable.
+   */
+  virtual bool addToTransferGroup(TransferGroup &transferGroup) = 0;
+
+  /**
+   * Completes the request using the value from the accessor that has been
+   * added to the transfer group. This must only be called after the transfer
+   * group has been read successfully and has been destroyed.
+   */
+  virtual void complete() = 0;
+
+  /**
+   * Completes the request by reading the register individually. This is used
+   * when the register could not be added to the transfer group or reading the
+   * transfer group failed. In the latter case, this must only be called after
+   * the transfer group has been destroyed.
+   */
+  virtual void completeIndividually() = 0;
+
+};
+
+/**
+ * Base interface for DeviceAccessPVSupport that allows the
+ * DeviceAccessPVProvider to query the memory used by a PV support without
+ * knowing its value type.
+ */
+class DeviceAccessPVSupportBase {
+
+public:
+
+  /**
+   * Destructor.
+   */
+  virtual ~DeviceAccessPVSupportBase() noexcept {
+  }
+
+  /**
+   * Returns information about the memory used by this PV support.
+   */
+  virtual PVProvider::ProcessVariableMemoryUsage getMemoryUsage() = 0;
+
+};
+
+/**
+ * Read-through cache for a register. The cache is shared by all PV supports
+ * that access the same register with the same value type and have the cache
+ * enabled. This base class holds everything that does not depend on the value
+ * type, so that the DeviceAccessPVProvider can report the statistics of all
+ * caches.
+ */
+class DeviceAccessReadCacheBase {
+
+public:
+
+  /**
+   * Statistics of a read-through cache.
+   */
+  struct Statistics {
+
+    /**
+     * Number of reads that have been served from the cache.
+     */
+    std::size_t hits;
+
+    /**
+     * Number of reads that had to read the register.
+     */
+    std::size_t misses;
+
+    /**
+     * Number of reads that did not find a fresh value in the cache, but were
+     * served by a read of the register that was already in progress.
+     */
+    std::size_t sharedReads;
+
+  };
+
+  /**
+   * Destructor.
+   */
+  virtual ~DeviceAccessReadCacheBase() noexcept {
+  }
+
+  /**
+   * Returns the statistics of this cache.
+   */
+  Statistics getStatistics() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->statistics;
+  }
+
+  /**
+   * Invalidates the cached value. This is called after the register has been
+   * written. A read that is in progress while the cache is invalidated does not
+   * store its value in the cache, because it might have read the register
+   * before the write.
+   */
+  void invalidate() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->valid = false;
+    ++this->generation;
+  }
+
+protected:
+
+  /**
+   * Generation of the cache. This is incremented each time the cache is
+   * invalidated.
+   */
+  std::uint64_t generation = 0;
+
+  /**
+   * Mutex protecting the state of the cache.
+   */
+  std::mutex mutex;
+
+  /**
+   * Flag indicating whether a read of the register is in progress.
+   */
+  bool readInProgress = false;
+
+  /**
+   * Statistics of this cache.
+   */
+  Statistics statistics{0, 0, 0};
+
+  /**
+   * Time when the read that provided the cached value was started.
+   */
+  std::chrono::steady_clock::time_point timestamp;
+
+  /**
+   * Flag indicating whether the cache holds a value.
+   */
+  bool valid = false;
+
+};
+
+/**
+ * Read-through cache for a register with values of a specific type. This
+ * template is defined in DeviceAccessPVSupport.h.
+ */
+template<typename T>
+class DeviceAccessReadCache;
+
+} // namespace detail
+
 /**
  * PVProvider for devices using Device Access. This class effectively wraps the
  * Device from ChimeraTK Device Access.
@@ -53,10 +232,12 @@ public:
    * Creates a PV provider for the device specified by the alias name.
    *
    * This constructor opens the device and creates the specified number of pool
-   * I/O threads. It throws an exception if the device cannot be opened.
+   * I/O threads, applying the specified settings to each of them. It throws an
+   * exception if the device cannot be opened.
    */
   DeviceAccessPVProvider(
-      std::string const &deviceAliasName, int numberOfIoThreads);
+      std::string const &deviceAliasName, int numberOfIoThreads,
+      ThreadSettings const &ioThreadSettings = ThreadSettings());
 
   /**
    * Destroys this PV provider.
@@ -67,10 +248,19 @@ public:
    */
   virtual ~DeviceAccessPVProvider();
 
+  // Declared in PVProvider.
+  virtual void flushInitialValueRequests() override;
+
   // Declared in PVProvider.
   virtual std::type_info const &getDefaultType(
       std::string const &processVariableName) override;
 
+  // Declared in PVProvider.
+  virtual MemoryUsage getMemoryUsage() override;
+
+  // Declared in PVProvider.
+  virtual void report(int level) override;
+
 protected:
 
   // Declared in PVProvider.
@@ -87,6 +277,33 @@ private:
   template<typename T>
   friend class DeviceAccessPVSupport;
 
+  /**
+   * Information about a register that is stored in the registerIndex.
+   */
+  struct RegisterIndexEntry {
+
+    /**
+     * Default type of the register, as returned by getDefaultType(...).
+     */
+    std::type_info const *defaultType;
+
+    /**
+     * Number of elements of the register.
+     */
+    std::size_t numberOfElements;
+
+    /**
+     * Flag indicating whether the register is readable.
+     */
+    bool readable;
+
+    /**
+     * Flag indicating whether the register is writeable.
+     */
+    bool writeable;
+
+  };
+
   /**
    * Map of member functions used for creating PV supports of different types.
    * This map is initialized by the constructor by calling
@@ -99,11 +316,80 @@ private:
    */
   Device device;
 
+  /**
+   * Initial value requests that have been submitted, but not processed yet.
+   * Access to this vector must be protected by holding a lock on the
+   * initialValueRequestsMutex.
+   */
+  std::vector<std::unique_ptr<detail::DeviceAccessInitialValueRequestBase>> initialValueRequests;
+
+  /**
+   * Mutex protecting the initialValueRequests.
+   */
+  std::mutex initialValueRequestsMutex;
+
   /**
    * Thread pool used for processing all I/O requests.
    */
   ThreadPoolExecutor ioExecutor;
 
+  /**
+   * Number of I/O threads in the ioExecutor.
+   */
+  std::size_t numberOfIoThreads;
+
+  /**
+   * Read-through caches that have been created for PV supports that use the
+   * "maxage" option. The keys of the outer map are the interned, normalized
+   * register names, so that the caches for a register can be found by address
+   * when it is written. The keys of the inner map are the value types. Access
+   * to this map must be protected by holding a lock on the readCachesMutex.
+   */
+  std::unordered_map<std::string const *, std::map<std::type_index, std::shared_ptr<detail::DeviceAccessReadCacheBase>>> readCaches;
+
+  /**
+   * Mutex protecting the readCaches.
+   */
+  std::mutex readCachesMutex;
+
+  /**
+   * Flag indicating whether any read-through caches have been created. If
+   * not, writes do not have to look for caches that need to be invalidated.
+   */
+  std::atomic<bool> readCachesUsed;
+
+  /**
+   * Index of all registers in the device's register catalogue. The index is
+   * built from a snapshot of the register catalogue when it is needed for the
+   * first time, so that the catalogue does not have to be retrieved and
+   * searched for each record. The keys are the interned, normalized register
+   * names, so they can be compared by address.
+   */
+  std::unordered_map<std::string const *, RegisterIndexEntry> registerIndex;
+
+  /**
+   * PV supports that have been created by this PV provider. We only keep weak
+   * references, so that PV supports that are not used any longer are
+   * destroyed. Access to this vector must be protected by holding a lock on
+   * the pvSupportsMutex.
+   */
+  std::vector<std::weak_ptr<detail::DeviceAccessPVSupportBase>> pvSupports;
+
+  /**
+   * Mutex protecting the pvSupports.
+   */
+  std::mutex pvSupportsMutex;
+
+  /**
+   * Flag indicating whether the registerIndex has been built.
+   */
+  bool registerIndexBuilt;
+
+  /**
+   * Mutex protecting the registerIndex and registerIndexBuilt.
+   */
+  std::mutex registerIndexMutex;
+
   /**
    * Indicates whether the PV supports for this provider works synchronously
    * (perform I/O operations in the calling thread).
@@ -127,6 +413,30 @@ private:
   PVSupportBase::SharedPtr createPVSupportInternal(
       std::string const &processVariableName);
 
+  /**
+   * Returns the information about the specified register from the register
+   * index or null if the device's register catalogue does not contain such a
+   * register. The index is built when this method is called for the first
+   * time. The returned pointer stays valid as long as this PV provider exists.
+   */
+  RegisterIndexEntry const *findRegister(std::string const &registerName);
+
+  /**
+   * Returns the read-through cache for the specified register and value type,
+   * creating it if it does not exist yet. The register name must have been
+   * returned by InternedNameTable::internNormalizedRegisterPath(...).
+   */
+  template<typename T>
+  std::shared_ptr<detail::DeviceAccessReadCache<T>> getReadCache(
+    std::string const *internedRegisterName);
+
+  /**
+   * Invalidates the read-through caches for the specified register. This is
+   * called after the register has been written. The register name must have
+   * been returned by InternedNameTable::internNormalizedRegisterPath(...).
+   */
+  void invalidateReadCaches(std::string const *internedRegisterName);
+
   /**
    * Inserts a pointer to the createPVSupportInternal(...) method of the
    * specified type into the createPVSupportFuncs map.
@@ -134,6 +444,15 @@ private:
   template<typename T>
   void insertCreatePVSupportFunc();
 
+  /**
+   * Processes the specified initial value requests. The registers are read
+   * using a single transfer group. If reading the transfer group fails, each
+   * register is read individually, so that a single register that cannot be
+   * read does not affect the other ones.
+   */
+  void processInitialValueRequests(
+      std::vector<std::unique_ptr<detail::DeviceAccessInitialValueRequestBase>> &requests);
+
   /**
    * Tells whether this PV provider works synchronously (I/O tasks are processed
    * in the calling thread) or asynchronously (I/O tasks are processed by a
@@ -152,6 +471,13 @@ private:
   template<typename Function>
   bool submitIoTask(Function &&f);
 
+  /**
+   * Queues a request for the initial value of a register. The request is
+   * processed when flushInitialValueRequests() is called.
+   */
+  void submitInitialValueRequest(
+      std::unique_ptr<detail::DeviceAccessInitialValueRequestBase> &&request);
+
 };
 
 } // namespace EPICS
@@ -29,8 +29,25 @@ namespace EPICS {
 template<typename T>
 PVSupportBase::SharedPtr DeviceAccessPVProvider::createPVSupportInternal(
     std::string const &processVariableName) {
-  return std::make_shared<DeviceAccessPVSupport<T>>(
+  auto pvSupport = std::make_shared<DeviceAccessPVSupport<T>>(
     this->shared_from_this(), processVariableName);
+  std::lock_guard<std::mutex> lock(this->pvSupportsMutex);
+  this->pvSupports.push_back(pvSupport);
+  return pvSupport;
+}
+
+template<typename T>
+std::shared_ptr<detail::DeviceAccessReadCache<T>> DeviceAccessPVProvider::getReadCache(
+    std::string const *internedRegisterName) {
+  std::lock_guard<std::mutex> lock(this->readCachesMutex);
+  auto &readCache =
+    this->readCaches[internedRegisterName][std::type_index(typeid(T))];
+  if (!readCache) {
+    readCache = std::make_shared<detail::DeviceAccessReadCache<T>>();
+    this->readCachesUsed = true;
+  }
+  return std::static_pointer_cast<detail::DeviceAccessReadCache<T>>(
+    readCache);
 }
 
 template<typename T>
@@ -20,11 +20,19 @@
 #ifndef CHIMERATK_EPICS_DEVICE_ACCESS_PV_SUPPORT_H
 #define CHIMERATK_EPICS_DEVICE_ACCESS_PV_SUPPORT_H
 
+#include <chrono>
+#include <cstdint>
 #include <exception>
+#include <future>
 #include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "DeviceAccessPVProviderDef.h"
+#include "InternedNameTable.h"
 #include "PVSupport.h"
 #include "errorPrint.h"
 
@@ -80,6 +88,178 @@ struct DeviceAccessPVSupportHelper<ChimeraTK::Void> {
 
 };
 
+/**
+ * Read-through cache for a register with values of type T.
+ *
+ * A read first calls begin(...). If the cache holds a value that is fresh
+ * enough, this value is returned right away. Otherwise, the read is added to
+ * the list of waiters and, unless another read of the register is already in
+ * progress, the caller has to read the register and pass the result to
+ * complete(...) or fail(). These methods return the waiters, so that the
+ * caller can deliver the result to all of them.
+ */
+template<typename T>
+class DeviceAccessReadCache : public DeviceAccessReadCacheBase {
+
+public:
+
+  /**
+   * Type of the callback function that is called in case of an error.
+   */
+  using ErrorCallback = typename PVSupport<T>::ErrorCallback;
+
+  /**
+   * Type of the callback passed to read(...).
+   */
+  using ReadCallback = typename PVSupport<T>::ReadCallback;
+
+  /**
+   * Type of a shared value vector.
+   */
+  using SharedValue = typename PVSupport<T>::SharedValue;
+
+  /**
+   * Outcome of begin(...).
+   */
+  enum class BeginResult {
+
+    /**
+     * The cache holds a fresh value, which has been returned.
+     */
+    HIT,
+
+    /**
+     * The read has been added to the waiters of a read that is already in
+     * progress.
+     */
+    JOINED,
+
+    /**
+     * The read has been added to the waiters and the caller has to read the
+     * register.
+     */
+    STARTED
+
+  };
+
+  /**
+   * Read that waits for the result of a read of the register.
+   */
+  struct Waiter {
+
+    /**
+     * Callback that is called with the value.
+     */
+    ReadCallback successCallback;
+
+    /**
+     * Callback that is called if the read fails.
+     */
+    ErrorCallback errorCallback;
+
+    /**
+     * Flag that is passed to the callbacks, indicating whether they are called
+     * from within read(...).
+     */
+    bool immediate;
+
+  };
+
+  /**
+   * Starts a read with the specified max. age. If the result is
+   * BeginResult::HIT, the cached value is stored in value and versionNumber.
+   * If the result is BeginResult::STARTED, the generation of the cache is
+   * stored in generation and has to be passed to complete(...).
+   */
+  BeginResult begin(
+      std::chrono::milliseconds maxAge, Waiter &&waiter, SharedValue &value,
+      VersionNumber &versionNumber, std::uint64_t &generation) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->valid
+        && std::chrono::steady_clock::now() - this->timestamp <= maxAge) {
+      ++this->statistics.hits;
+      value = this->value;
+      versionNumber = this->versionNumber;
+      return BeginResult::HIT;
+    }
+    // A read that joins a read that is already in progress cannot be
+    // completed from within read(...).
+    waiter.immediate = waiter.immediate && !this->readInProgress;
+    this->waiters.push_back(std::move(waiter));
+    if (this->readInProgress) {
+      ++this->statistics.sharedReads;
+      return BeginResult::JOINED;
+    }
+    ++this->statistics.misses;
+    this->readInProgress = true;
+    this->readStartTime = std::chrono::steady_clock::now();
+    generation = this->generation;
+    return BeginResult::STARTED;
+  }
+
+  /**
+   * Completes a read of the register. The value is stored in the cache unless
+   * the cache has been invalidated since the read was started. Returns the
+   * waiters that have to be notified.
+   */
+  std::vector<Waiter> complete(
+      std::uint64_t generation, SharedValue const &value,
+      VersionNumber const &versionNumber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (generation == this->generation) {
+      this->timestamp = this->readStartTime;
+      this->valid = true;
+      this->value = value;
+      this->versionNumber = versionNumber;
+    }
+    return this->takeWaiters();
+  }
+
+  /**
+   * Completes a read of the register that failed. Returns the waiters that
+   * have to be notified.
+   */
+  std::vector<Waiter> fail() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->takeWaiters();
+  }
+
+private:
+
+  /**
+   * Time when the read that is in progress was started.
+   */
+  std::chrono::steady_clock::time_point readStartTime;
+
+  /**
+   * Cached value.
+   */
+  SharedValue value;
+
+  /**
+   * Version number of the cached value.
+   */
+  VersionNumber versionNumber{nullptr};
+
+  /**
+   * Reads that wait for the read that is in progress.
+   */
+  std::vector<Waiter> waiters;
+
+  /**
+   * Ends the read that is in progress and returns the waiters.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  std::vector<Waiter> takeWaiters() {
+    std::vector<Waiter> waiters;
+    waiters.swap(this->waiters);
+    this->readInProgress = false;
+    return waiters;
+  }
+
+};
+
 } // namespace detail
 
 /**
@@ -91,6 +271,7 @@ struct DeviceAccessPVSupportHelper<ChimeraTK::Void> {
 template<typename T>
 class DeviceAccessPVSupport :
     public PVSupport<T>,
+    public detail::DeviceAccessPVSupportBase,
     public std::enable_shared_from_this<DeviceAccessPVSupport<T>> {
 
 public:
@@ -136,17 +317,26 @@ public:
   // Declared in PVSupport.
   virtual bool canWrite() override;
 
+  // Declared in DeviceAccessPVSupportBase.
+  virtual PVProvider::ProcessVariableMemoryUsage getMemoryUsage() override;
+
   // Declared in PVSupport.
   virtual std::size_t getNumberOfElements() override;
 
   // Declared in PVSupport.
   virtual std::tuple<Value, VersionNumber> initialValue() override;
 
+  // Declared in PVSupport.
+  virtual std::future<std::tuple<Value, VersionNumber>> initialValueAsync() override;
+
   // Declared in PVSupport.
   virtual bool read(
       ReadCallback const &successCallback,
       ErrorCallback const &errorCallback) override;
 
+  // Declared in PVSupportBase.
+  virtual void setReadCacheMaxAge(std::chrono::milliseconds maxAge) override;
+
   // Declared in PVSupport.
   virtual bool write(Value const &value,
       VersionNumber const &versionNumber,
@@ -161,16 +351,127 @@ public:
 
 private:
 
+  /**
+   * Request for the initial value of the register. The request adds the
+   * accessor of the PV support to the transfer group, so that no second
+   * accessor (and buffer) is needed for each register.
+   *
+   * Device Access does not allow an accessor that has been added to a transfer
+   * group to be read or written on its own, so once the transfer group has been
+   * destroyed, the request replaces the PV support's accessor with a new one.
+   * The old accessor is released before the new one is created. This is safe
+   * because the PV support is not used by anyone else before the request has
+   * been completed.
+   */
+  class InitialValueRequest : public detail::DeviceAccessInitialValueRequestBase {
+
+  public:
+
+    /**
+     * Creates a request for the initial value of the specified PV support.
+     */
+    InitialValueRequest(std::shared_ptr<DeviceAccessPVSupport> pvSupport)
+        : addedToTransferGroup(false), pvSupport(std::move(pvSupport)) {
+    }
+
+    // Declared in DeviceAccessInitialValueRequestBase.
+    bool addToTransferGroup(TransferGroup &transferGroup) override;
+
+    // Declared in DeviceAccessInitialValueRequestBase.
+    void complete() override;
+
+    // Declared in DeviceAccessInitialValueRequestBase.
+    void completeIndividually() override;
+
+    /**
+     * Returns the future that provides the result of this request.
+     */
+    std::future<std::tuple<Value, VersionNumber>> getFuture() {
+      return this->promise.get_future();
+    }
+
+  private:
+
+    bool addedToTransferGroup;
+    std::promise<std::tuple<Value, VersionNumber>> promise;
+    std::shared_ptr<DeviceAccessPVSupport> pvSupport;
+
+    /**
+     * Replaces the PV support's accessor with a new one if the accessor has
+     * been added to a transfer group.
+     */
+    void replaceAccessor();
+
+  };
+
   /**
    * Accessor that is used for accessing the process variable.
    */
   typename detail::DeviceAccessPVSupportHelper<T>::AccessorType accessor;
 
+  /**
+   * Interned, normalized name of the register that is accessed by this PV
+   * support. It is resolved once at construction, so that the read-through
+   * caches can be found by address after each write.
+   */
+  std::string const *internedRegisterName;
+
+  /**
+   * Number of elements of the process variable.
+   */
+  std::size_t numberOfElements;
+
   /**
    * PV provider that created this instance.
    */
   DeviceAccessPVProvider::SharedPtr provider;
 
+  /**
+   * Flag indicating whether the process variable is readable.
+   */
+  bool readable;
+
+  /**
+   * Read-through cache shared with other PV supports for the same register.
+   * This is null unless setReadCacheMaxAge(...) has been called.
+   */
+  std::shared_ptr<detail::DeviceAccessReadCache<T>> readCache;
+
+  /**
+   * Max. age of a cached value that is returned by read(...).
+   */
+  std::chrono::milliseconds readCacheMaxAge;
+
+  /**
+   * Name of the register that is accessed by this PV support.
+   */
+  std::string registerName;
+
+  /**
+   * Flag indicating whether the process variable is writeable.
+   */
+  bool writeable;
+
+  /**
+   * Calls a read callback, catching and logging any exception.
+   */
+  static void callReadCallback(ReadCallback const &callback, bool immediate,
+      SharedValue const &value, VersionNumber const &versionNumber) noexcept;
+
+  /**
+   * Calls a read error callback, catching and logging any exception.
+   */
+  static void callReadErrorCallback(ErrorCallback const &callback,
+      bool immediate, std::exception_ptr const &error) noexcept;
+
+  /**
+   * Implementation of read(...) that is used when the read-through cache is
+   * enabled.
+   */
+  bool readThroughCache(
+      ReadCallback const &successCallback,
+      ErrorCallback const &errorCallback);
+
 };
 
 template<typename T>
@@ -180,7 +481,24 @@ DeviceAccessPVSupport<T>::DeviceAccessPVSupport(
     : accessor(
         detail::DeviceAccessPVSupportHelper<T>::getAccessor(
             provider->device, registerName)),
-      provider(provider) {
+      internedRegisterName(
+        &InternedNameTable::internNormalizedRegisterPath(registerName)),
+      provider(provider), readCacheMaxAge(0), registerName(registerName) {
+  // We take the number of elements and access flags from the PV provider's
+  // register index, which is also used for determining the default type. Only
+  // if the register is not in the index (or we are dealing with a void
+  // register, which always has one element), we ask the accessor.
+  auto registerInfo = provider->findRegister(registerName);
+  if (registerInfo && !std::is_same<T, ChimeraTK::Void>::value) {
+    this->numberOfElements = registerInfo->numberOfElements;
+    this->readable = registerInfo->readable;
+    this->writeable = registerInfo->writeable;
+  } else {
+    this->numberOfElements =
+      detail::DeviceAccessPVSupportHelper<T>::getNElements(this->accessor);
+    this->readable = this->accessor.isReadable();
+    this->writeable = this->accessor.isWriteable();
+  }
 }
 
 template<typename T>
@@ -189,17 +507,31 @@ DeviceAccessPVSupport<T>::~DeviceAccessPVSupport() noexcept {
 
 template<typename T>
 bool DeviceAccessPVSupport<T>::canRead() {
-  return this->accessor.isReadable();
+  return this->readable;
 }
 
 template<typename T>
 bool DeviceAccessPVSupport<T>::canWrite() {
-  return this->accessor.isWriteable();
+  return this->writeable;
+}
+
+template<typename T>
+PVProvider::ProcessVariableMemoryUsage DeviceAccessPVSupport<T>::getMemoryUsage() {
+  // This PV support does not keep any values itself, so the only memory that
+  // we have to account for is the accessor's buffer. We do not ask the
+  // accessor because it might be in use by an I/O thread. For strings, this
+  // does not include the memory allocated by each string.
+  std::size_t transportBytes = 0;
+  if (!std::is_same<T, ChimeraTK::Void>::value) {
+    transportBytes = this->numberOfElements * sizeof(T);
+  }
+  return PVProvider::ProcessVariableMemoryUsage{
+    this->registerName, 0, transportBytes, 0};
 }
 
 template<typename T>
 std::size_t DeviceAccessPVSupport<T>::getNumberOfElements() {
-  return detail::DeviceAccessPVSupportHelper<T>::getNElements(this->accessor);
+  return this->numberOfElements;
 }
 
 template<typename T>
@@ -213,10 +545,25 @@ std::tuple<typename PVSupport<T>::Value, VersionNumber> DeviceAccessPVSupport<T>
       this->accessor.getVersionNumber());
 }
 
+template<typename T>
+std::future<std::tuple<typename PVSupport<T>::Value, VersionNumber>> DeviceAccessPVSupport<T>::initialValueAsync() {
+  // The request is only queued here. The PV provider reads the registers of
+  // all queued requests with a single transfer group when
+  // flushInitialValueRequests() is called.
+  auto request = std::make_unique<InitialValueRequest>(
+    this->shared_from_this());
+  auto future = request->getFuture();
+  this->provider->submitInitialValueRequest(std::move(request));
+  return future;
+}
+
 template<typename T>
 bool DeviceAccessPVSupport<T>::read(
     ReadCallback const &successCallback,
     ErrorCallback const &errorCallback) {
+  if (this->readCache) {
+    return this->readThroughCache(successCallback, errorCallback);
+  }
   // We pass a shared pointer to this instead of the raw this pointer into the
   // lambda expression. If this instance got destroyed before or while the
   // lambda expression was running, the raw pointer would be invalid. This
@@ -294,6 +641,10 @@ bool DeviceAccessPVSupport<T>::write(
       try {
         sharedThis->accessor.write(versionNumber);
       } catch (...) {
+        if (sharedThis->provider->readCachesUsed) {
+          sharedThis->provider->invalidateReadCaches(
+            sharedThis->internedRegisterName);
+        }
         try {
           errorCallback(immediate, std::current_exception());
           return;
@@ -306,6 +657,10 @@ bool DeviceAccessPVSupport<T>::write(
             "A write callback threw an exception. This indicates a bug in the record device support code.");
         }
       }
+      if (sharedThis->provider->readCachesUsed) {
+        sharedThis->provider->invalidateReadCaches(
+          sharedThis->internedRegisterName);
+      }
       try {
         successCallback(immediate);
       } catch (std::exception &e) {
@@ -320,6 +675,155 @@ bool DeviceAccessPVSupport<T>::write(
   return immediate;
 }
 
+template<typename T>
+void DeviceAccessPVSupport<T>::setReadCacheMaxAge(
+    std::chrono::milliseconds maxAge) {
+  this->readCache = this->provider->template getReadCache<T>(
+    this->internedRegisterName);
+  this->readCacheMaxAge = maxAge;
+}
+
+template<typename T>
+void DeviceAccessPVSupport<T>::callReadCallback(
+    ReadCallback const &callback, bool immediate, SharedValue const &value,
+    VersionNumber const &versionNumber) noexcept {
+  try {
+    callback(immediate, value, versionNumber);
+  } catch (std::exception &e) {
+    errorPrintf(
+      "A read callback threw an exception. This indicates a bug in the record device support code. The exception message was: %s",
+      e.what());
+  } catch (...) {
+    errorPrintf(
+      "A read callback threw an exception. This indicates a bug in the record device support code.");
+  }
+}
+
+template<typename T>
+void DeviceAccessPVSupport<T>::callReadErrorCallback(
+    ErrorCallback const &callback, bool immediate,
+    std::exception_ptr const &error) noexcept {
+  try {
+    callback(immediate, error);
+  } catch (std::exception &e) {
+    errorPrintf(
+      "A read callback threw an exception. This indicates a bug in the record device support code. The exception message was: %s",
+      e.what());
+  } catch (...) {
+    errorPrintf(
+      "A read callback threw an exception. This indicates a bug in the record device support code.");
+  }
+}
+
+template<typename T>
+bool DeviceAccessPVSupport<T>::readThroughCache(
+    ReadCallback const &successCallback,
+    ErrorCallback const &errorCallback) {
+  using ReadCache = detail::DeviceAccessReadCache<T>;
+  bool immediate = this->provider->isSynchronous();
+  SharedValue cachedValue;
+  VersionNumber cachedVersionNumber{nullptr};
+  std::uint64_t generation = 0;
+  auto result = this->readCache->begin(
+    this->readCacheMaxAge,
+    typename ReadCache::Waiter{successCallback, errorCallback, immediate},
+    cachedValue, cachedVersionNumber, generation);
+  if (result == ReadCache::BeginResult::HIT) {
+    callReadCallback(successCallback, true, cachedValue, cachedVersionNumber);
+    return true;
+  } else if (result == ReadCache::BeginResult::JOINED) {
+    return false;
+  }
+  // We are the first reader that needs a fresh value, so we read the register
+  // and deliver the value to all readers that have been waiting for it.
+  auto sharedThis = this->shared_from_this();
+  this->provider->submitIoTask([sharedThis, generation](){
+    SharedValue value;
+    VersionNumber versionNumber{nullptr};
+    std::exception_ptr error;
+    try {
+      Value newValue(
+          detail::DeviceAccessPVSupportHelper<T>::getNElements(
+              sharedThis->accessor));
+      sharedThis->accessor.read();
+      detail::DeviceAccessPVSupportHelper<T>::swap(
+          sharedThis->accessor, newValue);
+      value = std::make_shared<Value const>(std::move(newValue));
+      versionNumber = sharedThis->accessor.getVersionNumber();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    if (error) {
+      for (auto &waiter : sharedThis->readCache->fail()) {
+        callReadErrorCallback(waiter.errorCallback, waiter.immediate, error);
+      }
+    } else {
+      auto waiters = sharedThis->readCache->complete(
+        generation, value, versionNumber);
+      for (auto &waiter : waiters) {
+        callReadCallback(
+          waiter.successCallback, waiter.immediate, value, versionNumber);
+      }
+    }
+  });
+  return immediate;
+}
+
+template<typename T>
+bool DeviceAccessPVSupport<T>::InitialValueRequest::addToTransferGroup(
+    TransferGroup &transferGroup) {
+  if (!this->pvSupport->readable) {
+    return false;
+  }
+  // We set the flag before adding the accessor, so that the accessor is
+  // replaced even if adding it fails half-way.
+  this->addedToTransferGroup = true;
+  transferGroup.addAccessor(this->pvSupport->accessor);
+  return true;
+}
+
+template<typename T>
+void DeviceAccessPVSupport<T>::InitialValueRequest::complete() {
+  try {
+    auto &accessor = this->pvSupport->accessor;
+    Value value(
+        detail::DeviceAccessPVSupportHelper<T>::getNElements(accessor));
+    detail::DeviceAccessPVSupportHelper<T>::swap(accessor, value);
+    auto versionNumber = accessor.getVersionNumber();
+    // The future must only become ready after the accessor has been
+    // replaced, because the record might use the PV support as soon as it has
+    // its initial value.
+    this->replaceAccessor();
+    this->promise.set_value(
+      std::make_tuple(std::move(value), versionNumber));
+  } catch (...) {
+    this->promise.set_exception(std::current_exception());
+  }
+}
+
+template<typename T>
+void DeviceAccessPVSupport<T>::InitialValueRequest::completeIndividually() {
+  try {
+    this->replaceAccessor();
+    this->promise.set_value(this->pvSupport->initialValue());
+  } catch (...) {
+    this->promise.set_exception(std::current_exception());
+  }
+}
+
+template<typename T>
+void DeviceAccessPVSupport<T>::InitialValueRequest::replaceAccessor() {
+  if (!this->addedToTransferGroup) {
+    return;
+  }
+  this->addedToTransferGroup = false;
+  this->pvSupport->accessor =
+    typename detail::DeviceAccessPVSupportHelper<T>::AccessorType();
+  this->pvSupport->accessor =
+    detail::DeviceAccessPVSupportHelper<T>::getAccessor(
+      this->pvSupport->provider->device, this->pvSupport->registerName);
+}
+
 } // namespace EPICS
 } // namespace ChimeraTK
 
@@ -21,6 +21,7 @@
 #define CHIMERATK_EPICS_FIXED_SCALAR_RECORD_DEVICE_SUPPORT_H
 
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <type_traits>
@@ -34,8 +35,10 @@ extern "C" {
 #include <menuPini.h>
 } // extern "C"
 
+#include "NotificationBuffer.h"
 #include "RecordDeviceSupportBase.h"
 #include "RecordDirection.h"
+#include "RecordMutexPool.h"
 #include "RecordValueFieldName.h"
 #include "ensureScanIoRequest.h"
 
@@ -100,7 +103,7 @@ public:
    */
   FixedScalarRecordDeviceSupportTrait(
       RecordType *record, ::DBLINK const &linkField)
-      : RecordDeviceSupportBase(RecordAddress::parse(linkField)),
+      : RecordDeviceSupportBase(record, linkField),
         record(record) {
     // The ChimeraTK Control System Adapter and ChimeraTK Device Access ensure
     // that the number of elements does not change after initialization. For
@@ -237,6 +240,8 @@ public:
         ioIntrModeEnabled(false) {
     // Prepare the data structure needed when enabling I/O Intr mode.
     ::scanIoInit(&this->ioIntrModeScanPvt);
+    this->notificationBuffer = NotificationBuffer<RecordValueType>::create(
+      this->record->name, this->latest, this->queueSize);
   }
 
   /**
@@ -365,6 +370,13 @@ private:
    */
   VersionNumber readVersionNumber;
 
+  /**
+   * Buffer for passing values from the notify callback to processInternal().
+   * This is only allocated when the "latest" or "queue" option has been
+   * specified.
+   */
+  std::unique_ptr<NotificationBuffer<RecordValueType>> notificationBuffer;
+
   /**
    * Internal implementation of getInterruptInfo(...). This is a template that
    * is instantiated for each supported element type. The calling method ensures
@@ -381,9 +393,10 @@ private:
           "I/O Intr mode is not supported for this record.");
       }
       // We can safely pass this to the callback because a record device support
-      // is never destroyed once successfully constructed.
+      // is never destroyed once successfully constructed. For the same reason,
+      // the callbacks can use a raw pointer to the PV support.
       pvSupport->notify(
-        [this](
+        [this, pvSupport = pvSupport.get()](
             typename PVSupport<T>::SharedValue const &value,
             VersionNumber const &versionNumber) {
           // We already checked the number of elements of the PV in the
@@ -396,11 +409,26 @@ private:
                 << " elements, but the record needs exactly one element.";
             throw std::logic_error(oss.str());
           }
+          if (this->notificationBuffer) {
+            auto &entry = this->notificationBuffer->getBackEntry();
+            entry.exception = std::exception_ptr();
+            entry.value = this->convertToRecordValueType((*value)[0]);
+            entry.versionNumber = versionNumber;
+            this->notificationBuffer->publish(
+              *pvSupport, this->ioIntrModeScanPvt);
+            return;
+          }
           this->notifyValue = this->convertToRecordValueType((*value)[0]);
           this->notifyVersionNumber = versionNumber;
           ensureScanIoRequest(this->ioIntrModeScanPvt);
         },
-        [this](std::exception_ptr const &error){
+        [this, pvSupport = pvSupport.get()](std::exception_ptr const &error){
+          if (this->notificationBuffer) {
+            this->notificationBuffer->getBackEntry().exception = error;
+            this->notificationBuffer->publish(
+              *pvSupport, this->ioIntrModeScanPvt);
+            return;
+          }
           this->notifyException = error;
           ensureScanIoRequest(this->ioIntrModeScanPvt);
         });
@@ -454,6 +482,23 @@ private:
 
     // If the ioIntrModeEnabled flag is set, this method is called because our
     // notify callback requested the record to be processed.
+    if (this->ioIntrModeEnabled && this->notificationBuffer) {
+      // The notification buffer takes care of acknowledging the notification,
+      // so we only have to process the next value from the buffer. If there is
+      // no value, it has already been processed when the record was processed
+      // last.
+      this->notificationBuffer->process(*pvSupport, this->ioIntrModeScanPvt,
+        [this](typename NotificationBuffer<RecordValueType>::Entry &entry) {
+          if (entry.exception) {
+            auto tempException = entry.exception;
+            entry.exception = std::exception_ptr();
+            std::rethrow_exception(tempException);
+          }
+          this->getValueField() = entry.value;
+          this->updateTimeStamp(entry.versionNumber);
+        });
+      return;
+    }
     if (this->ioIntrModeEnabled) {
       if (this->notifyException) {
         auto tempException = this->notifyException;
@@ -528,6 +573,7 @@ public:
           record, record->out),
       firstWritePending(false), notifyPending(false), versionNumberValid(false),
       writePending(false) {
+    this->checkOutputRecordOptions();
     this->template callForValueType<CallInitializeValue>(this);
   }
 
@@ -613,23 +659,17 @@ private:
    */
   bool firstWritePending;
 
-  /**
-   * Mutex that is protecting access to notifyPending, value, versionNumber,
-   * versionNumberValid, and writePending.
-   */
-  std::recursive_mutex mutex;
-
   /**
    * Flag indicating whether a notification has been received that has not been
    * processed yet. This field must only be accessed while holding a lock on the
-   * mutex.
+   * record's mutex from the RecordMutexPool.
    */
   bool notifyPending;
 
   /**
    * Value that was last written to the application or that we received with the
    * last notification. This field must only be accessed while holding a lock on
-   * the mutex.
+   * the record's mutex.
    */
   RecordValueType value;
 
@@ -639,14 +679,14 @@ private:
    * the version received as part of the last notification. We use this in order
    * to decide whether a value received from the device (through a notification)
    * is older or newer than the value that we already have. This field must only
-   * be accessed while holding a lock on the mutex.
+   * be accessed while holding a lock on the record's mutex.
    */
   VersionNumber versionNumber;
 
   /**
    * Flag indicating whether the version number is valid.  If it is not valid,
    * any notification that is received is accepted. This field must only be
-   * accessed while holding a lock on the mutex.
+   * accessed while holding a lock on the record's mutex.
    */
   bool versionNumberValid;
 
@@ -660,10 +700,33 @@ private:
    * Basically, this is the same flag as the PACT field of the record, but the
    * PACT field may be modifed by the record support code while this one is
    * exclusively used by the device support. This field must only be accessed
-   * while holding a lock on the mutex.
+   * while holding a lock on the record's mutex.
    */
   bool writePending;
 
+  /**
+   * Resets the state of the record after starting a write operation failed. If
+   * a notification has been received while trying to start the write
+   * operation, the record is scheduled for processing, so that the
+   * notification is not lost.
+   */
+  void abortWrite() {
+    bool requestProcessing;
+    {
+      std::lock_guard<std::mutex> lock(
+        RecordMutexPool::getMutex(this->record));
+      this->record->pact = false;
+      this->writePending = false;
+      requestProcessing = this->notifyPending;
+    }
+    // callbackRequestProcessCallback acquires the lock of the callback queue,
+    // so we must not call it while holding the record's mutex.
+    if (requestProcessing) {
+      ::callbackRequestProcessCallback(
+        &this->processCallback, priorityMedium, this->record);
+    }
+  }
+
   /**
    * Tries to initialize the record's value with the initial value of the
    * underlying process variable.
@@ -674,30 +737,34 @@ private:
     // always accepted when the the initialization fails.
     this->versionNumberValid = false;
     auto pvSupport = this->template getPVSupport<T>();
-    try {
-      auto valueTimeStampAndVersion = pvSupport->initialValue();
-      auto &value = std::get<0>(valueTimeStampAndVersion);
-      // We already checked the number of elements of the PV in the constructor,
-      // so this check should always succeed. However, if something is changed
-      // in ChimeraTK Device Access or the Control System Adapter, this simple
-      // test can save us from serious trouble.
-      if (value.size() != 1) {
-        std::ostringstream oss;
-        oss << "Process variable has " << value.size()
-            << " elements, but the record needs exactly one element.";
-        throw std::logic_error(oss.str());
+    // If the "noinitialread" option has been specified, we leave the record
+    // uninitialized and do not even try to read the initial value.
+    if (!this->noInitialRead) {
+      try {
+        auto valueTimeStampAndVersion = this->template initialValue<T>();
+        auto &value = std::get<0>(valueTimeStampAndVersion);
+        // We already checked the number of elements of the PV in the
+        // constructor, so this check should always succeed. However, if
+        // something is changed in ChimeraTK Device Access or the Control System
+        // Adapter, this simple test can save us from serious trouble.
+        if (value.size() != 1) {
+          std::ostringstream oss;
+          oss << "Process variable has " << value.size()
+              << " elements, but the record needs exactly one element.";
+          throw std::logic_error(oss.str());
+        }
+        this->value = this->convertToRecordValueType(value[0]);
+        this->getValueField() = this->value;
+        this->versionNumber = std::get<1>(valueTimeStampAndVersion);
+        this->versionNumberValid = true;
+        this->updateTimeStamp(this->versionNumber);
+        // Reset the UDF flag because we now have a valid value.
+        this->record->udf = 0;
+        recGblResetAlarms(this->record);
+      } catch (...) {
+        // It might not always be possible to get an initial value, so it is not
+        // an error if this fails.
       }
-      this->value = this->convertToRecordValueType(value[0]);
-      this->getValueField() = this->value;
-      this->versionNumber = std::get<1>(valueTimeStampAndVersion);
-      this->versionNumberValid = true;
-      this->updateTimeStamp(this->versionNumber);
-      // Reset the UDF flag because we now have a valid value.
-      this->record->udf = 0;
-      recGblResetAlarms(this->record);
-    } catch (...) {
-      // It might not always be possible to get an initial value, so it is not
-      // an error if this fails.
     }
     // If this record’s PINI field is set to YES, RUN, or RUNNING, we tell the
     // PV support that we are going to call write(). This will keep it from
@@ -724,34 +791,42 @@ private:
         [this, pvSupport](
             typename PVSupport<T>::SharedValue const &value,
             VersionNumber const &versionNumber) {
-          // Unlike for input records we need a mutex here because processing of
-          // the record may be triggered externally, so it can happen that the
-          // records is processed while we are also in this callback.
-          std::lock_guard<std::recursive_mutex> lock(this->mutex);
-          // We only want to process the record if this update is newer than the
-          // last value that we wrote. We consider a value with the same version
-          // number as newer because it is coming back from the application,
-          // which means that the application must already have seen the value
-          // that we wrote. However, there is no need to process the record if
-          // the received value is in fact the same one as the last value.
           RecordValueType valueAsScalar
             = this->convertToRecordValueType((*value)[0]);
-          if (!this->versionNumberValid
-              || versionNumber > this->versionNumber
-              || (versionNumber == this->versionNumber
-                  && (this->value != valueAsScalar))) {
-            bool oldNotifyPending = this->notifyPending;
-            this->value = valueAsScalar;
-            this->versionNumber = versionNumber;
-            this->notifyPending = true;
-            // If another notify operation or a write operation is pending, the
-            // record is going to be processed again when it has finished.
-            // Otherwise, we schedule the record to be processed.
-            if (this->notifyPending && !oldNotifyPending && !this->writePending) {
-              ::callbackRequestProcessCallback(
-                  &this->processCallback, priorityMedium, this->record);
+          bool requestProcessing = false;
+          {
+            // Unlike for input records we need a mutex here because processing
+            // of the record may be triggered externally, so it can happen that
+            // the records is processed while we are also in this callback.
+            std::lock_guard<std::mutex> lock(
+              RecordMutexPool::getMutex(this->record));
+            // We only want to process the record if this update is newer than
+            // the last value that we wrote. We consider a value with the same
+            // version number as newer because it is coming back from the
+            // application, which means that the application must already have
+            // seen the value that we wrote. However, there is no need to
+            // process the record if the received value is in fact the same one
+            // as the last value.
+            if (!this->versionNumberValid
+                || versionNumber > this->versionNumber
+                || (versionNumber == this->versionNumber
+                    && (this->value != valueAsScalar))) {
+              bool oldNotifyPending = this->notifyPending;
+              this->value = valueAsScalar;
+              this->versionNumber = versionNumber;
+              this->notifyPending = true;
+              // If another notify operation or a write operation is pending,
+              // the record is going to be processed again when it has
+              // finished. Otherwise, we schedule the record to be processed.
+              requestProcessing = !oldNotifyPending && !this->writePending;
             }
           }
+          // callbackRequestProcessCallback acquires the lock of the callback
+          // queue, so we must not call it while holding the record's mutex.
+          if (requestProcessing) {
+            ::callbackRequestProcessCallback(
+                &this->processCallback, priorityMedium, this->record);
+          }
           // Four output records, we do not need a strict guarantee that we see
           // all values received from the device, so we can tell the PV support
           // that the notification has finished.
@@ -774,9 +849,11 @@ private:
    */
   template<typename T>
   void processInternal() {
-    // We have to hold a lock on the notify mutex in this function because we
-    // access fields that are also accessed from the notify callback.
-    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    // We have to hold a lock on the record's mutex in this function because we
+    // access fields that are also accessed from the notify callback. The mutex
+    // may be shared with other records, so we must not hold it while calling
+    // the PV support.
+    std::unique_lock<std::mutex> lock(RecordMutexPool::getMutex(this->record));
     // If the first write has not happened yet, we ensure that it happens now
     // (instead of processing a notification that might have been received).
     if (this->firstWritePending) {
@@ -794,7 +871,9 @@ private:
         // If a notification is pending, we want that notification to be
         // processed after we have signaled the failure of the last write
         // operation to the user.
-        if (notifyPending) {
+        bool requestProcessing = this->notifyPending;
+        lock.unlock();
+        if (requestProcessing) {
           ::callbackRequestProcessCallback(
             &this->processCallback, priorityMedium, this->record);
         }
@@ -816,8 +895,6 @@ private:
       return;
     }
     // Otherwise, this method is called because a value should be written.
-    // We can safely pass this to the callback because a record device support
-    // is never destroyed once successfully constructed.
     this->value = this->getValueField();
     auto pvSupport = this->template getPVSupport<T>();
     // We generate a new version number for the write operation. This ensures
@@ -825,25 +902,39 @@ private:
     // are newer than the value that we are writing now.
     this->versionNumber = VersionNumber();
     this->updateTimeStamp(this->versionNumber);
-    bool immediate = pvSupport->write(
-      std::vector<T>(
-          1, this->template convertFromRecordValueType<T>(this->value)),
-      this->versionNumber,
-      [this](bool immediate) {
-        if (!immediate) {
-          ::callbackRequestProcessCallback(
-            &this->processCallback, priorityMedium, this->record);
-        }
-      },
-      [this](bool immediate, std::exception_ptr const &error){
-        this->writeException = error;
-        if (!immediate) {
-          ::callbackRequestProcessCallback(
-            &this->processCallback, priorityMedium, this->record);
-        }
-      });
+    std::vector<T> writeValue(
+      1, this->template convertFromRecordValueType<T>(this->value));
+    VersionNumber writeVersionNumber = this->versionNumber;
+    // We mark the write operation as pending before releasing the mutex, so
+    // that a notification that is received while the write operation is in
+    // progress does not trigger processing of the record.
     this->record->pact = true;
     this->writePending = true;
+    lock.unlock();
+    // We can safely pass this to the callback because a record device support
+    // is never destroyed once successfully constructed.
+    bool immediate;
+    try {
+      immediate = pvSupport->write(
+        std::move(writeValue),
+        writeVersionNumber,
+        [this](bool immediate) {
+          if (!immediate) {
+            ::callbackRequestProcessCallback(
+              &this->processCallback, priorityMedium, this->record);
+          }
+        },
+        [this](bool immediate, std::exception_ptr const &error){
+          this->writeException = error;
+          if (!immediate) {
+            ::callbackRequestProcessCallback(
+              &this->processCallback, priorityMedium, this->record);
+          }
+        });
+    } catch (...) {
+      this->abortWrite();
+      throw;
+    }
     if (immediate) {
       this->template processInternal<T>();
     }
@@ -0,0 +1,727 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_FLIGHT_RECORDER_H
+#define CHIMERATK_EPICS_FLIGHT_RECORDER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <forward_list>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <ChimeraTK/SupportedUserTypes.h>
+#include <ChimeraTK/VersionNumber.h>
+
+extern "C" {
+#include <epicsStdio.h>
+} // extern "C"
+
+#include "PVSupport.h"
+#include "errorPrint.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace detail {
+
+/**
+ * Returns a function that calls both of the specified functions, one after the
+ * other. Either function may be empty.
+ */
+inline std::function<void()> chainFunctions(
+    std::function<void()> first, std::function<void()> second) {
+  if (!first) {
+    return second;
+  }
+  if (!second) {
+    return first;
+  }
+  return [first, second](){
+      first();
+      second();
+    };
+}
+
+/**
+ * Tells whether the specified value of a trigger PV shall freeze the flight
+ * recorders. This is the case when any of its elements is not zero.
+ */
+template<typename T>
+inline bool isFlightRecorderTriggerValue(std::vector<T> const &value) {
+  for (auto const &element : value) {
+    if (element != T()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Tells whether the specified value of a trigger PV shall freeze the flight
+ * recorders. For strings, this is the case when any of the elements is not
+ * empty.
+ */
+inline bool isFlightRecorderTriggerValue(
+    std::vector<std::string> const &value) {
+  for (auto const &element : value) {
+    if (!element.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Tells whether the specified value of a trigger PV shall freeze the flight
+ * recorders. Void PVs do not have a value, so every update freezes the flight
+ * recorders.
+ */
+inline bool isFlightRecorderTriggerValue(
+    std::vector<ChimeraTK::Void> const &value) {
+  return true;
+}
+
+/**
+ * Writes the binary representation of the specified integer to the stream,
+ * using the native byte order.
+ */
+template<typename T>
+inline void writeFlightRecorderField(std::ostream &stream, T value) {
+  stream.write(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+/**
+ * Writes the length of the string (as a 32-bit unsigned integer) and its
+ * characters to the stream.
+ */
+inline void writeFlightRecorderField(
+    std::ostream &stream, std::string const &value) {
+  writeFlightRecorderField(stream, static_cast<std::uint32_t>(value.size()));
+  stream.write(value.data(), value.size());
+}
+
+/**
+ * Writes the elements of the specified value to the stream, using the native
+ * byte order.
+ */
+template<typename T>
+inline void writeFlightRecorderValue(
+    std::ostream &stream, std::vector<T> const &value) {
+  stream.write(reinterpret_cast<char const *>(value.data()),
+    value.size() * sizeof(T));
+}
+
+/**
+ * Writes the elements of the specified value to the stream, using one byte
+ * for each element.
+ */
+inline void writeFlightRecorderValue(
+    std::ostream &stream, std::vector<ChimeraTK::Boolean> const &value) {
+  for (auto const &element : value) {
+    writeFlightRecorderField(
+      stream, static_cast<std::uint8_t>(static_cast<bool>(element) ? 1 : 0));
+  }
+}
+
+/**
+ * Writes the elements of the specified value to the stream, prefixing each
+ * string with its length.
+ */
+inline void writeFlightRecorderValue(
+    std::ostream &stream, std::vector<std::string> const &value) {
+  for (auto const &element : value) {
+    writeFlightRecorderField(stream, element);
+  }
+}
+
+/**
+ * Writes nothing because void values do not have any data.
+ */
+inline void writeFlightRecorderValue(
+    std::ostream &stream, std::vector<ChimeraTK::Void> const &value) {
+}
+
+/**
+ * Returns the name of the element type T, as used in record addresses.
+ */
+template<typename T>
+char const *flightRecorderTypeName();
+
+template<>
+inline char const *flightRecorderTypeName<ChimeraTK::Boolean>() {
+  return "bool";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::int8_t>() {
+  return "int8";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::uint8_t>() {
+  return "uint8";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::int16_t>() {
+  return "int16";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::uint16_t>() {
+  return "uint16";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::int32_t>() {
+  return "int32";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::uint32_t>() {
+  return "uint32";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::int64_t>() {
+  return "int64";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::uint64_t>() {
+  return "uint64";
+}
+
+template<>
+inline char const *flightRecorderTypeName<float>() {
+  return "float";
+}
+
+template<>
+inline char const *flightRecorderTypeName<double>() {
+  return "double";
+}
+
+template<>
+inline char const *flightRecorderTypeName<std::string>() {
+  return "string";
+}
+
+template<>
+inline char const *flightRecorderTypeName<ChimeraTK::Void>() {
+  return "void";
+}
+
+} // namespace detail
+
+/**
+ * Base interface for all variants of FlightRecorder. This interface defines
+ * the methods that are used by the ControlSystemAdapterPVProvider and that do
+ * not depend on the element type of the PV.
+ */
+class FlightRecorderBase {
+
+public:
+
+  /**
+   * Type of a shared pointer to this type.
+   */
+  using SharedPtr = std::shared_ptr<FlightRecorderBase>;
+
+  /**
+   * Writes the recorded values to the stream. The format is described in the
+   * README.
+   */
+  virtual void dump(std::ostream &stream) = 0;
+
+  /**
+   * Returns the number of values that can be stored by this flight recorder.
+   */
+  virtual std::size_t getDepth() const = 0;
+
+  /**
+   * Prints the state of this flight recorder to stdout.
+   */
+  virtual void report() = 0;
+
+  /**
+   * Freezes or unfreezes this flight recorder. While the flight recorder is
+   * frozen, new values are not recorded. When the flight recorder is frozen,
+   * the PV supports that have been created by it are notified with the frozen
+   * contents. The returned function does this and has to be called after
+   * releasing all locks.
+   */
+  virtual std::function<void()> setFrozen(bool frozen) = 0;
+
+  /**
+   * Destructor.
+   */
+  virtual ~FlightRecorderBase() noexcept {
+  }
+
+};
+
+template<typename T>
+class FlightRecorderPVSupport;
+
+/**
+ * Ring buffer holding the last values (and their version numbers) of a
+ * process variable.
+ *
+ * The memory for all values is allocated when the flight recorder is created,
+ * so recording a value only copies it into the oldest slot. This is cheap
+ * enough to be done for every notification of a high-rate PV, so that the
+ * history before an event (e.g. a beam trip) can be analyzed after the flight
+ * recorder has been frozen.
+ */
+template<typename T>
+class FlightRecorder
+    : public FlightRecorderBase,
+      public std::enable_shared_from_this<FlightRecorder<T>> {
+
+public:
+
+  /**
+   * Type of a value vector.
+   */
+  using Value = typename PVSupport<T>::Value;
+
+  /**
+   * Type of a shared value vector.
+   */
+  using SharedValue = typename PVSupport<T>::SharedValue;
+
+  /**
+   * Creates a flight recorder for the specified process variable that stores
+   * up to depth values, each of them having the specified number of elements.
+   */
+  FlightRecorder(std::string const &name, std::size_t depth,
+      std::size_t numberOfElements)
+      : depth(depth), droppedCount(0), frozen(false), name(name),
+        nextIndex(0), numberOfElements(numberOfElements), recordedCount(0),
+        size(0), values(depth, Value(numberOfElements)),
+        versionNumbers(depth, VersionNumber(nullptr)) {
+  }
+
+  /**
+   * Creates a PV support that provides the contents of this flight recorder.
+   * See FlightRecorderPVSupport for details.
+   */
+  std::shared_ptr<FlightRecorderPVSupport<T>> createPVSupport() {
+    auto pvSupport = std::make_shared<FlightRecorderPVSupport<T>>(
+      this->shared_from_this());
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->pvSupports.push_front(pvSupport);
+    return pvSupport;
+  }
+
+  // Declared in FlightRecorderBase.
+  void dump(std::ostream &stream) override {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    detail::writeFlightRecorderField(stream, this->name);
+    detail::writeFlightRecorderField(
+      stream, std::string(detail::flightRecorderTypeName<T>()));
+    detail::writeFlightRecorderField(
+      stream, static_cast<std::uint32_t>(this->numberOfElements));
+    detail::writeFlightRecorderField(
+      stream, static_cast<std::uint32_t>(this->size));
+    this->forEachEntry([&stream](Value const &value,
+        VersionNumber const &versionNumber){
+      detail::writeFlightRecorderField(stream,
+        static_cast<std::int64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+            versionNumber.getTime().time_since_epoch()).count()));
+      detail::writeFlightRecorderValue(stream, value);
+    });
+  }
+
+  // Declared in FlightRecorderBase.
+  std::size_t getDepth() const override {
+    return this->depth;
+  }
+
+  /**
+   * Returns the number of elements of the values provided by the PV supports
+   * of this flight recorder. This is the number of elements of each recorded
+   * value multiplied by the depth.
+   */
+  std::size_t getSnapshotNumberOfElements() const {
+    return this->depth * this->numberOfElements;
+  }
+
+  /**
+   * Returns the frozen contents of this flight recorder or, if it is not
+   * frozen, its current contents, and the version number of the newest value.
+   * See FlightRecorderPVSupport for the layout of the returned value.
+   */
+  std::tuple<SharedValue, VersionNumber> getSnapshot() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->frozenSnapshot) {
+      return std::make_tuple(
+        this->frozenSnapshot, this->frozenSnapshotVersionNumber);
+    }
+    return this->createSnapshot();
+  }
+
+  /**
+   * Stores a copy of the specified value in the slot of the oldest value. If
+   * the flight recorder is frozen, the value is discarded.
+   *
+   * The value must have the number of elements that has been passed to the
+   * constructor.
+   */
+  void record(Value const &value, VersionNumber const &versionNumber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->frozen) {
+      ++this->droppedCount;
+      return;
+    }
+    // The slot has the same size as the value, so assigning the value does
+    // not allocate memory (except for long strings).
+    this->values[this->nextIndex].assign(value.begin(), value.end());
+    this->versionNumbers[this->nextIndex] = versionNumber;
+    this->nextIndex = (this->nextIndex + 1) % this->depth;
+    if (this->size < this->depth) {
+      ++this->size;
+    }
+    ++this->recordedCount;
+  }
+
+  // Declared in FlightRecorderBase.
+  void report() override {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    ::epicsStdoutPrintf(
+      "  Flight recorder %s: %s, depth %zu, %zu values stored, %zu values recorded, %zu values discarded while frozen\n",
+      this->name.c_str(), this->frozen ? "frozen" : "recording", this->depth,
+      this->size, this->recordedCount, this->droppedCount);
+  }
+
+  // Declared in FlightRecorderBase.
+  std::function<void()> setFrozen(bool frozen) override {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (frozen == this->frozen) {
+      return std::function<void()>();
+    }
+    this->frozen = frozen;
+    if (!frozen) {
+      this->frozenSnapshot.reset();
+      return std::function<void()>();
+    }
+    std::tie(this->frozenSnapshot, this->frozenSnapshotVersionNumber) =
+      this->createSnapshot();
+    // We only notify the PV supports that are not still busy with the previous
+    // snapshot. As freezing is a rare event, this should never happen in
+    // practice, and the record can still read the snapshot when it is
+    // processed.
+    std::vector<typename PVSupport<T>::NotifyCallback> callbacks;
+    for (auto i = this->pvSupports.before_begin();
+        std::next(i) != this->pvSupports.end();) {
+      auto pvSupport = std::next(i)->lock();
+      if (!pvSupport) {
+        this->pvSupports.erase_after(i);
+        continue;
+      }
+      if (pvSupport->notifyCallback && !pvSupport->notificationPending) {
+        pvSupport->notificationPending = true;
+        callbacks.push_back(pvSupport->notifyCallback);
+      }
+      ++i;
+    }
+    if (callbacks.empty()) {
+      return std::function<void()>();
+    }
+    auto value = this->frozenSnapshot;
+    auto versionNumber = this->frozenSnapshotVersionNumber;
+    return [value, versionNumber, callbacks = std::move(callbacks)](){
+        for (auto &callback : callbacks) {
+          try {
+            callback(value, versionNumber);
+          } catch (std::exception &e) {
+            errorPrintf(
+              "A notification callback threw an exception. This indicates a bug in the record device support code. The exception message was: %s",
+              e.what());
+          } catch (...) {
+            errorPrintf(
+              "A notification callback threw an exception. This indicates a bug in the record device support code.");
+          }
+        }
+      };
+  }
+
+private:
+
+  /**
+   * The PV support accesses the mutex and the notification state that is
+   * stored in this object.
+   */
+  friend class FlightRecorderPVSupport<T>;
+
+  /**
+   * Max. number of values that are stored.
+   */
+  std::size_t const depth;
+
+  /**
+   * Number of values that have been discarded because the flight recorder was
+   * frozen.
+   */
+  std::size_t droppedCount;
+
+  /**
+   * Flag indicating whether the flight recorder is frozen.
+   */
+  bool frozen;
+
+  /**
+   * Contents of the flight recorder at the time when it was frozen. Null if
+   * the flight recorder is not frozen.
+   */
+  SharedValue frozenSnapshot;
+
+  /**
+   * Version number of the newest value in the frozenSnapshot.
+   */
+  VersionNumber frozenSnapshotVersionNumber{nullptr};
+
+  /**
+   * Mutex protecting all mutable state of this flight recorder and of the PV
+   * supports created by it.
+   */
+  std::mutex mutex;
+
+  /**
+   * Name of the process variable.
+   */
+  std::string const name;
+
+  /**
+   * Index of the slot in which the next value is stored. When the flight
+   * recorder is full, this is the slot of the oldest value.
+   */
+  std::size_t nextIndex;
+
+  /**
+   * Number of elements of each value.
+   */
+  std::size_t const numberOfElements;
+
+  /**
+   * PV supports that have been created by createPVSupport(). We only keep
+   * weak references, so that PV supports that are not used any longer are
+   * destroyed.
+   */
+  std::forward_list<std::weak_ptr<FlightRecorderPVSupport<T>>> pvSupports;
+
+  /**
+   * Total number of values that have been recorded.
+   */
+  std::size_t recordedCount;
+
+  /**
+   * Number of slots that contain a value.
+   */
+  std::size_t size;
+
+  /**
+   * Slots for the values. The memory for all slots is allocated by the
+   * constructor.
+   */
+  std::vector<Value> values;
+
+  /**
+   * Version numbers belonging to the values in the slots.
+   */
+  std::vector<VersionNumber> versionNumbers;
+
+  /**
+   * Copies all values into a single vector, see getSnapshot().
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  std::tuple<SharedValue, VersionNumber> createSnapshot() {
+    auto snapshot = std::make_shared<Value>(this->getSnapshotNumberOfElements());
+    // The newest value is always at the end, so if the flight recorder is not
+    // full yet, the slots at the start of the snapshot stay empty.
+    auto destination = snapshot->begin()
+      + (this->depth - this->size) * this->numberOfElements;
+    VersionNumber newestVersionNumber(nullptr);
+    this->forEachEntry([&destination, &newestVersionNumber](
+        Value const &value, VersionNumber const &versionNumber){
+      destination = std::copy(value.begin(), value.end(), destination);
+      newestVersionNumber = versionNumber;
+    });
+    return std::make_tuple(
+      SharedValue(std::move(snapshot)), newestVersionNumber);
+  }
+
+  /**
+   * Calls the specified function for each value and its version number,
+   * starting with the oldest value.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  template<typename Function>
+  void forEachEntry(Function const &function) {
+    auto index = (this->nextIndex + this->depth - this->size) % this->depth;
+    for (std::size_t i = 0; i < this->size; ++i) {
+      function(this->values[index], this->versionNumbers[index]);
+      index = (index + 1) % this->depth;
+    }
+  }
+
+};
+
+/**
+ * PV support providing the contents of a flight recorder.
+ *
+ * The value of this PV support has depth times the number of elements of the
+ * recorded PV. It contains the recorded values one after another, starting
+ * with the oldest value, so that the newest value is always at the end. If
+ * the flight recorder has not been filled completely yet, the elements at the
+ * start are zero. The version number is the one of the newest value.
+ *
+ * The PV support delivers a notification each time the flight recorder is
+ * frozen. Reading returns the frozen contents or, if the flight recorder is
+ * not frozen, its current contents. Writing is not supported.
+ */
+template<typename T>
+class FlightRecorderPVSupport : public PVSupport<T> {
+
+public:
+
+  /**
+   * Type of the callback function that is called in case of an error.
+   */
+  using ErrorCallback = typename PVSupport<T>::ErrorCallback;
+
+  /**
+   * Type of the callback passed to notify(...).
+   */
+  using NotifyCallback = typename PVSupport<T>::NotifyCallback;
+
+  /**
+   * Type of the error callback passed to notify(...).
+   */
+  using NotifyErrorCallback = typename PVSupport<T>::NotifyErrorCallback;
+
+  /**
+   * Type of the callback passed to read(...).
+   */
+  using ReadCallback = typename PVSupport<T>::ReadCallback;
+
+  /**
+   * Type of a value vector.
+   */
+  using Value = typename PVSupport<T>::Value;
+
+  /**
+   * Creates a PV support for the specified flight recorder. This constructor
+   * should only be called by FlightRecorder::createPVSupport().
+   */
+  FlightRecorderPVSupport(std::shared_ptr<FlightRecorder<T>> flightRecorder)
+      : flightRecorder(std::move(flightRecorder)),
+        notificationPending(false) {
+  }
+
+  // Declared in PVSupportBase.
+  bool canNotify() override {
+    return true;
+  }
+
+  // Declared in PVSupportBase.
+  bool canRead() override {
+    return true;
+  }
+
+  // Declared in PVSupportBase.
+  std::size_t getNumberOfElements() override {
+    return this->flightRecorder->getSnapshotNumberOfElements();
+  }
+
+  // Declared in PVSupport.
+  std::tuple<Value, VersionNumber> initialValue() override {
+    auto snapshot = this->flightRecorder->getSnapshot();
+    return std::make_tuple(*std::get<0>(snapshot), std::get<1>(snapshot));
+  }
+
+  // Declared in PVSupport.
+  void notify(
+      NotifyCallback const &successCallback,
+      NotifyErrorCallback const &errorCallback) override {
+    std::lock_guard<std::mutex> lock(this->flightRecorder->mutex);
+    this->notifyCallback = successCallback;
+  }
+
+  // Declared in PVSupport.
+  void notifyFinished() override {
+    std::lock_guard<std::mutex> lock(this->flightRecorder->mutex);
+    this->notificationPending = false;
+  }
+
+  // Declared in PVSupport.
+  bool read(
+      ReadCallback const &successCallback,
+      ErrorCallback const &errorCallback) override {
+    auto snapshot = this->flightRecorder->getSnapshot();
+    if (successCallback) {
+      successCallback(true, std::get<0>(snapshot), std::get<1>(snapshot));
+    }
+    return true;
+  }
+
+private:
+
+  /**
+   * The flight recorder accesses the notification state when it is frozen.
+   */
+  friend class FlightRecorder<T>;
+
+  /**
+   * Flight recorder providing the values.
+   */
+  std::shared_ptr<FlightRecorder<T>> flightRecorder;
+
+  /**
+   * Flag indicating whether a notification has been delivered and
+   * notifyFinished() has not been called yet. Access to this flag is
+   * protected by the flight recorder's mutex.
+   */
+  bool notificationPending;
+
+  /**
+   * Callback registered with notify(...). Access to this callback is protected
+   * by the flight recorder's mutex.
+   */
+  NotifyCallback notifyCallback;
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_FLIGHT_RECORDER_H
@@ -0,0 +1,494 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_HISTORY_PV_SUPPORT_H
+#define CHIMERATK_EPICS_HISTORY_PV_SUPPORT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "PVSupport.h"
+#include "Timer.h"
+#include "errorPrint.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * PVSupport providing the recent history of a scalar PV as an array.
+ *
+ * This PV support wraps the PV support of a scalar PV that supports
+ * notifications. Each value received through a notification is stored in a
+ * circular buffer that is allocated when this PV support is created, and the
+ * notification is acknowledged right away, so recording a value only costs a
+ * single store. The value of this PV support has as many elements as the
+ * buffer, starting with the oldest value, so that the newest value is always
+ * at the end. If the buffer has not been filled completely yet, the elements
+ * at the start are zero.
+ *
+ * The callback registered with notify(...) is called with the current history
+ * when a new value has been stored, but at most once per interval and never
+ * while the record is still processing the previous history. Values arriving
+ * in between are collected and handed over together. Errors reported by the
+ * original PV support are handed over in the same way, so the record is never
+ * notified while it is still busy. Reading returns the current history.
+ * Writing is not supported.
+ */
+template<typename T>
+class HistoryPVSupport
+    : public PVSupport<T>,
+      public std::enable_shared_from_this<HistoryPVSupport<T>> {
+
+public:
+
+  /**
+   * Type of the callback function that is called in case of an error.
+   */
+  using ErrorCallback = typename PVSupport<T>::ErrorCallback;
+
+  /**
+   * Type of the callback passed to notify(...).
+   */
+  using NotifyCallback = typename PVSupport<T>::NotifyCallback;
+
+  /**
+   * Type of the error callback passed to notify(...).
+   */
+  using NotifyErrorCallback = typename PVSupport<T>::NotifyErrorCallback;
+
+  /**
+   * Type of the callback passed to read(...).
+   */
+  using ReadCallback = typename PVSupport<T>::ReadCallback;
+
+  /**
+   * Type of a shared value vector.
+   */
+  using SharedValue = typename PVSupport<T>::SharedValue;
+
+  /**
+   * Type of a value vector.
+   */
+  using Value = typename PVSupport<T>::Value;
+
+  /**
+   * Creates a history PV support that keeps the last size values of the
+   * specified PV support and hands them over at most once per interval. Throws
+   * an exception if the original PV support does not support notifications
+   * or does not represent a scalar.
+   */
+  static std::shared_ptr<HistoryPVSupport> create(
+      typename PVSupport<T>::SharedPtr originalPVSupport, std::size_t size,
+      std::chrono::milliseconds interval) {
+    if (!originalPVSupport->canNotify()) {
+      throw std::invalid_argument(
+        "The history option can only be used with process variables that support notifications.");
+    }
+    if (originalPVSupport->getNumberOfElements() != 1) {
+      throw std::invalid_argument(
+        "The history option can only be used with scalar process variables.");
+    }
+    auto instance = std::make_shared<HistoryPVSupport>(
+      originalPVSupport, size, interval);
+    // We subscribe right away, so that the history is also recorded when the
+    // record is not in I/O Intr mode. The original PV support is kept alive by
+    // this PV support, so it is safe to use a plain pointer in the callback.
+    std::weak_ptr<HistoryPVSupport> weakInstance = instance;
+    auto original = originalPVSupport.get();
+    originalPVSupport->notify(
+      [weakInstance, original](
+          SharedValue const &value, VersionNumber const &versionNumber){
+        auto sharedInstance = weakInstance.lock();
+        std::function<void()> handOverFunction;
+        if (sharedInstance) {
+          handOverFunction = sharedInstance->append(
+            value->front(), versionNumber);
+        }
+        // The value has been stored, so we can acknowledge the notification
+        // before handing the history over to the record.
+        original->notifyFinished();
+        if (handOverFunction) {
+          handOverFunction();
+        }
+      },
+      [weakInstance, original](std::exception_ptr const &error){
+        auto sharedInstance = weakInstance.lock();
+        std::function<void()> handOverFunction;
+        if (sharedInstance) {
+          handOverFunction = sharedInstance->storeError(error);
+        }
+        // Errors have to be acknowledged like values, otherwise the original
+        // PV support would never deliver another notification.
+        original->notifyFinished();
+        if (handOverFunction) {
+          handOverFunction();
+        }
+      });
+    return instance;
+  }
+
+  /**
+   * Constructor. Use create(...) instead of calling this constructor
+   * directly.
+   */
+  HistoryPVSupport(typename PVSupport<T>::SharedPtr originalPVSupport,
+      std::size_t size, std::chrono::milliseconds interval)
+      : buffer(size), handOverPending(false), handOverScheduled(false),
+        interval(interval), lastHandOver(), newValues(false), nextIndex(0),
+        notificationPending(false), originalPVSupport(originalPVSupport),
+        pendingError(), size(0), versionNumber(nullptr) {
+  }
+
+  /**
+   * Destructor. Cancels the subscription with the original PV support.
+   */
+  ~HistoryPVSupport() noexcept {
+    try {
+      this->originalPVSupport->cancelNotify();
+    } catch (...) {
+      // We cannot do anything about an error here, and the callback does not
+      // use this object once it has been destroyed.
+    }
+  }
+
+  // Declared in PVSupportBase.
+  bool canNotify() override {
+    return true;
+  }
+
+  // Declared in PVSupportBase.
+  bool canRead() override {
+    return true;
+  }
+
+  // Declared in PVSupportBase.
+  std::size_t getNumberOfElements() override {
+    return this->buffer.size();
+  }
+
+  // Declared in PVSupport.
+  std::tuple<Value, VersionNumber> initialValue() override {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return std::make_tuple(*this->createView(), this->versionNumber);
+  }
+
+  // Declared in PVSupport.
+  void notify(
+      NotifyCallback const &successCallback,
+      NotifyErrorCallback const &errorCallback) override {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->notifyCallback = successCallback;
+    this->notifyErrorCallback = errorCallback;
+  }
+
+  // Declared in PVSupport.
+  void notifyFinished() override {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->notificationPending = false;
+    // If values or an error have arrived while the record was busy, we hand
+    // them over through the timer. Calling the callback from here could
+    // recurse into the record's processing code.
+    if (this->newValues || this->pendingError) {
+      this->scheduleHandOver();
+    }
+  }
+
+  // Declared in PVSupport.
+  bool read(
+      ReadCallback const &successCallback,
+      ErrorCallback const &errorCallback) override {
+    SharedValue value;
+    VersionNumber versionNumber{nullptr};
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      value = this->createView();
+      versionNumber = this->versionNumber;
+    }
+    if (successCallback) {
+      successCallback(true, value, versionNumber);
+    }
+    return true;
+  }
+
+private:
+
+  /**
+   * Circular buffer holding the values. Its size is the number of values in
+   * the history.
+   */
+  Value buffer;
+
+  /**
+   * Flag indicating whether a hand-over is in progress: The callback has
+   * been selected, but has not been called yet.
+   */
+  bool handOverPending;
+
+  /**
+   * Flag indicating whether a hand-over has been scheduled with the timer.
+   */
+  bool handOverScheduled;
+
+  /**
+   * Min. time between two hand-overs.
+   */
+  std::chrono::milliseconds const interval;
+
+  /**
+   * Time of the last hand-over.
+   */
+  std::chrono::steady_clock::time_point lastHandOver;
+
+  /**
+   * Mutex protecting the mutable state of this PV support.
+   */
+  std::mutex mutex;
+
+  /**
+   * Flag indicating whether there are values that have not been handed over
+   * yet.
+   */
+  bool newValues;
+
+  /**
+   * Index of the slot in which the next value is stored. When the buffer is
+   * full, this is the slot of the oldest value.
+   */
+  std::size_t nextIndex;
+
+  /**
+   * Flag indicating whether the history has been handed over and
+   * notifyFinished() has not been called yet.
+   */
+  bool notificationPending;
+
+  /**
+   * Callback registered with notify(...).
+   */
+  NotifyCallback notifyCallback;
+
+  /**
+   * Error callback registered with notify(...).
+   */
+  NotifyErrorCallback notifyErrorCallback;
+
+  /**
+   * PV support of the scalar PV.
+   */
+  typename PVSupport<T>::SharedPtr originalPVSupport;
+
+  /**
+   * Error reported by the original PV support that has not been handed over
+   * to the record yet. If several errors arrive while the record is busy, only
+   * the latest one is kept.
+   */
+  std::exception_ptr pendingError;
+
+  /**
+   * Number of slots that contain a value.
+   */
+  std::size_t size;
+
+  /**
+   * Version number of the newest value.
+   */
+  VersionNumber versionNumber;
+
+  /**
+   * Stores a value in the buffer. Returns a function that hands the history
+   * over to the record if this is due now. This function has to be called
+   * after acknowledging the notification with the original PV support.
+   */
+  std::function<void()> append(
+      T const &value, VersionNumber const &versionNumber) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->buffer[this->nextIndex] = value;
+    this->nextIndex = (this->nextIndex + 1) % this->buffer.size();
+    if (this->size < this->buffer.size()) {
+      ++this->size;
+    }
+    this->versionNumber = versionNumber;
+    this->newValues = true;
+    if (!this->notifyCallback || this->notificationPending
+        || this->handOverScheduled || this->handOverPending) {
+      return std::function<void()>();
+    }
+    if (std::chrono::steady_clock::now() - this->lastHandOver
+        < this->interval) {
+      this->scheduleHandOver();
+      return std::function<void()>();
+    }
+    this->handOverPending = true;
+    return [this](){
+        this->handOver();
+      };
+  }
+
+  /**
+   * Copies the values into a new vector, starting with the oldest value.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  SharedValue createView() {
+    auto view = std::make_shared<Value>(this->buffer.size());
+    auto oldest = (this->nextIndex + this->buffer.size() - this->size)
+      % this->buffer.size();
+    auto destination = view->begin() + (this->buffer.size() - this->size);
+    if (oldest + this->size <= this->buffer.size()) {
+      std::copy(this->buffer.begin() + oldest,
+        this->buffer.begin() + oldest + this->size, destination);
+    } else {
+      destination = std::copy(
+        this->buffer.begin() + oldest, this->buffer.end(), destination);
+      std::copy(
+        this->buffer.begin(), this->buffer.begin() + this->nextIndex,
+        destination);
+    }
+    return view;
+  }
+
+  /**
+   * Hands the current history or a pending error over to the record. A
+   * pending error is handed over before the values. The hand-over is skipped
+   * if there is nothing to hand over or the record is still busy. In the
+   * latter case, notifyFinished() schedules the hand-over again.
+   */
+  void handOver() {
+    NotifyCallback callback;
+    NotifyErrorCallback errorCallback;
+    std::exception_ptr error;
+    SharedValue value;
+    VersionNumber versionNumber{nullptr};
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->handOverPending = false;
+      if (this->notificationPending) {
+        return;
+      }
+      if (this->pendingError && this->notifyErrorCallback) {
+        errorCallback = this->notifyErrorCallback;
+        error = this->pendingError;
+        this->pendingError = nullptr;
+        this->notificationPending = true;
+      }
+    }
+    if (error) {
+      try {
+        errorCallback(error);
+      } catch (std::exception &e) {
+        errorPrintf(
+          "A notification callback threw an exception. This indicates a bug in the record device support code. The exception message was: %s",
+          e.what());
+      } catch (...) {
+        errorPrintf(
+          "A notification callback threw an exception. This indicates a bug in the record device support code.");
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (!this->newValues || !this->notifyCallback
+          || this->notificationPending) {
+        return;
+      }
+      callback = this->notifyCallback;
+      value = this->createView();
+      versionNumber = this->versionNumber;
+      this->lastHandOver = std::chrono::steady_clock::now();
+      this->newValues = false;
+      this->notificationPending = true;
+    }
+    try {
+      callback(value, versionNumber);
+    } catch (std::exception &e) {
+      errorPrintf(
+        "A notification callback threw an exception. This indicates a bug in the record device support code. The exception message was: %s",
+        e.what());
+    } catch (...) {
+      errorPrintf(
+        "A notification callback threw an exception. This indicates a bug in the record device support code.");
+    }
+  }
+
+  /**
+   * Stores an error reported by the original PV support, so that it is handed
+   * over to the record like a value. Returns a function that hands the error
+   * over if the record is not busy. This function has to be called after
+   * acknowledging the notification with the original PV support.
+   */
+  std::function<void()> storeError(std::exception_ptr const &error) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->notifyErrorCallback) {
+      return std::function<void()>();
+    }
+    this->pendingError = error;
+    // Unlike values, errors are not subject to the min. interval between
+    // hand-overs. If the record is busy, notifyFinished() schedules the
+    // hand-over.
+    if (this->notificationPending || this->handOverScheduled
+        || this->handOverPending) {
+      return std::function<void()>();
+    }
+    this->handOverPending = true;
+    return [this](){
+        this->handOver();
+      };
+  }
+
+  /**
+   * Schedules a hand-over with the timer, so that it happens when the
+   * interval since the last hand-over has passed. Does nothing if a
+   * hand-over has already been scheduled.
+   *
+   * This method must only be called while holding a lock on the mutex.
+   */
+  void scheduleHandOver() {
+    if (this->handOverScheduled) {
+      return;
+    }
+    this->handOverScheduled = true;
+    std::weak_ptr<HistoryPVSupport> weakThis = this->shared_from_this();
+    auto delay = std::max(std::chrono::steady_clock::duration(0),
+      this->lastHandOver + this->interval - std::chrono::steady_clock::now());
+    Timer::shared().submitDelayedTask(delay, [weakThis](){
+      auto sharedThis = weakThis.lock();
+      if (!sharedThis) {
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(sharedThis->mutex);
+        sharedThis->handOverScheduled = false;
+      }
+      sharedThis->handOver();
+    });
+  }
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_HISTORY_PV_SUPPORT_H
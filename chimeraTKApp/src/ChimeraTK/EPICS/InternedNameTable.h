@@ -0,0 +1,80 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_INTERNED_NAME_TABLE_H
+#define CHIMERATK_EPICS_INTERNED_NAME_TABLE_H
+
+#include <cstddef>
+#include <string>
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Table of interned application, device, and process-variable names.
+ *
+ * Many records refer to the same application or device and often several
+ * records refer to the same process variable. Interning these names means that
+ * each distinct name is only stored once and that record addresses can refer
+ * to the names without having to allocate memory for a copy.
+ *
+ * Names are never removed from the table, so references returned by the
+ * methods of this class stay valid until the process exits. All methods are
+ * safe for concurrent use by multiple threads.
+ */
+class InternedNameTable {
+
+public:
+
+  /**
+   * Returns a reference to the interned copy of the specified name. If the
+   * name has not been interned yet, it is added to the table. No memory is
+   * allocated if the name has already been interned.
+   */
+  static std::string const &intern(char const *name, std::size_t length);
+
+  /**
+   * Returns a reference to the interned copy of the specified name. If the
+   * name has not been interned yet, it is added to the table. No memory is
+   * allocated if the name has already been interned.
+   */
+  static std::string const &intern(std::string const &name) {
+    return InternedNameTable::intern(name.data(), name.size());
+  }
+
+  /**
+   * Returns a reference to the interned copy of the normalized form of the
+   * specified register path. The normalized form is the result of converting
+   * the name to a RegisterPath and back to a string. The normalized form is
+   * cached, so that each distinct name only has to be normalized once.
+   */
+  static std::string const &internNormalizedRegisterPath(
+      std::string const &name);
+
+private:
+
+  // This class only has static methods, so it should not be constructed.
+  InternedNameTable() = delete;
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_INTERNED_NAME_TABLE_H
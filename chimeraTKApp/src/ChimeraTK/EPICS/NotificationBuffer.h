@@ -0,0 +1,499 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_NOTIFICATION_BUFFER_H
+#define CHIMERATK_EPICS_NOTIFICATION_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+
+extern "C" {
+#include <dbScan.h>
+} // extern "C"
+
+#include <ChimeraTK/VersionNumber.h>
+
+#include "PVSupport.h"
+#include "ensureScanIoRequest.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Base class of NotificationBuffer. This class keeps the statistics of a
+ * record's buffer, so that they can be reported without knowing the type of
+ * the values stored in the buffer.
+ *
+ * Each buffer is registered under the name of its record while it exists, so
+ * that report(...) can print the statistics of all records.
+ */
+class NotificationBufferBase {
+
+public:
+
+  /**
+   * Destructor. Removes this buffer from the list of buffers that are
+   * included in the report.
+   */
+  virtual ~NotificationBufferBase() noexcept;
+
+  /**
+   * Returns the number of bytes used by this buffer (including the entries).
+   */
+  virtual std::size_t getMemorySize() const noexcept = 0;
+
+  /**
+   * Returns the number of times that the queue of this buffer was full, so
+   * that the next notification had to wait until the record had processed a
+   * value. This is always zero for a buffer that only keeps the latest value.
+   */
+  std::size_t getOverflowCount() const noexcept {
+    return this->overflowCount.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the name of the record that uses this buffer.
+   */
+  char const *getRecordName() const noexcept {
+    return this->recordName;
+  }
+
+  /**
+   * Returns the number of values that have been replaced by a newer value
+   * before the record could process them. This is always zero for a queue.
+   */
+  std::size_t getSkippedCount() const noexcept {
+    return this->skippedCount.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Prints a report about the notification buffers of all records to stdout.
+   * The report always includes the totals. If the level is greater than
+   * zero, the records for which values were skipped or the queue overflowed
+   * are listed, too.
+   */
+  static void report(int level);
+
+protected:
+
+  /**
+   * Creates the base of a buffer for the specified record and registers it,
+   * so that it is included in the report. The record name must stay valid for
+   * the lifetime of the buffer.
+   */
+  NotificationBufferBase(char const *recordName);
+
+  std::atomic<std::size_t> overflowCount;
+
+  std::atomic<std::size_t> skippedCount;
+
+private:
+
+  char const *recordName;
+
+  // Delete copy constructors and assignment operators.
+  NotificationBufferBase(NotificationBufferBase const &) = delete;
+  NotificationBufferBase &operator=(NotificationBufferBase const &) = delete;
+
+};
+
+/**
+ * Buffer that is used by input records with the "latest" or "queue" option for
+ * passing values from the notify callback to the code processing the record.
+ *
+ * In the regular mode, the notify callback only acknowledges a notification
+ * (by calling the PV support's notifyFinished() method) after the record has
+ * been processed, so the next value can only be delivered after that. With a
+ * notification buffer, the notify callback stores the value in the buffer and
+ * acknowledges the notification right away (or at least as soon as there is
+ * space for the next value).
+ *
+ * There is only one producer (the notify callback, which is never called
+ * concurrently for the same PV support) and one consumer (the code processing
+ * the record, which is never run concurrently for the same record), so the
+ * implementations do not need any locks.
+ *
+ * The template parameter is the type of the value that is stored in the
+ * buffer.
+ */
+template<typename ValueType>
+class NotificationBuffer : public NotificationBufferBase {
+
+public:
+
+  /**
+   * Entry in the buffer. Each entry either contains a value and the
+   * corresponding version number or an exception.
+   */
+  struct Entry {
+
+    std::exception_ptr exception;
+    ValueType value;
+    VersionNumber versionNumber;
+
+  };
+
+  /**
+   * Creates the notification buffer for a record. If the "latest" option has
+   * been specified, a buffer that only keeps the latest value is created. If a
+   * queue size has been specified, a queue of that size is created. Otherwise,
+   * null is returned. The record name must stay valid for the lifetime of the
+   * buffer.
+   */
+  static std::unique_ptr<NotificationBuffer> create(
+      char const *recordName, bool latest, std::size_t queueSize);
+
+  /**
+   * Destructor.
+   */
+  virtual ~NotificationBuffer() noexcept {
+  }
+
+  /**
+   * Returns the entry that is written by the producer. After filling the
+   * entry, the producer has to call publish(...).
+   */
+  virtual Entry &getBackEntry() = 0;
+
+  /**
+   * Makes the back entry available to the consumer. Acknowledges the
+   * notification if there is space for the next value and requests the record
+   * to be processed if there is no pending request yet.
+   */
+  template<typename T>
+  void publish(PVSupport<T> &pvSupport, ::IOSCANPVT ioScanPvt) {
+    this->runActions(this->publishInternal(), pvSupport, ioScanPvt);
+  }
+
+  /**
+   * Takes the next entry from the buffer and passes it to the specified
+   * function. If the buffer is empty, the function is not called. After
+   * processing the entry, a deferred acknowledgement is sent and the record is
+   * processed again if there are more entries. This also happens when the
+   * function throws an exception.
+   */
+  template<typename T, typename ProcessEntry>
+  void process(PVSupport<T> &pvSupport, ::IOSCANPVT ioScanPvt,
+      ProcessEntry processEntry) {
+    auto entry = this->take();
+    if (!entry) {
+      return;
+    }
+    try {
+      processEntry(*entry);
+    } catch (...) {
+      this->runActions(this->finish(), pvSupport, ioScanPvt);
+      throw;
+    }
+    this->runActions(this->finish(), pvSupport, ioScanPvt);
+  }
+
+protected:
+
+  /**
+   * Creates a buffer for the specified record.
+   */
+  NotificationBuffer(char const *recordName)
+      : NotificationBufferBase(recordName) {
+  }
+
+  /**
+   * Actions that have to be taken after publishing or finishing an entry.
+   */
+  struct Actions {
+
+    /**
+     * The notification has to be acknowledged.
+     */
+    bool acknowledge;
+
+    /**
+     * The record has to be queued for processing.
+     */
+    bool requestProcessing;
+
+  };
+
+  /**
+   * Makes the back entry available to the consumer.
+   */
+  virtual Actions publishInternal() = 0;
+
+  /**
+   * Returns the next entry that has been published or null if there is none.
+   */
+  virtual Entry *take() = 0;
+
+  /**
+   * Signals that the entry returned by take() has been processed.
+   */
+  virtual Actions finish() = 0;
+
+private:
+
+  template<typename T>
+  void runActions(
+      Actions const &actions, PVSupport<T> &pvSupport, ::IOSCANPVT ioScanPvt) {
+    if (actions.acknowledge) {
+      pvSupport.notifyFinished();
+    }
+    if (actions.requestProcessing) {
+      ensureScanIoRequest(ioScanPvt);
+    }
+  }
+
+};
+
+/**
+ * Notification buffer that only keeps the latest value. If the next value
+ * arrives before the record has been processed, it replaces the earlier value,
+ * so the record always processes the newest value.
+ *
+ * The buffer is a triple buffer: The producer writes to the back entry and
+ * then exchanges it with the middle entry. The consumer exchanges the front
+ * entry with the middle entry if the middle entry contains a new value.
+ * Neither side ever has to wait for the other one.
+ */
+template<typename ValueType>
+class LatestValueBuffer : public NotificationBuffer<ValueType> {
+
+public:
+
+  using typename NotificationBuffer<ValueType>::Entry;
+
+  /**
+   * Creates an empty buffer for the specified record.
+   */
+  LatestValueBuffer(char const *recordName)
+      : NotificationBuffer<ValueType>(recordName), backIndex(2), frontIndex(0),
+        middleIndex(1), processingRequested(false) {
+  }
+
+  Entry &getBackEntry() override {
+    return this->entries[this->backIndex];
+  }
+
+  std::size_t getMemorySize() const noexcept override {
+    return sizeof(*this);
+  }
+
+protected:
+
+  using typename NotificationBuffer<ValueType>::Actions;
+
+  Actions publishInternal() override {
+    auto oldMiddleIndex =
+      this->middleIndex.exchange(this->backIndex | newValueFlag);
+    this->backIndex = oldMiddleIndex & indexMask;
+    if (oldMiddleIndex & newValueFlag) {
+      this->skippedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    // The value has been stored in the buffer, so we can always acknowledge
+    // the notification right away. If the record has already been queued and
+    // has not started processing yet, it is going to see the new value anyway.
+    return Actions{true, !this->processingRequested.exchange(true)};
+  }
+
+  Entry *take() override {
+    // We have to reset the flag before checking for a new value. Otherwise,
+    // the producer might publish a value after we checked, but before we reset
+    // the flag, and that value would not be processed until the next value
+    // arrives. Both operations use sequential consistency, so that they cannot
+    // be reordered.
+    this->processingRequested.store(false);
+    if (!(this->middleIndex.load() & newValueFlag)) {
+      return nullptr;
+    }
+    this->frontIndex = this->middleIndex.exchange(this->frontIndex) & indexMask;
+    return &this->entries[this->frontIndex];
+  }
+
+  Actions finish() override {
+    return Actions{false, false};
+  }
+
+private:
+
+  /**
+   * Flag that is set in the middle index when the middle entry contains a
+   * value that has not been taken by the consumer yet.
+   */
+  static constexpr unsigned newValueFlag = 4;
+
+  /**
+   * Mask for extracting the actual index from the middle index.
+   */
+  static constexpr unsigned indexMask = 3;
+
+  Entry entries[3];
+
+  // Only used by the producer.
+  unsigned backIndex;
+
+  // Only used by the consumer.
+  unsigned frontIndex;
+
+  std::atomic<unsigned> middleIndex;
+
+  std::atomic<bool> processingRequested;
+
+};
+
+/**
+ * Notification buffer that queues up to a fixed number of values, so that no
+ * value is lost when the record cannot keep up with the notifications for a
+ * short time.
+ *
+ * The queue is a ring buffer with a single producer and a single consumer. A
+ * notification is only acknowledged when there is space for the next value.
+ * When the queue is full, the acknowledgement is deferred until the record has
+ * processed the oldest value. This means that no value is ever dropped, but
+ * the delivery of notifications slows down to the rate at which the record is
+ * processed (like in the regular mode) when the queue overflows.
+ *
+ * All entries are allocated when the queue is created, so that the notify
+ * callback never has to allocate memory. Each entry only holds a pointer to
+ * array and string values (which are shared with the PV support), so an entry
+ * only needs a few dozen bytes, regardless of the size of the values.
+ */
+template<typename ValueType>
+class QueuedValueBuffer : public NotificationBuffer<ValueType> {
+
+public:
+
+  using typename NotificationBuffer<ValueType>::Entry;
+
+  /**
+   * Creates an empty queue for the specified record that can hold the
+   * specified number of entries.
+   */
+  QueuedValueBuffer(char const *recordName, std::size_t capacity)
+      : NotificationBuffer<ValueType>(recordName),
+        acknowledgementDeferred(false), capacity(capacity),
+        entries(new Entry[capacity]), processingRequested(false),
+        readPosition(0), writePosition(0) {
+  }
+
+  Entry &getBackEntry() override {
+    // The producer only gets the next value after the notification has been
+    // acknowledged, which only happens when there is space in the queue.
+    // However, when notifications are cancelled and enabled again, the PV
+    // support resets its state, so we might get a value even though the queue
+    // is full. In this case, we give the producer a separate entry and drop
+    // its value in publishInternal().
+    auto position = this->writePosition.load(std::memory_order_relaxed);
+    if (position - this->readPosition.load() >= this->capacity) {
+      return this->overflowEntry;
+    }
+    return this->entries[position % this->capacity];
+  }
+
+  std::size_t getMemorySize() const noexcept override {
+    return sizeof(*this) + this->capacity * sizeof(Entry);
+  }
+
+protected:
+
+  using typename NotificationBuffer<ValueType>::Actions;
+
+  Actions publishInternal() override {
+    auto position = this->writePosition.load(std::memory_order_relaxed);
+    if (position - this->readPosition.load() >= this->capacity) {
+      this->overflowCount.fetch_add(1, std::memory_order_relaxed);
+      this->overflowEntry = Entry();
+      return Actions{true, false};
+    }
+    ++position;
+    this->writePosition.store(position);
+    bool requestProcessing = !this->processingRequested.exchange(true);
+    if (position - this->readPosition.load() < this->capacity) {
+      return Actions{true, requestProcessing};
+    }
+    // The queue is full, so we can only acknowledge the notification when the
+    // consumer has taken an entry. We have to check again after setting the
+    // flag, because the consumer might have taken an entry before it could see
+    // the flag. Whoever resets the flag sends the acknowledgement.
+    this->overflowCount.fetch_add(1, std::memory_order_relaxed);
+    this->acknowledgementDeferred.store(true);
+    bool acknowledge =
+      position - this->readPosition.load() < this->capacity
+      && this->acknowledgementDeferred.exchange(false);
+    return Actions{acknowledge, requestProcessing};
+  }
+
+  Entry *take() override {
+    auto position = this->readPosition.load(std::memory_order_relaxed);
+    if (position == this->writePosition.load()) {
+      return nullptr;
+    }
+    return &this->entries[position % this->capacity];
+  }
+
+  Actions finish() override {
+    this->readPosition.store(
+      this->readPosition.load(std::memory_order_relaxed) + 1);
+    bool acknowledge = this->acknowledgementDeferred.exchange(false);
+    // We reset the flag and check whether there are more entries afterwards,
+    // so that an entry that is published concurrently is not missed. If the
+    // producer sees the reset flag, it requests the processing itself.
+    this->processingRequested.store(false);
+    bool requestProcessing =
+      this->readPosition.load(std::memory_order_relaxed)
+      != this->writePosition.load()
+      && !this->processingRequested.exchange(true);
+    return Actions{acknowledge, requestProcessing};
+  }
+
+private:
+
+  std::atomic<bool> acknowledgementDeferred;
+
+  std::size_t const capacity;
+
+  std::unique_ptr<Entry[]> entries;
+
+  Entry overflowEntry;
+
+  std::atomic<bool> processingRequested;
+
+  std::atomic<std::size_t> readPosition;
+
+  std::atomic<std::size_t> writePosition;
+
+};
+
+template<typename ValueType>
+std::unique_ptr<NotificationBuffer<ValueType>> NotificationBuffer<ValueType>::create(
+    char const *recordName, bool latest, std::size_t queueSize) {
+  if (latest) {
+    return std::make_unique<LatestValueBuffer<ValueType>>(recordName);
+  } else if (queueSize) {
+    return std::make_unique<QueuedValueBuffer<ValueType>>(
+      recordName, queueSize);
+  } else {
+    return std::unique_ptr<NotificationBuffer<ValueType>>();
+  }
+}
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_NOTIFICATION_BUFFER_H
@@ -20,15 +20,45 @@
 #ifndef CHIMERATK_EPICS_PV_PROVIDER_H
 #define CHIMERATK_EPICS_PV_PROVIDER_H
 
+#include <cstddef>
 #include <memory>
 #include <stdexcept>
+#include <string>
 #include <typeinfo>
+#include <vector>
 
 #include "PVSupport.h"
 
 namespace ChimeraTK {
 namespace EPICS {
 
+namespace detail {
+
+/**
+ * Returns the number of bytes that are allocated by the specified value
+ * vector.
+ */
+template<typename T>
+inline std::size_t valueMemorySize(std::vector<T> const &value) {
+  return value.capacity() * sizeof(T);
+}
+
+/**
+ * Returns the number of bytes that are allocated by the specified value
+ * vector. For strings, this includes the memory allocated by each string
+ * (short strings may not actually need this memory, so the result is a bit
+ * too large in this case).
+ */
+inline std::size_t valueMemorySize(std::vector<std::string> const &value) {
+  std::size_t size = value.capacity() * sizeof(std::string);
+  for (auto const &element : value) {
+    size += element.capacity();
+  }
+  return size;
+}
+
+} // namespace detail
+
 /**
  * Interface for types that can provider PVSupport objects.
  * There are two implementations of this interface: The
@@ -43,6 +73,56 @@ class PVProvider {
 
 public:
 
+  /**
+   * Memory used by a single process variable.
+   */
+  struct ProcessVariableMemoryUsage {
+
+    /**
+     * Name of the process variable.
+     */
+    std::string name;
+
+    /**
+     * Number of bytes held by the PV supports for values of the process
+     * variable (e.g. the last value that has been read or written).
+     */
+    std::size_t valueBytes;
+
+    /**
+     * Number of bytes held by the underlying transport (the ProcessArray or
+     * the register accessors).
+     */
+    std::size_t transportBytes;
+
+    /**
+     * Number of notifications that have been delivered to records, but have
+     * not been finished yet. Each of them may keep an additional copy of the
+     * value alive.
+     */
+    std::size_t pendingNotifications;
+
+  };
+
+  /**
+   * Memory used by a PV provider.
+   */
+  struct MemoryUsage {
+
+    /**
+     * Memory used by each of the process variables for which PV supports have
+     * been created.
+     */
+    std::vector<ProcessVariableMemoryUsage> processVariables;
+
+    /**
+     * Number of tasks (e.g. I/O operations or notifications) that have been
+     * queued, but have not been run yet.
+     */
+    std::size_t queuedTasks;
+
+  };
+
   /**
    * Type of a shared pointer to this type.
    */
@@ -64,6 +144,22 @@ public:
   typename PVSupport<ElementType>::SharedPtr createPVSupport(
       std::string const &processVariableName);
 
+  /**
+   * Creates and returns a process-variable support object that provides the
+   * contents of the flight recorder for the specified process variable
+   * instead of the process variable's value. This is used for records that
+   * specify the "flightrecorder" address option.
+   *
+   * The default implementation throws an exception because only the
+   * ControlSystemAdapterPVProvider supports flight recorders.
+   */
+  virtual PVSupportBase::SharedPtr createFlightRecorderPVSupport(
+      std::string const &processVariableName,
+      std::type_info const &elementType) {
+    throw std::invalid_argument(
+      "Flight recorders are only supported for applications, not for devices.");
+  }
+
   /**
    * Finalizes the initialization of this PV provider.
    *
@@ -77,6 +173,21 @@ public:
   virtual void finalizeInitialization() {
   }
 
+  /**
+   * Starts processing all pending initial value requests.
+   *
+   * Implementations of PVSupport::initialValueAsync() may collect the requests
+   * instead of processing them immediately, so that the initial values of many
+   * process variables can be retrieved in a single operation. Code calling
+   * PVSupport::initialValueAsync() has to call this method on the PV provider
+   * that created the respective PV supports before waiting for any of the
+   * returned futures.
+   *
+   * The default implementation does nothing.
+   */
+  virtual void flushInitialValueRequests() {
+  }
+
   /**
    * Returns the default type for the specified process variable. The default
    * type is always compatible with the process variable. This means that it is
@@ -91,6 +202,26 @@ public:
   virtual std::type_info const &getDefaultType(
       std::string const &processVariableName) = 0;
 
+  /**
+   * Returns information about the memory used by this PV provider. This is
+   * used by the chimeraTKMemoryReport IOC shell command.
+   *
+   * The default implementation returns an empty result.
+   */
+  virtual MemoryUsage getMemoryUsage() {
+    return MemoryUsage{{}, 0};
+  }
+
+  /**
+   * Prints information about the state of this PV provider to stdout. The
+   * higher the specified level, the more details are printed. This is used by
+   * the chimeraTKReport IOC shell command.
+   *
+   * The default implementation does not print anything.
+   */
+  virtual void report(int level) {
+  }
+
 protected:
 
   /**
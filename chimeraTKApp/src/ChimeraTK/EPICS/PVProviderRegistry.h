@@ -20,6 +20,7 @@
 #ifndef CHIMERATK_EPICS_PV_PROVIDER_REGISTRY_H
 #define CHIMERATK_EPICS_PV_PROVIDER_REGISTRY_H
 
+#include <cstddef>
 #include <mutex>
 #include <unordered_map>
 
@@ -58,6 +59,15 @@ public:
    */
   static PVProvider::SharedPtr getPVProvider(std::string const & name);
 
+  /**
+   * Prints information about the memory used by all registered PV providers and
+   * by the buffers of the records that use them to stdout. For each PV
+   * provider, the totals are printed. In addition to that, the process
+   * variables using the most memory are listed. The parameter specifies the
+   * max. number of process variables that are listed.
+   */
+  static void memoryReport(std::size_t maxProcessVariables);
+
   /**
    * Registers a ChimeraTK Control System Adapter application. This method has
    * to be called for each application that shall be used with this device
@@ -107,6 +117,12 @@ public:
       std::string const &deviceNameAlias,
       std::size_t numberOfIoThreads);
 
+  /**
+   * Prints information about the state of all registered PV providers to
+   * stdout. The higher the specified level, the more details are printed.
+   */
+  static void report(int level);
+
 private:
 
   static bool finalizeInitializationCalled;
@@ -21,10 +21,13 @@
 #ifndef CHIMERATK_EPICS_PV_SUPPORT_H
 #define CHIMERATK_EPICS_PV_SUPPORT_H
 
+#include <chrono>
 #include <cstddef>
 #include <exception>
 #include <functional>
+#include <future>
 #include <memory>
+#include <stdexcept>
 #include <tuple>
 #include <vector>
 
@@ -76,6 +79,29 @@ public:
    */
   virtual std::size_t getNumberOfElements() = 0;
 
+  /**
+   * Sets the name of the record that uses this PV support. The name is only
+   * used in diagnostic messages. The string must stay valid for the whole
+   * lifetime of this PV support. The default implementation does nothing.
+   */
+  virtual void setRecordName(char const *recordName) {
+  }
+
+  /**
+   * Enables the read-through cache for this PV support. When the cache is
+   * enabled, read(...) may return a value that has been read earlier (possibly
+   * by a different PV support for the same process variable), as long as that
+   * value is not older than the specified max. age. This is used for records
+   * that specify the "maxage" address option.
+   *
+   * The default implementation throws an exception because only the PV
+   * supports of the DeviceAccessPVProvider support a read-through cache.
+   */
+  virtual void setReadCacheMaxAge(std::chrono::milliseconds maxAge) {
+    throw std::invalid_argument(
+      "The maxage option is only supported for devices, not for applications.");
+  }
+
 protected:
 
   /**
@@ -203,6 +229,34 @@ public:
    */
   virtual std::tuple<Value, VersionNumber> initialValue();
 
+  /**
+   * Starts retrieving the initial value of the process variable and returns a
+   * future that provides the result of initialValue() once it is available.
+   *
+   * This method is used when initial values are prefetched for many records
+   * during IOC startup. Implementations that have to perform I/O for getting
+   * the initial value should override this method so that the I/O operation is
+   * run asynchronously. The default implementation simply calls initialValue()
+   * in the calling thread.
+   *
+   * Implementations may defer the request until
+   * PVProvider::flushInitialValueRequests() is called on the PV provider that
+   * created this PV support, so that method must be called before waiting for
+   * the returned future.
+   *
+   * No other method of this PV support must be called before the returned
+   * future is ready.
+   */
+  virtual std::future<std::tuple<Value, VersionNumber>> initialValueAsync() {
+    std::promise<std::tuple<Value, VersionNumber>> promise;
+    try {
+      promise.set_value(this->initialValue());
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+    return promise.get_future();
+  }
+
   /**
    * Requests notifications. The successCallback is called every time there is
    * a new value available. The errorCallback is called when there is an error.
@@ -0,0 +1,172 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_PARALLEL_COPY_ENGINE_H
+#define CHIMERATK_EPICS_PARALLEL_COPY_ENGINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "ThreadPoolExecutor.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Engine for copying and converting very large arrays with several threads.
+ *
+ * Transfers below the configured threshold are processed by the calling
+ * thread. Larger transfers are split into chunks, which are processed by a
+ * small pool of helper threads and the calling thread, so that the time needed
+ * for the transfer is limited by the memory bandwidth and not by the speed of
+ * a single core. The helper threads are started by configure(...) and use the
+ * thread settings of the "copy" thread class, so they can be pinned to the
+ * CPUs of the NUMA node that holds the buffers.
+ *
+ * By default, there are no helper threads, so all transfers are processed by
+ * the calling thread.
+ */
+class ParallelCopyEngine {
+
+public:
+
+  /**
+   * Sets the number of helper threads and the min. size (in bytes) of a
+   * transfer that is split into chunks. Zero helper threads disable the
+   * splitting of transfers. Transfers that are running while the helper
+   * threads are replaced are finished with the old threads.
+   */
+  static void configure(std::size_t numberOfThreads, std::size_t threshold);
+
+  /**
+   * Copies size bytes from source to destination. The two memory regions must
+   * not overlap.
+   */
+  static void copy(
+      void *destination, void const *source, std::size_t size);
+
+  /**
+   * Calls the specified function for consecutive ranges [begin, end) of the
+   * element indices from zero to count. The element size (in bytes) is used
+   * for deciding whether the transfer is split and for aligning the ranges
+   * to memory pages. The function may be called concurrently from several
+   * threads, but the ranges never overlap. This method returns after the
+   * function has returned for all ranges.
+   */
+  template<typename Function>
+  static void forEachChunk(
+      std::size_t count, std::size_t elementSize, Function const &function);
+
+  /**
+   * Prints the configuration and statistics of this engine.
+   */
+  static void report();
+
+private:
+
+  /**
+   * Size (in bytes) to which the boundaries of the chunks are aligned, so that
+   * no two threads write to the same memory page.
+   */
+  static constexpr std::size_t chunkAlignment = 4096;
+
+  /**
+   * Number of transfers that have been split into chunks.
+   */
+  static std::atomic<std::size_t> parallelTransferCount;
+
+  /**
+   * Total size (in bytes) of the transfers that have been split into chunks.
+   */
+  static std::atomic<std::size_t> parallelTransferSize;
+
+  /**
+   * Pool of helper threads. This pointer is null if there are no helper
+   * threads. Access to this pointer must be protected by holding a lock on the
+   * poolMutex.
+   */
+  static std::shared_ptr<ThreadPoolExecutor> pool;
+
+  /**
+   * Mutex protecting the pool pointer.
+   */
+  static std::mutex poolMutex;
+
+  /**
+   * Number of helper threads in the pool.
+   */
+  static std::atomic<std::size_t> poolSize;
+
+  /**
+   * Min. size (in bytes) of a transfer that is split into chunks.
+   */
+  static std::atomic<std::size_t> threshold;
+
+  /**
+   * Returns the pool of helper threads if a transfer of the specified size
+   * should be split into chunks and null otherwise.
+   */
+  static std::shared_ptr<ThreadPoolExecutor> getPoolForTransfer(
+      std::size_t size);
+
+  /**
+   * Runs the specified task for each chunk index from zero to
+   * numberOfChunks. The task for chunk zero is run by the calling thread, the
+   * other tasks are run by the helper threads. This method only returns after
+   * all tasks have finished.
+   */
+  static void runChunks(ThreadPoolExecutor &pool, std::size_t numberOfChunks,
+      std::function<void(std::size_t)> const &chunkTask);
+
+};
+
+template<typename Function>
+void ParallelCopyEngine::forEachChunk(
+    std::size_t count, std::size_t elementSize, Function const &function) {
+  auto pool = getPoolForTransfer(count * elementSize);
+  if (!pool) {
+    function(std::size_t(0), count);
+    return;
+  }
+  // The calling thread processes one of the chunks, so there is one chunk
+  // more than there are helper threads.
+  std::size_t numberOfChunks = poolSize + 1;
+  std::size_t granularity =
+    std::max(std::size_t(1), chunkAlignment / std::max(std::size_t(1), elementSize));
+  std::size_t chunkSize = (count + numberOfChunks - 1) / numberOfChunks;
+  chunkSize = (chunkSize + granularity - 1) / granularity * granularity;
+  ++parallelTransferCount;
+  parallelTransferSize += count * elementSize;
+  runChunks(*pool, numberOfChunks, [count, chunkSize, &function](std::size_t chunk){
+    auto begin = std::min(count, chunk * chunkSize);
+    auto end = std::min(count, begin + chunkSize);
+    if (begin < end) {
+      function(begin, end);
+    }
+  });
+}
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_PARALLEL_COPY_ENGINE_H
@@ -21,12 +21,17 @@
 #ifndef CHIMERATK_EPICS_RECORD_ADDRESS_H
 #define CHIMERATK_EPICS_RECORD_ADDRESS_H
 
+#include <chrono>
+#include <cstdint>
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
 
 #include <dbLink.h>
 
+#include "InternedNameTable.h"
+#include "Reduction.h"
+
 namespace ChimeraTK {
 namespace EPICS {
 
@@ -37,32 +42,82 @@ class RecordAddress {
 
 public:
 
+  /**
+   * Tag type for selecting the constructor that takes names which have
+   * already been interned.
+   */
+  struct InternedNames {
+  };
+
   /**
    * Creates a record address using the specified parameters.
    *
    * Typically, this constructor is not called directly. Instead, the
    * parse(::DBLINK address) method is used for parsing the content of a
    * record's link field and generating an address object from it.
+   *
+   * The names are interned using the InternedNameTable, so the record address
+   * does not have to keep its own copy of them.
    */
   inline RecordAddress(
       std::string const &appOrDevName,
       std::string const &pvName,
       std::type_info const &valueType, bool valueTypeValid,
-      bool noBidirectional)
-      : appOrDevName(appOrDevName), noBidirectional(noBidirectional),
-        pvName(pvName), valueType(valueType), valueTypeValid(valueTypeValid) {
+      bool noBidirectional, bool noInitialRead, bool latest,
+      std::uint32_t queueSize, bool flightRecorder,
+      std::uint32_t historySize, std::chrono::milliseconds historyInterval,
+      Reduction reduction, std::uint32_t decimationFactor,
+      bool decimationAverage, bool readCache,
+      std::chrono::milliseconds readCacheMaxAge)
+      : RecordAddress(InternedNames(),
+          InternedNameTable::intern(appOrDevName),
+          InternedNameTable::intern(pvName), valueType, valueTypeValid,
+          noBidirectional, noInitialRead, latest, queueSize, flightRecorder,
+          historySize, historyInterval, reduction, decimationFactor,
+          decimationAverage, readCache, readCacheMaxAge) {
+  }
+
+  /**
+   * Creates a record address using the specified parameters. Unlike the
+   * other constructor, this constructor expects that the names have already
+   * been interned using the InternedNameTable and stores references to them
+   * directly. This is used by the parser, which interns the names itself.
+   */
+  inline RecordAddress(InternedNames,
+      std::string const &appOrDevName,
+      std::string const &pvName,
+      std::type_info const &valueType, bool valueTypeValid,
+      bool noBidirectional, bool noInitialRead, bool latest,
+      std::uint32_t queueSize, bool flightRecorder,
+      std::uint32_t historySize, std::chrono::milliseconds historyInterval,
+      Reduction reduction, std::uint32_t decimationFactor,
+      bool decimationAverage, bool readCache,
+      std::chrono::milliseconds readCacheMaxAge)
+      : appOrDevName(appOrDevName),
+        decimationAverage(decimationAverage),
+        decimationFactor(decimationFactor), flightRecorder(flightRecorder), historyInterval(historyInterval),
+        historySize(historySize), latest(latest),
+        noBidirectional(noBidirectional),
+        noInitialRead(noInitialRead),
+        pvName(pvName), queueSize(queueSize),
+        readCache(readCache), readCacheMaxAge(readCacheMaxAge),
+        reduction(reduction),
+        valueType(valueType), valueTypeValid(valueTypeValid) {
   }
 
   /**
    * Returns the application or device name. This is the name used when looking
-   * up the PVProvider.
+   * up the PVProvider. The returned reference refers to the interned name, so
+   * it stays valid after this record address has been destroyed.
    */
   inline std::string const &getApplicationOrDeviceName() const {
     return appOrDevName;
   }
 
   /**
-   * Returns the name of the process variable.
+   * Returns the name of the process variable. The returned reference refers to
+   * the interned name, so it stays valid after this record address has been
+   * destroyed.
    */
   inline std::string const &getProcessVariableName() const {
     return pvName;
@@ -80,6 +135,69 @@ public:
     return valueType;
   }
 
+  /**
+   * Returns the factor specified with the "decimate" option. If this option is
+   * set, the record only uses every n-th element of the process variable's
+   * value (or the average of each block of n elements if isDecimationAverage()
+   * returns true). Returns zero if the option is not set.
+   */
+  inline std::uint32_t getDecimationFactor() const {
+    return decimationFactor;
+  }
+
+  /**
+   * Tells whether the "avg" flag is set. If this flag is set, decimation uses
+   * the average of each block of elements instead of only its first element.
+   */
+  inline bool isDecimationAverage() const {
+    return decimationAverage;
+  }
+
+  /**
+   * Returns the number of values specified with the "history" option. If this
+   * option is set, the record uses an array with the most recent values of
+   * the (scalar) process variable instead of its value. Returns zero if the
+   * option is not set.
+   */
+  inline std::uint32_t getHistorySize() const {
+    return historySize;
+  }
+
+  /**
+   * Returns the min. time between two updates of the history, as specified
+   * with the "interval" option. Returns zero if the option is not set.
+   */
+  inline std::chrono::milliseconds getHistoryInterval() const {
+    return historyInterval;
+  }
+
+  /**
+   * Returns the max. age specified with the "maxage" option. Only meaningful
+   * if hasReadCacheMaxAge() returns true.
+   */
+  inline std::chrono::milliseconds getReadCacheMaxAge() const {
+    return readCacheMaxAge;
+  }
+
+  /**
+   * Tells whether the "maxage" option is set. If this option is set, reads
+   * may return a value that has been read earlier (possibly for a different
+   * record), as long as it is not older than the max. age.
+   */
+  inline bool hasReadCacheMaxAge() const {
+    return readCache;
+  }
+
+  /**
+   * Returns the reduction specified with the "reduce" option. If this option
+   * is set, the record uses the result of the reduction of the process
+   * variable's elements (as a double) instead of the process variable's value.
+   * Returns Reduction::NONE if the option is not set.
+   */
+  inline Reduction getReduction() const {
+    return reduction;
+  }
+
   /**
    * Tells whether this record address specifies a value type.
    */
@@ -87,6 +205,34 @@ public:
     return valueTypeValid;
   }
 
+  /**
+   * Tells whether the "flightrecorder" flag is set. If this flag is set, the
+   * record uses the contents of the process variable's flight recorder
+   * instead of the process variable's value.
+   */
+  inline bool isFlightRecorder() const {
+    return flightRecorder;
+  }
+
+  /**
+   * Tells whether the "latest" flag is set. If this flag is set, input records
+   * in I/O Intr mode shall only process the latest value of the process
+   * variable, skipping intermediate values if the record cannot keep up.
+   */
+  inline bool isLatest() const {
+    return latest;
+  }
+
+  /**
+   * Returns the queue size specified with the "queue" option. If this option
+   * is set, input records in I/O Intr mode shall queue up to the specified
+   * number of values, so that no value is lost when the record cannot keep up
+   * for a short time. Returns zero if the option is not set.
+   */
+  inline std::uint32_t getQueueSize() const {
+    return queueSize;
+  }
+
   /**
    * Tells whether the "nobidirectional" flag is set. If this flag is set,
    * output records shall not be updated when the value changes inside the
@@ -96,6 +242,15 @@ public:
     return noBidirectional;
   }
 
+  /**
+   * Tells whether the "noinitialread" flag is set. If this flag is set, output
+   * records shall not read the current value of the process variable when
+   * they are initialized.
+   */
+  inline bool isNoInitialRead() const {
+    return noInitialRead;
+  }
+
   /**
    * Parses the contents of a record's link field and returns the corresponding
    * address object.
@@ -104,11 +259,33 @@ public:
    */
   static RecordAddress parse(::DBLINK const &addressField);
 
+  /**
+   * Parses the string representation of a record's link field and returns the
+   * corresponding address object. The string must start with the "@"
+   * character that marks an INST_IO link.
+   *
+   * This method is used when the address has to be parsed before the links of
+   * the records have been initialized, where only the string representation
+   * provided by the static database access library is available.
+   */
+  static RecordAddress parse(char const *linkString);
+
 private:
 
-  std::string const appOrDevName;
+  std::string const &appOrDevName;
+  bool decimationAverage;
+  std::uint32_t decimationFactor;
+  bool flightRecorder;
+  std::chrono::milliseconds historyInterval;
+  std::uint32_t historySize;
+  bool latest;
   bool noBidirectional;
-  std::string const pvName;
+  bool noInitialRead;
+  std::string const &pvName;
+  std::uint32_t queueSize;
+  bool readCache;
+  std::chrono::milliseconds readCacheMaxAge;
+  Reduction reduction;
   std::type_info const &valueType;
   bool const valueTypeValid;
 
@@ -0,0 +1,156 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_RECORD_BUFFER_ALLOCATOR_H
+#define CHIMERATK_EPICS_RECORD_BUFFER_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Allocator for the value buffers of array records.
+ *
+ * All buffers are aligned to a cache line. Large buffers can be backed by huge
+ * pages, which reduces the number of TLB misses when copying multi-megabyte
+ * waveforms. Records live until the IOC is shut down, so the buffers are never
+ * freed.
+ */
+class RecordBufferAllocator {
+
+public:
+
+  /**
+   * Way in which huge pages are used for large buffers.
+   */
+  enum class HugePageMode {
+
+    /**
+     * Huge pages are not used.
+     */
+    none,
+
+    /**
+     * Buffers are aligned to the huge page size, and the kernel is advised to
+     * use transparent huge pages for them.
+     */
+    transparent,
+
+    /**
+     * Buffers are mapped from the pool of huge pages that has been reserved
+     * by the administrator (hugetlbfs). If no huge pages are available, the
+     * transparent mode is used as a fallback.
+     */
+    hugetlb
+
+  };
+
+  /**
+   * Allocates a buffer of the specified size (in bytes). The buffer is
+   * zero-initialized and aligned to at least 64 bytes. Throws an exception if
+   * the memory cannot be allocated.
+   */
+  static void *allocate(std::size_t size);
+
+  /**
+   * Prints statistics about the buffers that have been allocated so far.
+   */
+  static void report();
+
+  /**
+   * Sets the policy for using huge pages. Buffers with a size of at least
+   * threshold bytes use huge pages according to the specified mode. A
+   * threshold of zero disables the use of huge pages.
+   *
+   * If prefault is true, buffers mapped from the huge page pool are populated
+   * when they are allocated, so that the first access by the record does not
+   * cause a page fault. Other buffers are always touched when they are
+   * zero-initialized, so this flag does not affect them.
+   *
+   * The policy only affects buffers allocated after calling this method, so it
+   * has to be set before the records are initialized.
+   */
+  static void setHugePagePolicy(
+      std::size_t threshold, HugePageMode mode, bool prefault);
+
+private:
+
+  /**
+   * Number of buffers that have been allocated from the regular heap.
+   */
+  static std::atomic<std::size_t> heapBufferCount;
+
+  /**
+   * Total size (in bytes) of the buffers that have been allocated from the
+   * regular heap.
+   */
+  static std::atomic<std::size_t> heapBufferSize;
+
+  /**
+   * Mode in which huge pages are used for large buffers.
+   */
+  static std::atomic<HugePageMode> hugePageMode;
+
+  /**
+   * Min. size (in bytes) of a buffer that uses huge pages. Zero disables the
+   * use of huge pages.
+   */
+  static std::atomic<std::size_t> hugePageThreshold;
+
+  /**
+   * Number of buffers that should have been mapped from the huge page pool,
+   * but used transparent huge pages instead because the mapping failed.
+   */
+  static std::atomic<std::size_t> hugetlbFallbackCount;
+
+  /**
+   * Number of buffers that have been mapped from the huge page pool.
+   */
+  static std::atomic<std::size_t> hugetlbBufferCount;
+
+  /**
+   * Total size (in bytes) of the buffers that have been mapped from the huge
+   * page pool.
+   */
+  static std::atomic<std::size_t> hugetlbBufferSize;
+
+  /**
+   * Flag indicating whether buffers mapped from the huge page pool are
+   * populated when they are allocated.
+   */
+  static std::atomic<bool> prefault;
+
+  /**
+   * Number of buffers that use transparent huge pages.
+   */
+  static std::atomic<std::size_t> transparentBufferCount;
+
+  /**
+   * Total size (in bytes) of the buffers that use transparent huge pages.
+   */
+  static std::atomic<std::size_t> transparentBufferSize;
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_RECORD_BUFFER_ALLOCATOR_H
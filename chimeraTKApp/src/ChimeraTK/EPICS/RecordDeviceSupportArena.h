@@ -0,0 +1,212 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_RECORD_DEVICE_SUPPORT_ARENA_H
+#define CHIMERATK_EPICS_RECORD_DEVICE_SUPPORT_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Arena from which the device support objects of a certain type are allocated.
+ *
+ * Allocating each device support object separately on the heap scatters a
+ * large number of small objects across memory. This arena instead allocates
+ * the objects from slabs that each hold many of them. Ideally, reserve(...) is
+ * called before the records are initialized, so that all device support
+ * objects of one type end up in a single, contiguous slab. The arena only
+ * changes where the objects are placed, not their size.
+ *
+ * The template parameter is the type of the device support objects. The
+ * objects are never destroyed (a record device support lives until the
+ * process exits), so the only way to give back memory is deallocate(...),
+ * which is intended for the case where the constructor throws an exception.
+ * All methods are safe for concurrent use by multiple threads.
+ */
+template<typename T>
+class RecordDeviceSupportArena {
+
+public:
+
+  /**
+   * Statistics about the memory used by the arena.
+   */
+  struct Statistics {
+
+    /**
+     * Total number of objects that fit into the slabs allocated so far.
+     */
+    std::size_t capacity;
+
+    /**
+     * Number of slabs that have been allocated.
+     */
+    std::size_t numberOfSlabs;
+
+    /**
+     * Size of each object in bytes.
+     */
+    std::size_t objectSize;
+
+    /**
+     * Number of objects that are currently allocated.
+     */
+    std::size_t used;
+
+  };
+
+  /**
+   * Returns memory for a single object. The object must be constructed with
+   * placement new. If the slabs allocated so far are full, a new slab is
+   * allocated.
+   */
+  static void *allocate() {
+    std::lock_guard<std::mutex> lock(RecordDeviceSupportArena::mutex);
+    if (!RecordDeviceSupportArena::freeSlots.empty()) {
+      auto slot = RecordDeviceSupportArena::freeSlots.back();
+      RecordDeviceSupportArena::freeSlots.pop_back();
+      ++RecordDeviceSupportArena::used;
+      return slot;
+    }
+    if (RecordDeviceSupportArena::slabs.empty()
+        || RecordDeviceSupportArena::nextSlotIndex
+        == RecordDeviceSupportArena::slabs.back().size) {
+      // If no space has been reserved, we grow the arena in steps that are
+      // large enough to keep the number of slabs small.
+      RecordDeviceSupportArena::addSlab(std::max(
+        RecordDeviceSupportArena::capacity / 2, defaultSlabSize));
+    }
+    ++RecordDeviceSupportArena::used;
+    return &RecordDeviceSupportArena::slabs.back().slots[
+      RecordDeviceSupportArena::nextSlotIndex++];
+  }
+
+  /**
+   * Gives back the memory for an object that has been returned by
+   * allocate(). The object must already have been destroyed (or never have
+   * been constructed successfully).
+   */
+  static void deallocate(void *slot) {
+    std::lock_guard<std::mutex> lock(RecordDeviceSupportArena::mutex);
+    RecordDeviceSupportArena::freeSlots.push_back(static_cast<Slot *>(slot));
+    --RecordDeviceSupportArena::used;
+  }
+
+  /**
+   * Returns statistics about the memory used by this arena.
+   */
+  static Statistics getStatistics() {
+    std::lock_guard<std::mutex> lock(RecordDeviceSupportArena::mutex);
+    return Statistics{RecordDeviceSupportArena::capacity,
+      RecordDeviceSupportArena::slabs.size(), sizeof(T),
+      RecordDeviceSupportArena::used};
+  }
+
+  /**
+   * Ensures that the specified number of objects can be allocated without
+   * having to allocate another slab. If there is not enough space left in
+   * the current slab, a new slab that is large enough for all these objects
+   * is allocated.
+   */
+  static void reserve(std::size_t numberOfObjects) {
+    std::lock_guard<std::mutex> lock(RecordDeviceSupportArena::mutex);
+    std::size_t available = RecordDeviceSupportArena::freeSlots.size();
+    if (!RecordDeviceSupportArena::slabs.empty()) {
+      available += RecordDeviceSupportArena::slabs.back().size
+        - RecordDeviceSupportArena::nextSlotIndex;
+    }
+    if (available < numberOfObjects) {
+      RecordDeviceSupportArena::addSlab(numberOfObjects);
+    }
+  }
+
+private:
+
+  /**
+   * Uninitialized memory for a single object.
+   */
+  using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+  /**
+   * Contiguous block of memory holding a number of slots.
+   */
+  struct Slab {
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t size;
+
+  };
+
+  /**
+   * Number of objects in a slab that is allocated without the space having
+   * been reserved explicitly.
+   */
+  static constexpr std::size_t defaultSlabSize = 64;
+
+  static std::size_t capacity;
+  static std::vector<Slot *> freeSlots;
+  static std::mutex mutex;
+  static std::size_t nextSlotIndex;
+  static std::vector<Slab> slabs;
+  static std::size_t used;
+
+  // This class only has static methods, so it should not be constructed.
+  RecordDeviceSupportArena() = delete;
+
+  /**
+   * Allocates a new slab with the specified number of slots. Any space left
+   * in the previous slab is not used any longer. This method must only be
+   * called while holding a lock on the mutex.
+   */
+  static void addSlab(std::size_t size) {
+    RecordDeviceSupportArena::slabs.push_back(
+      Slab{std::unique_ptr<Slot[]>(new Slot[size]), size});
+    RecordDeviceSupportArena::capacity += size;
+    RecordDeviceSupportArena::nextSlotIndex = 0;
+  }
+
+};
+
+// Static member variables need an instance...
+template<typename T>
+constexpr std::size_t RecordDeviceSupportArena<T>::defaultSlabSize;
+template<typename T>
+std::size_t RecordDeviceSupportArena<T>::capacity = 0;
+template<typename T>
+std::vector<typename RecordDeviceSupportArena<T>::Slot *> RecordDeviceSupportArena<T>::freeSlots;
+template<typename T>
+std::mutex RecordDeviceSupportArena<T>::mutex;
+template<typename T>
+std::size_t RecordDeviceSupportArena<T>::nextSlotIndex = 0;
+template<typename T>
+std::vector<typename RecordDeviceSupportArena<T>::Slab> RecordDeviceSupportArena<T>::slabs;
+template<typename T>
+std::size_t RecordDeviceSupportArena<T>::used = 0;
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_RECORD_DEVICE_SUPPORT_ARENA_H
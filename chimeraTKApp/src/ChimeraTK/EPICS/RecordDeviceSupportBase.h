@@ -20,12 +20,26 @@
 #ifndef CHIMERATK_EPICS_RECORD_DEVICE_SUPPORT_BASE_H
 #define CHIMERATK_EPICS_RECORD_DEVICE_SUPPORT_BASE_H
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <tuple>
 #include <typeinfo>
+#include <utility>
 
+extern "C" {
+#include <dbCommon.h>
+#include <dbLink.h>
+} // extern "C"
+
+#include "DecimatingPVSupport.h"
+#include "HistoryPVSupport.h"
 #include "PVProviderRegistry.h"
 #include "RecordAddress.h"
+#include "ReductionPVSupport.h"
+#include "RecordLinkPreResolver.h"
 
 namespace ChimeraTK {
 namespace EPICS {
@@ -43,21 +57,107 @@ public:
    * process-variable name, and the value type.
    */
   RecordDeviceSupportBase(RecordAddress const & address)
-      : noBidirectional(address.isNoBidirectional()),
-        pvName(address.getProcessVariableName()),
-        pvProvider(PVProviderRegistry::getPVProvider(
-          address.getApplicationOrDeviceName())),
-        pvSupport(
-          callForValueTypeInternal<CallCreatePVSupport>(
-            (address.hasValueType() ? address.getValueType()
-              : pvProvider->getDefaultType(pvName)),
-            this)),
-        valueType(address.hasValueType() ? address.getValueType()
-          : pvProvider->getDefaultType(pvName)) {
+      : RecordDeviceSupportBase(resolveRecordLink(address)) {
+  }
+
+  /**
+   * Constructor. Takes a pointer to the record's data-structure and a reference
+   * to the record's link field (typically INP or OUT). If the link has been
+   * resolved by the RecordLinkPreResolver, the resolved link is used.
+   * Otherwise, the contents of the link field are parsed and resolved now.
+   */
+  RecordDeviceSupportBase(void const *record, ::DBLINK const &linkField)
+      : RecordDeviceSupportBase(
+          RecordLinkPreResolver::takeOrResolve(record, linkField)) {
+    // All record types start with the fields of dbCommon, so we can get the
+    // record name without knowing the actual record type.
+    this->pvSupport->setRecordName(
+      static_cast<::dbCommon const *>(record)->name);
+  }
+
+  /**
+   * Starts prefetching the initial value for the specified link. The initial
+   * value is stored in the link, so that it is used when the link is passed to
+   * the constructor.
+   */
+  static void prefetchInitialValue(ResolvedRecordLink &link) {
+    link.initialValue = callForValueTypeInternal<CallPrefetchInitialValue>(
+      link.valueType, link.pvSupport.get());
+  }
+
+  /**
+   * Resolves the specified record address. This looks up the PV provider,
+   * determines the value type and creates the PV support.
+   */
+  static ResolvedRecordLink resolveRecordLink(RecordAddress const &address) {
+    auto pvProvider = PVProviderRegistry::getPVProvider(
+      address.getApplicationOrDeviceName());
+    std::type_info const &pvValueType(
+      address.hasValueType() ? address.getValueType()
+      : pvProvider->getDefaultType(address.getProcessVariableName()));
+    auto pvSupport = address.isFlightRecorder()
+      ? pvProvider->createFlightRecorderPVSupport(
+          address.getProcessVariableName(), pvValueType)
+      : callForValueTypeInternal<CallCreatePVSupport>(
+          pvValueType, pvProvider.get(), &address.getProcessVariableName());
+    if (address.hasReadCacheMaxAge()) {
+      pvSupport->setReadCacheMaxAge(address.getReadCacheMaxAge());
+    }
+    if (address.getHistorySize()) {
+      pvSupport = callForValueTypeNoVoidInternal<CallCreateHistoryPVSupport>(
+        pvValueType, pvSupport, address.getHistorySize(),
+        address.getHistoryInterval());
+    }
+    if (address.getDecimationFactor()) {
+      pvSupport = callForValueTypeNoVoidInternal<CallCreateDecimatingPVSupport>(
+        pvValueType, pvSupport, address.getDecimationFactor(),
+        address.isDecimationAverage());
+    }
+    if (address.getReduction() != Reduction::NONE) {
+      pvSupport = callForValueTypeNoVoidInternal<CallCreateReductionPVSupport>(
+        pvValueType, pvSupport, address.getReduction());
+    }
+    return ResolvedRecordLink(
+      address, pvProvider, getRecordValueType(address, pvValueType),
+      pvSupport);
+  }
+
+  /**
+   * Returns the type of the values that the record receives for the specified
+   * address, given the value type of the process variable. This only differs
+   * from the process variable's value type if the address specifies an option
+   * that transforms the values.
+   */
+  static std::type_info const &getRecordValueType(
+      RecordAddress const &address, std::type_info const &pvValueType) {
+    if (address.getReduction() != Reduction::NONE) {
+      return typeid(double);
+    }
+    return pvValueType;
   }
 
 protected:
 
+  /**
+   * Constructor. Takes a link that has already been resolved.
+   */
+  RecordDeviceSupportBase(ResolvedRecordLink &&link)
+      : latest(link.address.isLatest()),
+        noBidirectional(link.address.isNoBidirectional()),
+        noInitialRead(link.address.isNoInitialRead()),
+        queueSize(link.address.getQueueSize()),
+        prefetchedInitialValue(std::move(link.initialValue)),
+        pvSupport(std::move(link.pvSupport)),
+        valueType(link.valueType) {
+  }
+
+  /**
+   * Flag indicating whether only the latest value shall be processed when
+   * notifications arrive faster than the record can process them. This option
+   * is only relevant for input records.
+   */
+  bool const latest;
+
   /**
    * Flag indicating whether support for bidirectional process variables shall
    * be disabled for this record. This option is only relevant for output
@@ -66,17 +166,29 @@ protected:
   bool const noBidirectional;
 
   /**
-   * Name of the process variable.
+   * Flag indicating whether reading the initial value shall be skipped for
+   * this record. This option is only relevant for output records.
+   */
+  bool const noInitialRead;
+
+  /**
+   * Number of values that are queued when the record cannot keep up with the
+   * notifications. Zero means that the "queue" option has not been specified.
+   * This option is only relevant for input records.
    */
-  std::string const pvName;
+  std::uint32_t const queueSize;
 
   /**
-   * Pointer to the process variable support.
+   * Initial value that has been prefetched before this device support was
+   * created. This is null if no initial value has been prefetched or if it
+   * has already been retrieved by calling initialValue().
    */
-  PVProvider::SharedPtr const pvProvider;
+  std::unique_ptr<detail::PrefetchedInitialValueBase> prefetchedInitialValue;
 
   /**
-   * Shared pointer to the original PV support.
+   * Shared pointer to the original PV support. The PV support keeps the PV
+   * provider that created it alive, so we do not have to keep a reference to
+   * the PV provider or the process variable's name for each record.
    */
   std::shared_ptr<PVSupportBase> const pvSupport;
 
@@ -217,6 +329,38 @@ protected:
       this->valueType, std::forward<Args>(args)...);
   }
 
+  /**
+   * Throws an exception if an option that is only supported by input records
+   * has been specified. This is called by the device supports for output
+   * records, so that such an option is not silently ignored.
+   */
+  void checkOutputRecordOptions() const {
+    if (this->latest || this->queueSize) {
+      throw std::invalid_argument(
+        "The options \"latest\" and \"queue\" can only be used with input records.");
+    }
+  }
+
+  /**
+   * Returns the initial value of the PV support. If the initial value has been
+   * prefetched, the prefetched value is returned. Otherwise, the PV support's
+   * initialValue() method is called. The PV support's element type has to be
+   * specified as a template parameter.
+   *
+   * The caller is responsible for not calling this method if the
+   * "noinitialread" option has been specified for this record.
+   */
+  template<typename T>
+  std::tuple<typename PVSupport<T>::Value, VersionNumber> initialValue() {
+    auto prefetched = std::move(this->prefetchedInitialValue);
+    auto typedPrefetched =
+      dynamic_cast<detail::PrefetchedInitialValue<T> *>(prefetched.get());
+    if (typedPrefetched) {
+      return typedPrefetched->get();
+    }
+    return this->template getPVSupport<T>()->initialValue();
+  }
+
   /**
    * Returns a pointer to the PV support for this record. The PV support's
    * element type has to be specified as a template parameter. Throws an
@@ -240,9 +384,63 @@ private:
    */
   template<typename T>
   struct CallCreatePVSupport {
-    PVSupportBase::SharedPtr operator()(RecordDeviceSupportBase *obj) {
-      return obj->pvProvider->template createPVSupport<T>(
-        obj->pvName);
+    PVSupportBase::SharedPtr operator()(
+        PVProvider *pvProvider, std::string const *pvName) {
+      return pvProvider->template createPVSupport<T>(*pvName);
+    }
+  };
+
+  /**
+   * Helper template for wrapping a PV support in a DecimatingPVSupport of the
+   * current value type.
+   */
+  template<typename T>
+  struct CallCreateDecimatingPVSupport {
+    PVSupportBase::SharedPtr operator()(
+        PVSupportBase::SharedPtr pvSupport, std::uint32_t factor,
+        bool average) {
+      return DecimatingPVSupport<T>::create(
+        std::static_pointer_cast<PVSupport<T>>(pvSupport), factor, average);
+    }
+  };
+
+  /**
+   * Helper template for wrapping a PV support in a HistoryPVSupport of the
+   * current value type.
+   */
+  template<typename T>
+  struct CallCreateHistoryPVSupport {
+    PVSupportBase::SharedPtr operator()(
+        PVSupportBase::SharedPtr pvSupport, std::uint32_t size,
+        std::chrono::milliseconds interval) {
+      return HistoryPVSupport<T>::create(
+        std::static_pointer_cast<PVSupport<T>>(pvSupport), size, interval);
+    }
+  };
+
+  /**
+   * Helper template for wrapping a PV support in a ReductionPVSupport of the
+   * current value type.
+   */
+  template<typename T>
+  struct CallCreateReductionPVSupport {
+    PVSupportBase::SharedPtr operator()(
+        PVSupportBase::SharedPtr pvSupport, Reduction reduction) {
+      return ReductionPVSupport<T>::create(
+        std::static_pointer_cast<PVSupport<T>>(pvSupport), reduction);
+    }
+  };
+
+  /**
+   * Helper template for calling the right instantiation of
+   * PVSupport::initialValueAsync() for the current value type.
+   */
+  template<typename T>
+  struct CallPrefetchInitialValue {
+    std::unique_ptr<detail::PrefetchedInitialValueBase> operator()(
+        PVSupportBase *pvSupport) {
+      return std::make_unique<detail::PrefetchedInitialValue<T>>(
+        dynamic_cast<PVSupport<T> &>(*pvSupport).initialValueAsync());
     }
   };
 
@@ -0,0 +1,237 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_RECORD_LINK_PRE_RESOLVER_H
+#define CHIMERATK_EPICS_RECORD_LINK_PRE_RESOLVER_H
+
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#include <ChimeraTK/VersionNumber.h>
+
+extern "C" {
+#include <dbLink.h>
+} // extern "C"
+
+#include "PVProvider.h"
+#include "PVSupport.h"
+#include "RecordAddress.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace detail {
+
+/**
+ * Base class for PrefetchedInitialValue. This class allows for waiting on a
+ * prefetched initial value without knowing its value type.
+ */
+class PrefetchedInitialValueBase {
+
+public:
+
+  /**
+   * Destructor.
+   */
+  virtual ~PrefetchedInitialValueBase() noexcept {
+  }
+
+  /**
+   * Blocks until the initial value (or the exception that occurred while
+   * trying to get it) is available.
+   */
+  virtual void wait() = 0;
+
+};
+
+/**
+ * Initial value of a process variable that is fetched asynchronously, before
+ * the record using it is initialized.
+ */
+template<typename T>
+class PrefetchedInitialValue : public PrefetchedInitialValueBase {
+
+public:
+
+  /**
+   * Creates an instance that wraps the specified future, which has typically
+   * been returned by PVSupport::initialValueAsync().
+   */
+  PrefetchedInitialValue(
+      std::future<std::tuple<typename PVSupport<T>::Value, VersionNumber>> &&future)
+      : future(std::move(future)) {
+  }
+
+  /**
+   * Returns the initial value. If prefetching the initial value failed, the
+   * exception that occurred while doing so is thrown. This method must only be
+   * called once.
+   */
+  std::tuple<typename PVSupport<T>::Value, VersionNumber> get() {
+    return this->future.get();
+  }
+
+  // Declared in PrefetchedInitialValueBase.
+  void wait() override {
+    this->future.wait();
+  }
+
+private:
+
+  std::future<std::tuple<typename PVSupport<T>::Value, VersionNumber>> future;
+
+};
+
+} // namespace detail
+
+/**
+ * Result of resolving the link field of a record. This holds everything that
+ * the record device support needs for initializing itself.
+ */
+struct ResolvedRecordLink {
+
+  /**
+   * Creates a resolved link from its components. The initial value is not set.
+   */
+  ResolvedRecordLink(
+      RecordAddress const &address,
+      PVProvider::SharedPtr const &pvProvider,
+      std::type_info const &valueType,
+      PVSupportBase::SharedPtr const &pvSupport)
+      : address(address), pvProvider(pvProvider), pvSupport(pvSupport),
+        valueType(valueType) {
+  }
+
+  /**
+   * Parsed contents of the record's link field.
+   */
+  RecordAddress address;
+
+  /**
+   * Initial value that has been prefetched for the record. This is null if no
+   * initial value has been prefetched.
+   */
+  std::unique_ptr<detail::PrefetchedInitialValueBase> initialValue;
+
+  /**
+   * PV provider that is referenced by the record address.
+   */
+  PVProvider::SharedPtr pvProvider;
+
+  /**
+   * PV support that has been created for the record.
+   */
+  PVSupportBase::SharedPtr pvSupport;
+
+  /**
+   * Value type of the PV support. This is the type specified in the record
+   * address or the PV provider's default type for the process variable.
+   */
+  std::type_info const &valueType;
+
+};
+
+/**
+ * Resolves the link fields of all records using this device support before the
+ * records are initialized.
+ *
+ * When there are many records, resolving their links (which includes creating
+ * the PV supports and reading the initial values of output records) one after
+ * another during record initialization can take a lot of time. For this
+ * reason, preResolve() is called from an IOC init hook before the records are
+ * initialized and resolves all links in parallel. The record device supports
+ * then simply pick up the result by calling takeOrResolve(...).
+ */
+class RecordLinkPreResolver {
+
+public:
+
+  /**
+   * Discards all resolved links that have not been picked up by a record. This
+   * is called after all records have been initialized, so that PV supports
+   * that are not used are released.
+   */
+  static void clear();
+
+  /**
+   * Returns the resolved link for the specified record or null if the record's
+   * link has not been resolved in advance. The returned object stays valid
+   * until it is taken by calling takeOrResolve(...) or clear() is called.
+   */
+  static ResolvedRecordLink const *find(void const *record);
+
+  /**
+   * Returns the number of threads that are used for pre-resolving the links.
+   */
+  static std::size_t getNumberOfThreads();
+
+  /**
+   * Resolves the links of all records that use this device support. Links that
+   * cannot be resolved are silently skipped, so that the error is reported
+   * when the respective record is initialized.
+   *
+   * Links belonging to the same application or device are resolved in the
+   * same thread, but links belonging to different applications or devices are
+   * resolved in parallel. For output records, the initial value is prefetched
+   * by calling PVSupport::initialValueAsync(), so that the initial values can
+   * be read in parallel by the I/O threads of the respective device.
+   *
+   * This method must only be called after the database has been loaded and
+   * before the records are initialized. It only returns after all links have
+   * been resolved and all initial values have been fetched.
+   */
+  static void preResolve();
+
+  /**
+   * Sets the number of threads that are used for pre-resolving the links.
+   * Setting the number of threads to zero disables the pre-resolution, so that
+   * each link is resolved when its record is initialized.
+   */
+  static void setNumberOfThreads(std::size_t numberOfThreads);
+
+  /**
+   * Returns the resolved link for the specified record. If the record's link
+   * has been resolved in advance, that link is returned (and removed from the
+   * internal map). Otherwise, the contents of the specified link field are
+   * resolved now.
+   */
+  static ResolvedRecordLink takeOrResolve(
+      void const *record, ::DBLINK const &linkField);
+
+private:
+
+  static std::mutex mutex;
+  static std::size_t numberOfThreads;
+  static std::unordered_map<void const *, ResolvedRecordLink> resolvedLinks;
+
+  // This class only has static methods, so it should not be constructed.
+  RecordLinkPreResolver() = delete;
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_RECORD_LINK_PRE_RESOLVER_H
@@ -0,0 +1,94 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_RECORD_MUTEX_POOL_H
+#define CHIMERATK_EPICS_RECORD_MUTEX_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Pool of mutexes that are shared by the device supports of all records.
+ *
+ * Output records need a mutex in order to synchronize the notification
+ * callback with the processing of the record. Having a separate mutex in each
+ * device support object adds a significant amount of memory when there are
+ * many records, so instead each record is mapped to one of a fixed number of
+ * mutexes.
+ *
+ * As several records share the same mutex, code holding one of these mutexes
+ * must not call any code that might acquire another lock (in particular, it
+ * must not call any methods of a PV support) and must never try to acquire the
+ * same mutex twice.
+ */
+class RecordMutexPool {
+
+public:
+
+  /**
+   * Returns the mutex that is used for the specified record.
+   */
+  static std::mutex &getMutex(void const *record) {
+    // The record structures are allocated on the heap, so the lower bits of
+    // their addresses are always the same. We mix in the higher bits so that
+    // the records are distributed evenly.
+    auto address = reinterpret_cast<std::uintptr_t>(record);
+    auto index = ((address >> 6) ^ (address >> 16)) % numberOfMutexes;
+    return RecordMutexPool::mutexes[index].mutex;
+  }
+
+  /**
+   * Returns the amount of memory (in bytes) that is used by the pool.
+   */
+  static constexpr std::size_t getMemorySize() {
+    return sizeof(RecordMutexPool::mutexes);
+  }
+
+private:
+
+  /**
+   * Mutex that is aligned to a cache line, so that two threads using
+   * different mutexes do not compete for the same cache line.
+   */
+  struct alignas(64) PaddedMutex {
+
+    std::mutex mutex;
+
+  };
+
+  /**
+   * Number of mutexes in the pool.
+   */
+  static constexpr std::size_t numberOfMutexes = 521;
+
+  static PaddedMutex mutexes[numberOfMutexes];
+
+  // This class only has static methods, so it should not be constructed.
+  RecordMutexPool() = delete;
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_RECORD_MUTEX_POOL_H
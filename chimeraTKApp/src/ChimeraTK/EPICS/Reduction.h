@@ -0,0 +1,62 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_REDUCTION_H
+#define CHIMERATK_EPICS_REDUCTION_H
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Reduction that is applied to the elements of an array in order to get a
+ * single value.
+ */
+enum class Reduction {
+
+  /**
+   * No reduction. The value is used as is.
+   */
+  NONE,
+
+  /**
+   * Greatest element of the array.
+   */
+  MAX,
+
+  /**
+   * Arithmetic mean of the elements of the array.
+   */
+  MEAN,
+
+  /**
+   * Smallest element of the array.
+   */
+  MIN,
+
+  /**
+   * Root mean square of the elements of the array.
+   */
+  RMS
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_REDUCTION_H
@@ -0,0 +1,337 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_REDUCTION_PV_SUPPORT_H
+#define CHIMERATK_EPICS_REDUCTION_PV_SUPPORT_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "PVSupport.h"
+#include "Reduction.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace detail {
+
+/**
+ * Results of all reductions for one array value. These are calculated
+ * together, so that several records using different reductions of the same
+ * value only need a single pass over the array.
+ */
+struct ReductionResults {
+
+  double max;
+  double mean;
+  double min;
+  double rms;
+
+  /**
+   * Returns the result of the specified reduction.
+   */
+  double get(Reduction reduction) const {
+    switch (reduction) {
+    case Reduction::MAX:
+      return max;
+    case Reduction::MEAN:
+      return mean;
+    case Reduction::MIN:
+      return min;
+    case Reduction::RMS:
+      return rms;
+    default:
+      throw std::logic_error("Unexpected reduction.");
+    }
+  }
+
+};
+
+/**
+ * Converts an element to a double for the purpose of a reduction.
+ */
+template<typename T>
+inline double reductionElementValue(T const &value) {
+  return static_cast<double>(value);
+}
+
+/**
+ * Converts an element to a double for the purpose of a reduction. Strings
+ * cannot be reduced, so this overload only exists so that the code compiles
+ * for all value types.
+ */
+inline double reductionElementValue(std::string const &) {
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+ * Calculates all reductions in a single pass over the specified elements.
+ *
+ * The loop uses several independent accumulators, so that consecutive
+ * elements do not depend on each other and the compiler can use vector
+ * instructions. If there are no elements, all results are NaN.
+ */
+template<typename T>
+ReductionResults calculateReductions(std::vector<T> const &value) {
+  constexpr std::size_t lanes = 4;
+  auto size = value.size();
+  if (size == 0) {
+    auto nan = std::numeric_limits<double>::quiet_NaN();
+    return ReductionResults{nan, nan, nan, nan};
+  }
+  auto first = reductionElementValue(value[0]);
+  std::array<double, lanes> max, min, sum, sumOfSquares;
+  max.fill(first);
+  min.fill(first);
+  sum.fill(0.0);
+  sumOfSquares.fill(0.0);
+  auto data = value.data();
+  std::size_t i = 0;
+  for (; i + lanes <= size; i += lanes) {
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+      auto element = reductionElementValue(data[i + lane]);
+      max[lane] = std::max(max[lane], element);
+      min[lane] = std::min(min[lane], element);
+      sum[lane] += element;
+      sumOfSquares[lane] += element * element;
+    }
+  }
+  for (; i < size; ++i) {
+    auto element = reductionElementValue(data[i]);
+    max[0] = std::max(max[0], element);
+    min[0] = std::min(min[0], element);
+    sum[0] += element;
+    sumOfSquares[0] += element * element;
+  }
+  ReductionResults results{max[0], 0.0, min[0], 0.0};
+  double totalSum = 0.0;
+  double totalSumOfSquares = 0.0;
+  for (std::size_t lane = 0; lane < lanes; ++lane) {
+    results.max = std::max(results.max, max[lane]);
+    results.min = std::min(results.min, min[lane]);
+    totalSum += sum[lane];
+    totalSumOfSquares += sumOfSquares[lane];
+  }
+  results.mean = totalSum / size;
+  results.rms = std::sqrt(totalSumOfSquares / size);
+  return results;
+}
+
+/**
+ * Cache for the results of the reductions of recently seen array values.
+ *
+ * When several records use reductions of the same process variable, each of
+ * them receives the same shared value, so the reductions only have to be
+ * calculated for the first of them. The cache is keyed by the address of the
+ * shared value. It only keeps weak references, so a slot can only match while
+ * the value that it was calculated for is still alive.
+ */
+class ReductionCache {
+
+public:
+
+  /**
+   * Returns the results of the reductions for the specified value,
+   * calculating them if they are not in the cache yet.
+   */
+  template<typename T>
+  ReductionResults get(std::shared_ptr<std::vector<T> const> const &value) {
+    auto &slot = this->slots[
+      (reinterpret_cast<std::uintptr_t>(value.get()) / alignof(std::max_align_t))
+      % numberOfSlots];
+    {
+      std::lock_guard<std::mutex> lock(slot.mutex);
+      if (slot.value.lock() == value) {
+        return slot.results;
+      }
+    }
+    auto results = calculateReductions(*value);
+    {
+      std::lock_guard<std::mutex> lock(slot.mutex);
+      slot.value = value;
+      slot.results = results;
+    }
+    return results;
+  }
+
+  /**
+   * Returns the process-wide instance.
+   */
+  static ReductionCache &shared() {
+    static ReductionCache instance;
+    return instance;
+  }
+
+private:
+
+  static constexpr std::size_t numberOfSlots = 64;
+
+  struct Slot {
+    std::mutex mutex;
+    ReductionResults results;
+    std::weak_ptr<void const> value;
+  };
+
+  std::array<Slot, numberOfSlots> slots;
+
+};
+
+} // namespace detail
+
+/**
+ * PVSupport providing a reduction of the elements of another PVSupport's
+ * value as a scalar of type double.
+ *
+ * The reduction is calculated directly on the shared value that is passed to
+ * the notification callback, so the array is never copied. The results of all
+ * reductions are calculated in one pass and cached for the value, so that
+ * several records using different reductions of the same process variable
+ * share this pass. Writing is not supported.
+ */
+template<typename T>
+class ReductionPVSupport : public PVSupport<double> {
+
+public:
+
+  /**
+   * Creates a reduction PV support that applies the specified reduction to the
+   * values of the specified PV support. Throws an exception if the values of
+   * the original PV support cannot be reduced.
+   */
+  static std::shared_ptr<ReductionPVSupport> create(
+      typename PVSupport<T>::SharedPtr originalPVSupport,
+      Reduction reduction) {
+    if (std::is_same<T, std::string>::value) {
+      throw std::invalid_argument(
+        "The reduce option cannot be used with process variables of type string.");
+    }
+    if (reduction == Reduction::NONE) {
+      throw std::invalid_argument("A reduction must be specified.");
+    }
+    return std::make_shared<ReductionPVSupport>(originalPVSupport, reduction);
+  }
+
+  /**
+   * Constructor. Use create(...) instead of calling this constructor
+   * directly.
+   */
+  ReductionPVSupport(
+      typename PVSupport<T>::SharedPtr originalPVSupport, Reduction reduction)
+      : originalPVSupport(originalPVSupport), reduction(reduction) {
+  }
+
+  // Declared in PVSupport.
+  void cancelNotify() override {
+    originalPVSupport->cancelNotify();
+  }
+
+  // Declared in PVSupportBase.
+  bool canNotify() override {
+    return originalPVSupport->canNotify();
+  }
+
+  // Declared in PVSupportBase.
+  bool canRead() override {
+    return originalPVSupport->canRead();
+  }
+
+  // Declared in PVSupportBase.
+  std::size_t getNumberOfElements() override {
+    return 1;
+  }
+
+  // Declared in PVSupport.
+  std::tuple<Value, VersionNumber> initialValue() override {
+    auto original = originalPVSupport->initialValue();
+    return std::make_tuple(
+      Value(1, detail::calculateReductions(std::get<0>(original)).get(
+        reduction)),
+      std::get<1>(original));
+  }
+
+  // Declared in PVSupport.
+  void notify(
+      NotifyCallback const &successCallback,
+      NotifyErrorCallback const &errorCallback) override {
+    typename PVSupport<T>::NotifyCallback wrappedSuccessCallback;
+    if (successCallback) {
+      auto reduction = this->reduction;
+      wrappedSuccessCallback = [successCallback, reduction](
+            typename PVSupport<T>::SharedValue const &value,
+            VersionNumber const &versionNumber){
+          successCallback(reduce(value, reduction), versionNumber);
+        };
+    }
+    originalPVSupport->notify(wrappedSuccessCallback, errorCallback);
+  }
+
+  // Declared in PVSupport.
+  void notifyFinished() override {
+    originalPVSupport->notifyFinished();
+  }
+
+  // Declared in PVSupport.
+  bool read(
+      ReadCallback const &successCallback,
+      ErrorCallback const &errorCallback) override {
+    typename PVSupport<T>::ReadCallback wrappedSuccessCallback;
+    if (successCallback) {
+      auto reduction = this->reduction;
+      wrappedSuccessCallback = [successCallback, reduction](
+            bool immediate,
+            typename PVSupport<T>::SharedValue const &value,
+            VersionNumber const &versionNumber){
+          successCallback(immediate, reduce(value, reduction), versionNumber);
+        };
+    }
+    return originalPVSupport->read(wrappedSuccessCallback, errorCallback);
+  }
+
+private:
+
+  typename PVSupport<T>::SharedPtr originalPVSupport;
+  Reduction const reduction;
+
+  /**
+   * Applies the reduction to a shared value, using the cached results if the
+   * same value has been reduced before.
+   */
+  static SharedValue reduce(
+      typename PVSupport<T>::SharedValue const &value, Reduction reduction) {
+    return std::make_shared<Value>(
+      1, detail::ReductionCache::shared().get(value).get(reduction));
+  }
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_REDUCTION_PV_SUPPORT_H
@@ -0,0 +1,234 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_SHARED_MEMORY_MIRROR_H
+#define CHIMERATK_EPICS_SHARED_MEMORY_MIRROR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Mirror of process variable values in a POSIX shared-memory segment.
+ *
+ * The segment starts with a header of 64 bytes: the magic string "CTKSHMIR",
+ * the layout version (uint32, currently 1), the number of slots (uint32), and
+ * the size of the segment in bytes (uint64). It is followed by one slot for
+ * each process variable. Each slot starts at a multiple of 64 bytes and
+ * consists of a SlotHeader, followed by the elements of the value at an offset
+ * of 64 bytes from the start of the slot. All numbers use the host's byte
+ * order.
+ *
+ * Each slot is protected by a sequence lock: The writer increments the
+ * sequence number before and after updating the slot, so it is odd while an
+ * update is in progress. A reader reads the sequence number, copies the data
+ * and reads the sequence number again. If it is odd or has changed, the
+ * reader has to try again. This way, readers never block the writer and do
+ * not need any system calls. A sequence number of zero means that no value has
+ * been published yet.
+ *
+ * The offset, type, and size of each slot are published in a text file (the
+ * index file), which has one line for each slot. Each line has the offset of
+ * the slot, the type name, the size of an element, the number of elements and
+ * the name of the process variable, separated by spaces. The index file is
+ * written to a temporary file first and then renamed, so readers never see an
+ * incomplete file.
+ */
+class SharedMemoryMirror {
+
+public:
+
+  /**
+   * Type of a shared pointer to this type.
+   */
+  using SharedPtr = std::shared_ptr<SharedMemoryMirror>;
+
+  /**
+   * Definition of a slot, describing the values of a process variable.
+   */
+  struct SlotDefinition {
+
+    /**
+     * Name of the process variable.
+     */
+    std::string name;
+
+    /**
+     * Name of the element type (as used in record addresses).
+     */
+    std::string typeName;
+
+    /**
+     * Size of each element in bytes.
+     */
+    std::size_t elementSize;
+
+    /**
+     * Number of elements of each value.
+     */
+    std::size_t numberOfElements;
+
+  };
+
+  /**
+   * Header at the start of each slot.
+   */
+  struct SlotHeader {
+
+    /**
+     * Sequence number of the slot. This is odd while the slot is being
+     * updated.
+     */
+    std::atomic<std::uint64_t> sequence;
+
+    /**
+     * Time stamp of the value (in nanoseconds since the UNIX epoch), taken
+     * from the value's version number.
+     */
+    std::int64_t timestamp;
+
+    /**
+     * Number of elements of the value.
+     */
+    std::uint32_t numberOfElements;
+
+    /**
+     * Size of each element in bytes.
+     */
+    std::uint32_t elementSize;
+
+  };
+
+  /**
+   * Creates the shared-memory segment with the specified name and writes the
+   * index file. Throws an exception if the segment or the index file cannot
+   * be created. In particular, creating the segment fails if a segment with
+   * the same name already exists. Such a segment might belong to another IOC,
+   * so a segment left over by an IOC that has not been shut down cleanly has
+   * to be removed manually.
+   */
+  SharedMemoryMirror(
+      std::string const &segmentName, std::string const &indexFileName,
+      std::vector<SlotDefinition> const &slotDefinitions);
+
+  /**
+   * Destructor. Unmaps and removes the shared-memory segment and removes the
+   * index file. Readers that have mapped the segment can still access it
+   * until they unmap it.
+   */
+  ~SharedMemoryMirror() noexcept;
+
+  /**
+   * Returns the name of the shared-memory segment.
+   */
+  std::string const &getSegmentName() const {
+    return this->segmentName;
+  }
+
+  /**
+   * Returns the number of slots.
+   */
+  std::size_t getNumberOfSlots() const {
+    return this->slots.size();
+  }
+
+  /**
+   * Returns the size of the shared-memory segment in bytes.
+   */
+  std::size_t getSize() const {
+    return this->size;
+  }
+
+  /**
+   * Returns the header of the slot with the specified index.
+   */
+  SlotHeader *getSlot(std::size_t index) const {
+    return this->slots.at(index);
+  }
+
+  /**
+   * Publishes a value in the specified slot. The number of bytes must not
+   * exceed the size of the slot's data area, which is guaranteed when the
+   * value has the number of elements specified in the slot definition.
+   *
+   * There must only be one writer for each slot at a time.
+   */
+  static void publish(
+      SlotHeader *slot, void const *data, std::size_t numberOfBytes,
+      std::int64_t timestamp) noexcept {
+    auto sequence = slot->sequence.load(std::memory_order_relaxed);
+    slot->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->timestamp = timestamp;
+    std::memcpy(
+      reinterpret_cast<char *>(slot) + slotDataOffset, data, numberOfBytes);
+    slot->sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+private:
+
+  /**
+   * Offset of the data area from the start of a slot.
+   */
+  static constexpr std::size_t slotDataOffset = 64;
+
+  /**
+   * Name of the index file describing the layout of the segment.
+   */
+  std::string indexFileName;
+
+  /**
+   * Start of the mapped segment.
+   */
+  void *mapping;
+
+  /**
+   * Name of the shared-memory segment.
+   */
+  std::string segmentName;
+
+  /**
+   * Size of the segment in bytes.
+   */
+  std::size_t size;
+
+  /**
+   * Headers of all slots.
+   */
+  std::vector<SlotHeader *> slots;
+
+  // Delete copy constructors and assignment operators.
+  SharedMemoryMirror(SharedMemoryMirror const &) = delete;
+  SharedMemoryMirror(SharedMemoryMirror &&) = delete;
+  SharedMemoryMirror &operator=(SharedMemoryMirror const &) = delete;
+  SharedMemoryMirror &operator=(SharedMemoryMirror &&) = delete;
+
+};
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_SHARED_MEMORY_MIRROR_H
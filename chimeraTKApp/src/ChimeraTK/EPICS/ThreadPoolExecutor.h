@@ -29,6 +29,8 @@
 #include <type_traits>
 #include <vector>
 
+#include "ThreadSettings.h"
+
 namespace ChimeraTK {
 namespace EPICS {
 
@@ -41,9 +43,12 @@ public:
 
   /**
    * Creates a thread pool of the specified size. If the size is less than one,
-   * no tasks can be submitted to this thread pool.
+   * no tasks can be submitted to this thread pool. The specified settings are
+   * applied to each of the pool threads, appending the index of the thread to
+   * its name.
    */
-  explicit ThreadPoolExecutor(std::size_t numberOfPoolThreads);
+  explicit ThreadPoolExecutor(std::size_t numberOfPoolThreads,
+      ThreadSettings const &threadSettings = ThreadSettings());
 
   /**
    * Destroys this thread pool.
@@ -53,6 +58,12 @@ public:
    */
   ~ThreadPoolExecutor();
 
+  /**
+   * Returns the number of tasks that have been submitted, but have not been
+   * started yet.
+   */
+  std::size_t getQueuedTaskCount();
+
   /**
    * Shuts down all threads in this thread pool. All submitted tasks are
    * processed and all threads are terminted before this method returns, so it
@@ -112,6 +123,11 @@ private:
    */
   void runThread();
 
+  /**
+   * Settings applied to each of the threads when it is started.
+   */
+  ThreadSettings threadSettings;
+
 };
 
 template<typename Function, typename... Args>
@@ -0,0 +1,113 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_THREAD_SETTINGS_H
+#define CHIMERATK_EPICS_THREAD_SETTINGS_H
+
+#include <string>
+#include <vector>
+
+namespace ChimeraTK {
+namespace EPICS {
+
+/**
+ * Settings that are applied to a thread when it is started. The settings are
+ * defined for a class of threads (e.g. the I/O threads) of a PV provider.
+ */
+struct ThreadSettings {
+
+  /**
+   * CPUs on which the thread may run. If empty, the CPU affinity of the thread
+   * is not changed.
+   */
+  std::vector<int> cpus;
+
+  /**
+   * Name of the thread. If there are several threads of the same class, the
+   * index of the thread is appended to the name. This name is used in error
+   * messages printed by errorExtendedPrintf(...) and passed to the operating
+   * system, which might truncate it.
+   */
+  std::string name;
+
+  /**
+   * Real-time priority of the thread. If greater than zero, the thread uses
+   * the SCHED_FIFO policy with this priority. If zero, the scheduling policy
+   * of the thread is not changed.
+   */
+  int realtimePriority;
+
+  /**
+   * Creates settings that do not change anything, except for giving the thread
+   * the specified name.
+   */
+  explicit ThreadSettings(std::string const &name = std::string())
+      : name(name), realtimePriority(0) {
+  }
+
+};
+
+/**
+ * Applies the specified settings to the calling thread. If index is
+ * non-negative, it is appended to the thread name. Errors are printed, but do
+ * not stop the thread.
+ *
+ * This function is intended to be called by a thread right after it has been
+ * started.
+ */
+void applyThreadSettings(ThreadSettings const &settings, int index = -1) noexcept;
+
+/**
+ * Returns the name that has been set for the calling thread by
+ * applyThreadSettings(...) or null if no name has been set.
+ */
+char const *getCurrentThreadName() noexcept;
+
+/**
+ * Returns the settings for the specified class of threads of the specified PV
+ * provider. If no settings have been defined, settings that only set a
+ * default name are returned. For threads that are not associated with a PV
+ * provider (the copy, error-print, and timer threads), the provider name is
+ * empty.
+ */
+ThreadSettings getThreadSettings(
+    std::string const &providerName, std::string const &threadClass);
+
+/**
+ * Parses a list of CPUs (e.g. "0,2-3"). Throws an exception if the list is not
+ * valid. An empty string results in an empty list.
+ */
+std::vector<int> parseCpuList(std::string const &cpuList);
+
+/**
+ * Sets the settings for the specified class of threads of the specified PV
+ * provider. The settings are applied when the threads are started, so they
+ * have to be set before the PV provider is created. If the name in the
+ * settings is empty, the default name is used.
+ *
+ * Throws an exception if the thread class is not known or the settings are
+ * not valid.
+ */
+void setThreadSettings(std::string const &providerName,
+    std::string const &threadClass, ThreadSettings const &settings);
+
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_THREAD_SETTINGS_H
@@ -0,0 +1,99 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2015-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHIMERATK_EPICS_DETAIL_FIXED_STRIDE_STRINGS_H
+#define CHIMERATK_EPICS_DETAIL_FIXED_STRIDE_STRINGS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ChimeraTK {
+namespace EPICS {
+namespace detail {
+
+/**
+ * Returns the length of the null-terminated string stored in a buffer of the
+ * specified size. If the buffer does not contain a null byte, the size of the
+ * buffer is returned. Unlike std::strlen, this never reads beyond the end of
+ * the buffer.
+ */
+inline std::size_t fixedStringLength(char const *buffer, std::size_t size) {
+  auto end = static_cast<char const *>(std::memchr(buffer, '\0', size));
+  return end ? end - buffer : size;
+}
+
+/**
+ * Copies a string into a buffer of the specified size. If the string does not
+ * fit, it is truncated. The result is always null-terminated, but unlike
+ * std::strncpy, the rest of the buffer is not filled with null bytes. Returns
+ * the length of the copied string (excluding the terminating null byte).
+ */
+inline std::size_t copyToFixedString(
+    char *buffer, std::size_t size, std::string const &value) {
+  std::size_t length = std::min(value.size(), size - 1);
+  std::memcpy(buffer, value.data(), length);
+  buffer[length] = '\0';
+  return length;
+}
+
+/**
+ * Writes strings into a buffer that stores them with a fixed stride (like the
+ * buffer of a record with FTVL set to STRING, where the stride is
+ * MAX_STRING_SIZE). The number of elements is the number of strings written.
+ *
+ * The buffer is cleared in a single operation before copying the strings, so
+ * that the unused part of each element does not contain any left-over data.
+ * This is much faster than filling the remainder of each element separately
+ * (like std::strncpy does).
+ */
+inline void packFixedStrideStrings(char *buffer, std::size_t stride,
+    std::size_t numberOfElements, std::vector<std::string> const &value) {
+  std::memset(buffer, 0, stride * numberOfElements);
+  for (std::size_t i = 0; i < numberOfElements; ++i) {
+    auto const &element = value[i];
+    std::memcpy(buffer + i * stride, element.data(),
+      std::min(element.size(), stride - 1));
+  }
+}
+
+/**
+ * Reads strings from a buffer that stores them with a fixed stride. This is
+ * the counterpart of packFixedStrideStrings(...). Each element is read up to
+ * its first null byte, but never beyond the end of the element.
+ *
+ * The strings are assigned to the existing elements of the vector (which must
+ * already have the specified number of elements), so that the memory that has
+ * been allocated for these strings earlier can be reused.
+ */
+inline void unpackFixedStrideStrings(char const *buffer, std::size_t stride,
+    std::size_t numberOfElements, std::vector<std::string> &value) {
+  for (std::size_t i = 0; i < numberOfElements; ++i) {
+    auto element = buffer + i * stride;
+    value[i].assign(element, fixedStringLength(element, stride));
+  }
+}
+
+} // namespace detail
+} // namespace EPICS
+} // namespace ChimeraTK
+
+#endif // CHIMERATK_EPICS_DETAIL_FIXED_STRIDE_STRINGS_H
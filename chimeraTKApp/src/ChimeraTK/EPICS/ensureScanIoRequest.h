@@ -17,18 +17,15 @@
  * <http://www.gnu.org/licenses/>.
  */
 
-#ifndef CHIMERATK_EPICS_RUN_DELAYED_H
-#define CHIMERATK_EPICS_RUN_DELAYED_H
+#ifndef CHIMERATK_EPICS_ENSURE_SCAN_IO_REQUEST_H
+#define CHIMERATK_EPICS_ENSURE_SCAN_IO_REQUEST_H
 
-#include <chrono>
-#include <thread>
+#include <cstddef>
 
 extern "C" {
 #include <dbScan.h>
 } // extern "C"
 
-#include "ChimeraTK/EPICS/Timer.h"
-
 namespace ChimeraTK {
 namespace EPICS {
 
@@ -43,17 +40,18 @@ namespace EPICS {
  * thus the received event is acknowledged by calling the PVSupport's
  * notifyFinished() method.
  */
-void ensureScanIoRequest(::IOSCANPVT ioScanPvt) {
-  if (!::scanIoRequest(ioScanPvt)) {
-    Timer::shared().submitDelayedTask(
-      std::chrono::milliseconds(100),
-      [ioScanPvt](){
-        ensureScanIoRequest(ioScanPvt);
-      });
-  }
-}
+void ensureScanIoRequest(::IOSCANPVT ioScanPvt);
+
+/**
+ * Returns the number of times that a call to scanIoRequest(...) made by
+ * ensureScanIoRequest(...) failed and had to be retried. scanIoRequest(...)
+ * also fails before interruptAccept has been set and when no record is
+ * registered for the scan list, so a non-zero number does not necessarily
+ * mean that a callback queue overflowed.
+ */
+std::size_t getScanIoRequestRetryCount();
 
 } // namespace EPICS
 } // namespace ChimeraTK
 
-#endif // CHIMERATK_EPICS_RUN_DELAYED_H
+#endif // CHIMERATK_EPICS_ENSURE_SCAN_IO_REQUEST_H
@@ -20,6 +20,9 @@
 #ifndef CHIMERATK_EPICS_ERROR_H
 #define CHIMERATK_EPICS_ERROR_H
 
+#include <chrono>
+#include <cstddef>
+
 namespace ChimeraTK {
 namespace EPICS {
 
@@ -33,10 +36,55 @@ void errorPrintf(const char *format, ...) noexcept;
 /**
  * Prints an error message with the current time and the name of the current
  * thread to stderr. A newline character is automatically appended to the
- * message.
+ * message. For threads that have been named through applyThreadSettings(...),
+ * that name is used instead of the name known to EPICS.
  */
 void errorExtendedPrintf(const char *format, ...) noexcept;
 
+/**
+ * Prints an error message for the specified source (typically the name of a
+ * record) to stderr. The source is printed in front of the message (separated
+ * by a space) and a newline character is automatically appended.
+ *
+ * Unlike errorPrintf(...), this function does not write to stderr itself.
+ * Instead, it puts the message into a queue that is processed by a background
+ * thread, so that it does not block when stderr is slow. If the queue is full,
+ * the message is dropped. The message is prefixed with the time at which this
+ * function was called, because it might only be written later. The background
+ * thread uses the settings of the "errorPrint" thread class.
+ *
+ * If the same message is printed for the same source repeatedly, only the
+ * first message within the suppression interval is printed. The suppressed
+ * messages are summarized in a "repeated N times" message when the interval
+ * has passed.
+ *
+ * The source must be a null-terminated string that stays valid for the whole
+ * lifetime of the process. The address of this string (not its content) is
+ * used to identify the source.
+ */
+void errorPrintfRateLimited(
+    const char *source, const char *format, ...) noexcept;
+
+/**
+ * Returns the number of messages passed to errorPrintfRateLimited(...) that
+ * were dropped because the queue was full.
+ */
+std::size_t getErrorPrintDroppedCount() noexcept;
+
+/**
+ * Returns the number of messages passed to errorPrintfRateLimited(...) that
+ * were suppressed because they repeated an earlier message.
+ */
+std::size_t getErrorPrintSuppressedCount() noexcept;
+
+/**
+ * Sets the interval in which repeated messages passed to
+ * errorPrintfRateLimited(...) are suppressed. An interval of zero disables the
+ * suppression of repeated messages. The default is ten seconds.
+ */
+void setErrorPrintSuppressionInterval(
+    std::chrono::milliseconds interval) noexcept;
+
 } // namespace EPICS
 } // namespace ChimeraTK
 
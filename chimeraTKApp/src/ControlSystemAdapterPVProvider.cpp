@@ -17,15 +17,23 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstdint>
+#include <fstream>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <ChimeraTK/ReadAnyGroup.h>
-#include <ChimeraTK/RegisterPath.h>
+
+extern "C" {
+#include <epicsStdio.h>
+} // extern "C"
 
 #include "ChimeraTK/EPICS/ControlSystemAdapterSharedPVSupportImpl.h"
+#include "ChimeraTK/EPICS/InternedNameTable.h"
+#include "ChimeraTK/EPICS/Timer.h"
 #include "ChimeraTK/EPICS/errorPrint.h"
 
 #include "ChimeraTK/EPICS/ControlSystemAdapterPVProvider.h"
@@ -35,12 +43,49 @@ namespace EPICS {
 
 namespace {
   using cppext::future_queue;
+
+  /**
+   * Converts a duration to milliseconds, represented as a floating point
+   * number.
+   */
+  double toMilliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  /**
+   * Names of the notification priorities, using the NotificationPriority as
+   * the index.
+   */
+  char const *notificationPriorityNames[] = {"high", "normal", "low"};
 } // anonymous namespace
 
 ControlSystemAdapterPVProvider::ControlSystemAdapterPVProvider(
-    ControlSystemPVManager::SharedPtr const & pvManager)
-    : notificationThreadShutdownRequested(false),
-      pvManager(pvManager) {
+    ControlSystemPVManager::SharedPtr const & pvManager,
+    ThreadSettings const &notificationThreadSettings,
+    ThreadSettings const &highPriorityNotificationThreadSettings)
+    : busyPollEmptyCount(0), busyPollNotificationCount(0),
+      coalescedNotificationCount(0), coalescedNotificationReplacedCount(0),
+      flightRecorderFreezeCount(0), flightRecordersFrozen(false),
+      highPriorityNotificationThreadSettings(
+        highPriorityNotificationThreadSettings),
+      initialNotificationBatchCount(0), initialNotificationCount(0),
+      initialNotificationWakeUpScheduled(false),
+      lastInitialNotificationBurstDuration(0),
+      longestInitialNotificationBurstDuration(0),
+      notificationBusyPollEnabled(false), notificationBusyPollMaxBackoffUs(0),
+      notificationBusyPollSpinCount(1000), notificationDeliveryStarted(false),
+      notificationThreadShutdownRequested(false),
+      notificationWatchdogScheduled(false), notificationWatchdogTimeout(0),
+      notificationWatchdogTriggerCount(0), overloaded(false),
+      overloadBacklogThreshold(0), overloadEnteredCount(0),
+      overloadLatencyThreshold(0), overloadLeftCount(0),
+      overloadRestoreDelay(1000), pvManager(pvManager) {
+  this->deliveryLatencies.fill(DeliveryLatencyStatistics{
+    0, std::chrono::steady_clock::duration(0),
+    std::chrono::steady_clock::duration(0),
+    std::chrono::steady_clock::duration(0), 0,
+    std::chrono::system_clock::duration(0),
+    std::chrono::system_clock::duration(0)});
   this->insertCreatePVSupportFunc<std::int8_t>();
   this->insertCreatePVSupportFunc<std::uint8_t>();
   this->insertCreatePVSupportFunc<std::int16_t>();
@@ -79,8 +124,86 @@ ControlSystemAdapterPVProvider::ControlSystemAdapterPVProvider(
   // receive a notification without having to check first whether it is a
   // regular PV or the wake-up PV first.
   this->sharedPVSupportsByIndex.resize(this->pvsForNotification.size());
+  this->notificationPriorities.resize(
+    this->pvsForNotification.size(), NotificationPriority::normal);
   this->notificationThread =
-      std::thread([this]{this->runNotificationThread();});
+      std::thread([this, notificationThreadSettings]{
+        applyThreadSettings(notificationThreadSettings);
+        this->runNotificationThread();
+      });
+}
+
+void ControlSystemAdapterPVProvider::addSharedMemoryMirrorPV(
+    std::string const &processVariableName) {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  auto pvSupport = this->getKeptSharedPVSupport(processVariableName);
+  // We retrieve the slot definition here, so that unsupported types are
+  // detected when the process variable is added and not only when the IOC is
+  // started.
+  pvSupport->getSharedMemoryMirrorSlotDefinition();
+  if (std::find(this->sharedMemoryMirrorPVSupports.begin(),
+      this->sharedMemoryMirrorPVSupports.end(), pvSupport)
+      == this->sharedMemoryMirrorPVSupports.end()) {
+    this->sharedMemoryMirrorPVSupports.push_back(std::move(pvSupport));
+  }
+}
+
+PVSupportBase::SharedPtr ControlSystemAdapterPVProvider::createFlightRecorderPVSupport(
+    std::string const &processVariableName,
+    std::type_info const &elementType) {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  auto &name = InternedNameTable::internNormalizedRegisterPath(
+    processVariableName);
+  std::shared_ptr<ControlSystemAdapterSharedPVSupportBase> shared;
+  auto sharedIter = this->sharedPVSupports.find(name);
+  if (sharedIter != this->sharedPVSupports.end()) {
+    shared = sharedIter->second.lock();
+  }
+  // The PV support created by enableFlightRecorder(...) keeps the shared PV
+  // support alive, so if there is none, no flight recorder has been enabled.
+  if (!shared) {
+    throw std::invalid_argument(
+      std::string("The flight recorder has not been enabled for the process variable '")
+        + name + "'.");
+  }
+  return shared->createFlightRecorderPVSupport(elementType);
+}
+
+void ControlSystemAdapterPVProvider::dumpFlightRecorders(
+    std::string const &fileName) {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    throw std::runtime_error(
+      std::string("The file '") + fileName + "' could not be opened.");
+  }
+  file.write("CTKFLREC", 8);
+  detail::writeFlightRecorderField(file, static_cast<std::uint32_t>(1));
+  detail::writeFlightRecorderField(
+    file, static_cast<std::uint32_t>(this->flightRecorders.size()));
+  for (auto &flightRecorder : this->flightRecorders) {
+    flightRecorder->dump(file);
+  }
+  file.close();
+  if (!file) {
+    throw std::runtime_error(
+      std::string("The file '") + fileName + "' could not be written.");
+  }
+}
+
+void ControlSystemAdapterPVProvider::enableFlightRecorder(
+    std::string const &processVariableName, std::size_t depth) {
+  if (depth == 0) {
+    throw std::invalid_argument("The depth must be greater than zero.");
+  }
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  auto flightRecorder =
+    this->getKeptSharedPVSupport(processVariableName)
+      ->enableFlightRecorder(depth);
+  if (std::find(this->flightRecorders.begin(), this->flightRecorders.end(),
+      flightRecorder) == this->flightRecorders.end()) {
+    this->flightRecorders.push_back(std::move(flightRecorder));
+  }
 }
 
 void ControlSystemAdapterPVProvider::finalizeInitialization() {
@@ -89,6 +212,16 @@ void ControlSystemAdapterPVProvider::finalizeInitialization() {
   // an error message than throwing an exception.
   try {
     std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    // The notification watchdog is only scheduled when a timeout has been set.
+    // If it is enabled later, setNotificationWatchdog(...) schedules it.
+    this->scheduleNotificationWatchdog();
+    // The shared-memory mirror has to be created before notifications are
+    // delivered, so that no value is missing from it.
+    this->createSharedMemoryMirror();
+    // The priorities of the PVs cannot change any longer, so we can start the
+    // delivery of regular notifications. We have to do this before starting
+    // the application, so that no notifications are lost.
+    this->startNotificationDelivery();
     // Check for variables not yet initialised - we must guarantee that all
     // to-application variables are written exactly once at server start. We
     // also want to notify the application about variables that are not used, so
@@ -150,13 +283,258 @@ std::type_info const &ControlSystemAdapterPVProvider::getDefaultType(
       ->getValueType();
 }
 
+PVProvider::MemoryUsage ControlSystemAdapterPVProvider::getMemoryUsage() {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  MemoryUsage usage{{}, this->tasks.size()};
+  usage.processVariables.reserve(this->sharedPVSupports.size());
+  for (auto const &entry : this->sharedPVSupports) {
+    auto sharedPVSupport = entry.second.lock();
+    if (sharedPVSupport) {
+      usage.processVariables.push_back(sharedPVSupport->getMemoryUsage());
+    }
+  }
+  return usage;
+}
+
+void ControlSystemAdapterPVProvider::report(int level) {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  ::epicsStdoutPrintf(
+    "  Initial notifications: %zu PVs delivered in %zu batches, %zu PVs pending\n",
+    this->initialNotificationCount, this->initialNotificationBatchCount,
+    this->initialNotificationQueue.size());
+  ::epicsStdoutPrintf(
+    "  Initial notification bursts: last %.3f ms, longest %.3f ms\n",
+    toMilliseconds(this->lastInitialNotificationBurstDuration),
+    toMilliseconds(this->longestInitialNotificationBurstDuration));
+  if (level > 0) {
+    ::epicsStdoutPrintf(
+      "  Initial notification batching: batch size %zu, batch interval %lld ms\n",
+      ControlSystemAdapterPVProvider::initialNotificationBatchSize.load(),
+      static_cast<long long>(
+        ControlSystemAdapterPVProvider::initialNotificationBatchIntervalMs.load()));
+    ::epicsStdoutPrintf(
+      "  Last value release threshold: %zu bytes\n",
+      ControlSystemAdapterPVProvider::lastValueReleaseThreshold.load());
+  }
+  ::epicsStdoutPrintf(
+    "  Notification delivery: %zu PVs with pending notifications\n",
+    this->pendingNotificationPVs.size());
+  for (std::size_t i = 0; i < this->deliveryLatencies.size(); ++i) {
+    auto const &statistics = this->deliveryLatencies[i];
+    ::epicsStdoutPrintf(
+      "  Notification latency (%s priority): %zu notifications, mean %.3f ms, last %.3f ms, max %.3f ms\n",
+      notificationPriorityNames[i], statistics.count,
+      statistics.count
+        ? toMilliseconds(statistics.total) / statistics.count : 0.0,
+      toMilliseconds(statistics.last), toMilliseconds(statistics.max));
+    if (statistics.valueAgeCount) {
+      ::epicsStdoutPrintf(
+        "  Value age (%s priority): mean %.3f ms, last %.3f ms\n",
+        notificationPriorityNames[i],
+        toMilliseconds(statistics.valueAgeTotal) / statistics.valueAgeCount,
+        toMilliseconds(statistics.valueAgeLast));
+    }
+  }
+  ::epicsStdoutPrintf(
+    "  Notification busy polling: %s, spin count %zu, max backoff %lld us\n",
+    this->notificationBusyPollEnabled.load() ? "enabled" : "disabled",
+    this->notificationBusyPollSpinCount.load(),
+    static_cast<long long>(this->notificationBusyPollMaxBackoffUs.load()));
+  if (this->busyPollNotificationCount) {
+    ::epicsStdoutPrintf(
+      "  Busy polling: %zu notifications, %.1f empty polls per notification\n",
+      this->busyPollNotificationCount,
+      static_cast<double>(this->busyPollEmptyCount)
+        / this->busyPollNotificationCount);
+  }
+  ::epicsStdoutPrintf(
+    "  Notification watchdog: timeout %lld ms\n",
+    static_cast<long long>(this->notificationWatchdogTimeout.count()));
+  ::epicsStdoutPrintf(
+    "  Stuck notifications: detected %zu times\n",
+    this->notificationWatchdogTriggerCount);
+  ::epicsStdoutPrintf(
+    "  Overload governor: backlog threshold %zu PVs, latency threshold %lld ms, restore delay %lld ms\n",
+    this->overloadBacklogThreshold,
+    static_cast<long long>(this->overloadLatencyThreshold.count()),
+    static_cast<long long>(this->overloadRestoreDelay.count()));
+  ::epicsStdoutPrintf(
+    "  Overload mode: %s, entered %zu times, left %zu times\n",
+    this->overloaded ? "active" : "inactive", this->overloadEnteredCount,
+    this->overloadLeftCount);
+  ::epicsStdoutPrintf(
+    "  Coalesced notifications: %zu, replaced before delivery %zu, %zu PVs pending\n",
+    this->coalescedNotificationCount, this->coalescedNotificationReplacedCount,
+    this->coalescedPVSupports.size());
+  if (!this->flightRecorders.empty()) {
+    ::epicsStdoutPrintf(
+      "  Flight recorders: %zu PVs, %s, frozen %zu times%s%s\n",
+      this->flightRecorders.size(),
+      this->flightRecordersFrozen ? "frozen" : "recording",
+      this->flightRecorderFreezeCount,
+      this->flightRecorderFreezeCount ? ", last frozen by " : "",
+      this->flightRecorderFreezeCount
+        ? this->flightRecordersFrozenBy.c_str() : "");
+    if (level > 0) {
+      for (auto &flightRecorder : this->flightRecorders) {
+        flightRecorder->report();
+      }
+    }
+  }
+  if (!this->sharedMemoryMirrorPVSupports.empty()) {
+    if (this->sharedMemoryMirror) {
+      ::epicsStdoutPrintf(
+        "  Shared-memory mirror: segment %s, %zu PVs, %zu bytes\n",
+        this->sharedMemoryMirror->getSegmentName().c_str(),
+        this->sharedMemoryMirror->getNumberOfSlots(),
+        this->sharedMemoryMirror->getSize());
+    } else {
+      ::epicsStdoutPrintf(
+        "  Shared-memory mirror: %zu PVs, not created\n",
+        this->sharedMemoryMirrorPVSupports.size());
+    }
+  }
+}
+
+void ControlSystemAdapterPVProvider::setFlightRecordersFrozen(bool frozen) {
+  std::function<void()> notifyFunction;
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    if (frozen) {
+      notifyFunction = this->freezeFlightRecorders("iocsh");
+    } else {
+      for (auto &flightRecorder : this->flightRecorders) {
+        flightRecorder->setFrozen(false);
+      }
+      this->flightRecordersFrozen = false;
+    }
+  }
+  // The records must be notified after releasing the lock, see doNotify().
+  if (notifyFunction) {
+    notifyFunction();
+  }
+}
+
+void ControlSystemAdapterPVProvider::setFlightRecorderTrigger(
+    std::string const &processVariableName) {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  this->getKeptSharedPVSupport(processVariableName)
+    ->flightRecorderTrigger = true;
+}
+
+void ControlSystemAdapterPVProvider::setInitialNotificationBatching(
+    std::size_t batchSize, std::chrono::milliseconds batchInterval) {
+  if (batchInterval.count() < 0) {
+    throw std::invalid_argument("The batch interval must not be negative.");
+  }
+  ControlSystemAdapterPVProvider::initialNotificationBatchSize = batchSize;
+  ControlSystemAdapterPVProvider::initialNotificationBatchIntervalMs =
+    batchInterval.count();
+}
+
+void ControlSystemAdapterPVProvider::setLastValueReleaseThreshold(
+    std::size_t threshold) {
+  ControlSystemAdapterPVProvider::lastValueReleaseThreshold = threshold;
+}
+
+void ControlSystemAdapterPVProvider::setNotificationBusyPoll(
+    bool enabled, std::size_t spinCount,
+    std::chrono::microseconds maxBackoff) {
+  this->notificationBusyPollSpinCount = spinCount;
+  this->notificationBusyPollMaxBackoffUs = maxBackoff.count();
+  this->notificationBusyPollEnabled = enabled;
+}
+
+void ControlSystemAdapterPVProvider::setNotificationPriority(
+    std::string const &processVariableName, NotificationPriority priority) {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  auto &name = InternedNameTable::internNormalizedRegisterPath(
+    processVariableName);
+  // The last element of pvsForNotification is our internal wake-up PV, so we
+  // do not include it in the search.
+  for (std::size_t index = 0; index + 1 < this->pvsForNotification.size();
+      ++index) {
+    if (name == this->pvsForNotification[index]->getName()) {
+      // Once the notification threads have been started, a PV cannot be moved
+      // between the read-any groups any longer.
+      auto &currentPriority = this->notificationPriorities[index];
+      if (this->notificationDeliveryStarted
+          && (currentPriority == NotificationPriority::high)
+            != (priority == NotificationPriority::high)) {
+        throw std::logic_error(
+          "The high priority cannot be set or removed after the IOC has been started.");
+      }
+      currentPriority = priority;
+      return;
+    }
+  }
+  throw std::invalid_argument(
+    std::string("The process variable '") + name
+      + "' does not exist or does not support notifications.");
+}
+
+void ControlSystemAdapterPVProvider::setNotificationWatchdog(
+    std::chrono::milliseconds timeout) {
+  if (timeout.count() < 0) {
+    throw std::invalid_argument("The timeout must not be negative.");
+  }
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  this->notificationWatchdogTimeout = timeout;
+  // Before the IOC has been initialized, finalizeInitialization() takes care
+  // of scheduling the watchdog.
+  if (this->notificationDeliveryStarted) {
+    this->scheduleNotificationWatchdog();
+  }
+}
+
+void ControlSystemAdapterPVProvider::setOverloadGovernor(
+    std::size_t backlogThreshold, std::chrono::milliseconds latencyThreshold,
+    std::chrono::milliseconds restoreDelay) {
+  if (latencyThreshold.count() < 0) {
+    throw std::invalid_argument("The latency threshold must not be negative.");
+  }
+  if (restoreDelay.count() < 0) {
+    throw std::invalid_argument("The restore delay must not be negative.");
+  }
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  this->overloadBacklogThreshold = backlogThreshold;
+  this->overloadLatencyThreshold = latencyThreshold;
+  this->overloadRestoreDelay = restoreDelay;
+  // The notification threads might be waiting with a timeout that depends on
+  // the latency threshold, so we wake them up.
+  this->notificationThreadCv.notify_all();
+}
+
+void ControlSystemAdapterPVProvider::setSharedMemoryMirror(
+    std::string const &segmentName, std::string const &indexFileName) {
+  if (segmentName.empty()) {
+    throw std::invalid_argument("The segment name must not be empty.");
+  }
+  if (indexFileName.empty()) {
+    throw std::invalid_argument("The index file name must not be empty.");
+  }
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  if (this->notificationDeliveryStarted) {
+    throw std::logic_error(
+      "The shared-memory mirror must be configured before the IOC is started.");
+  }
+  this->sharedMemoryMirrorSegmentName = segmentName;
+  this->sharedMemoryMirrorIndexFileName = indexFileName;
+}
+
 ControlSystemAdapterPVProvider::~ControlSystemAdapterPVProvider() {
   {
     std::lock_guard<std::recursive_mutex> lock(this->mutex);
     this->notificationThreadShutdownRequested = true;
     this->wakeUpNotificationThread();
+    if (this->highPriorityWakeUpPV) {
+      this->highPriorityWakeUpPV->write();
+    }
   }
   this->notificationThread.join();
+  if (this->highPriorityNotificationThread.joinable()) {
+    this->highPriorityNotificationThread.join();
+  }
 }
 
 PVSupportBase::SharedPtr ControlSystemAdapterPVProvider::createPVSupport(
@@ -179,7 +557,10 @@ PVSupportBase::SharedPtr ControlSystemAdapterPVProvider::createPVSupportInternal
   std::lock_guard<std::recursive_mutex> lock(this->mutex);
   // We normalize the PV name so that names that look different but actually
   // represent the same PV get resolved to the same shared PV support instance.
-  std::string name = RegisterPath(processVariableName);
+  // The normalized name is cached by the name table, so that we do not have to
+  // normalize the same name again for each record.
+  auto &name = InternedNameTable::internNormalizedRegisterPath(
+    processVariableName);
   std::shared_ptr<ControlSystemAdapterSharedPVSupportBase> shared;
   // We try to find an existing shared instance. If we cannot find an entry for
   // the process variable name or the weak pointer of the entry has expired, we
@@ -248,6 +629,234 @@ void ControlSystemAdapterPVProvider::insertCreatePVSupportFunc() {
           &ControlSystemAdapterPVProvider::createPVSupportInternal<T>));
 }
 
+void ControlSystemAdapterPVProvider::createSharedMemoryMirror() {
+  // The code calling this method already acquires a lock on the mutex.
+  if (this->sharedMemoryMirrorPVSupports.empty()) {
+    return;
+  }
+  if (this->sharedMemoryMirrorSegmentName.empty()) {
+    errorPrintf(
+      "Could not create the shared-memory mirror: Process variables have been added to the mirror, but no segment has been configured with chimeraTKSetSharedMemoryMirror.");
+    return;
+  }
+  try {
+    std::vector<SharedMemoryMirror::SlotDefinition> slotDefinitions;
+    slotDefinitions.reserve(this->sharedMemoryMirrorPVSupports.size());
+    for (auto &pvSupport : this->sharedMemoryMirrorPVSupports) {
+      slotDefinitions.push_back(
+        pvSupport->getSharedMemoryMirrorSlotDefinition());
+    }
+    auto mirror = std::make_shared<SharedMemoryMirror>(
+      this->sharedMemoryMirrorSegmentName,
+      this->sharedMemoryMirrorIndexFileName, slotDefinitions);
+    for (std::size_t slotIndex = 0;
+        slotIndex < this->sharedMemoryMirrorPVSupports.size(); ++slotIndex) {
+      this->sharedMemoryMirrorPVSupports[slotIndex]->setSharedMemoryMirrorSlot(
+        mirror, slotIndex);
+    }
+    this->sharedMemoryMirror = std::move(mirror);
+  } catch (std::exception &e) {
+    errorPrintf("Could not create the shared-memory mirror: %s", e.what());
+  }
+}
+
+std::function<void()> ControlSystemAdapterPVProvider::freezeFlightRecorders(
+    std::string const &reason) {
+  // The code calling this method already acquires a lock on the mutex.
+  if (this->flightRecordersFrozen) {
+    return std::function<void()>();
+  }
+  this->flightRecordersFrozen = true;
+  this->flightRecordersFrozenBy = reason;
+  ++this->flightRecorderFreezeCount;
+  std::function<void()> notifyFunction;
+  for (auto &flightRecorder : this->flightRecorders) {
+    notifyFunction = detail::chainFunctions(
+      std::move(notifyFunction), flightRecorder->setFrozen(true));
+  }
+  return notifyFunction;
+}
+
+std::shared_ptr<ControlSystemAdapterSharedPVSupportBase> ControlSystemAdapterPVProvider::getKeptSharedPVSupport(
+    std::string const &processVariableName) {
+  // The code calling this method already acquires a lock on the mutex.
+  // Once the application has been started, a PV that has not been used by
+  // any record might already have been reported as unmapped, so it would not
+  // receive any updates.
+  if (this->notificationDeliveryStarted) {
+    throw std::logic_error(
+      "Flight recorders, their triggers, and shared-memory mirrors must be configured before the IOC is started.");
+  }
+  auto &name = InternedNameTable::internNormalizedRegisterPath(
+    processVariableName);
+  // The last element of pvsForNotification is our internal wake-up PV, so we
+  // do not include it in the search.
+  bool found = false;
+  for (std::size_t index = 0; index + 1 < this->pvsForNotification.size();
+      ++index) {
+    if (name == this->pvsForNotification[index]->getName()) {
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    throw std::invalid_argument(
+      std::string("The process variable '") + name
+        + "' does not exist or does not support notifications.");
+  }
+  auto pvSupport = this->createPVSupport(name, this->getDefaultType(name));
+  this->keptPVSupports.push_back(pvSupport);
+  return this->sharedPVSupports.at(name).lock();
+}
+
+std::vector<std::size_t> ControlSystemAdapterPVProvider::getNotificationPVIndices(
+    bool highPriority) {
+  // This method is only called while already holding a lock on the mutex.
+  std::vector<std::size_t> pvIndices;
+  // The last element of pvsForNotification is our internal wake-up PV, so we
+  // do not include it.
+  for (std::size_t index = 0; index + 1 < this->pvsForNotification.size();
+      ++index) {
+    if ((this->notificationPriorities[index] == NotificationPriority::high)
+        == highPriority) {
+      pvIndices.push_back(index);
+    }
+  }
+  return pvIndices;
+}
+
+ReadAnyGroup::Notification ControlSystemAdapterPVProvider::pollNotification(
+    ReadAnyGroup &group, std::size_t &emptyPolls) {
+  std::chrono::microseconds backoff(1);
+  while (true) {
+    auto notification = group.waitAnyNonBlocking();
+    if (notification.isReady()) {
+      return notification;
+    }
+    ++emptyPolls;
+    // The settings are checked on each iteration, so that they can be changed
+    // while this thread is waiting.
+    if (!this->notificationBusyPollEnabled) {
+      return group.waitAny();
+    }
+    if (emptyPolls < this->notificationBusyPollSpinCount) {
+      continue;
+    }
+    std::chrono::microseconds maxBackoff(
+      this->notificationBusyPollMaxBackoffUs.load());
+    if (maxBackoff.count()) {
+      std::this_thread::sleep_for(backoff);
+      backoff = std::min(backoff * 2, maxBackoff);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool ControlSystemAdapterPVProvider::initialNotificationBatchDue() {
+  // This method is only called while already holding a lock on the mutex.
+  if (this->initialNotificationQueue.empty()) {
+    return false;
+  }
+  std::chrono::milliseconds batchInterval(
+    ControlSystemAdapterPVProvider::initialNotificationBatchIntervalMs.load());
+  return std::chrono::steady_clock::now()
+    >= this->lastInitialNotificationBatchStart + batchInterval;
+}
+
+void ControlSystemAdapterPVProvider::queueInitialNotifications(
+    std::shared_ptr<ControlSystemAdapterSharedPVSupportBase> const &sharedPVSupport) {
+  // This method is only called while already holding a lock on the mutex.
+  if (this->notificationThreadShutdownRequested) {
+    throw std::runtime_error(
+      "Initial notifications cannot be queued because this PV provider is being destroyed.");
+  }
+  // We only have to wake up the notification thread when the queue was empty.
+  // Otherwise, it is already going to process the queue, so waking it up once
+  // per PV would only flood it with wake-up notifications.
+  bool wasEmpty = this->initialNotificationQueue.empty();
+  this->initialNotificationQueue.push(sharedPVSupport);
+  if (wasEmpty) {
+    this->initialNotificationBurstStart = std::chrono::steady_clock::now();
+    this->wakeUpNotificationThread();
+  }
+}
+
+void ControlSystemAdapterPVProvider::runInitialNotificationBatch(
+    std::unique_lock<std::recursive_mutex> &lock) {
+  if (this->initialNotificationQueue.empty()) {
+    return;
+  }
+  this->lastInitialNotificationBatchStart = std::chrono::steady_clock::now();
+  auto batchSize = ControlSystemAdapterPVProvider::initialNotificationBatchSize.load();
+  std::vector<std::function<void()>> notifyFunctions;
+  while (!this->initialNotificationQueue.empty()
+      && (batchSize == 0 || notifyFunctions.size() < batchSize)) {
+    auto sharedPVSupport = this->initialNotificationQueue.front().lock();
+    this->initialNotificationQueue.pop();
+    // If the PV support has been destroyed in the meantime, there is nobody
+    // left who could be notified.
+    if (!sharedPVSupport) {
+      continue;
+    }
+    auto notifyFunction = sharedPVSupport->doInitialNotifications();
+    if (notifyFunction) {
+      notifyFunctions.push_back(std::move(notifyFunction));
+    }
+  }
+  ++this->initialNotificationBatchCount;
+  this->initialNotificationCount += notifyFunctions.size();
+  if (this->initialNotificationQueue.empty()) {
+    auto burstDuration = std::chrono::steady_clock::now()
+      - this->initialNotificationBurstStart;
+    this->lastInitialNotificationBurstDuration = burstDuration;
+    if (burstDuration > this->longestInitialNotificationBurstDuration) {
+      this->longestInitialNotificationBurstDuration = burstDuration;
+    }
+  }
+  // We do not want to hold the lock on the mutex while calling the callbacks.
+  lock.unlock();
+  for (auto &notifyFunction : notifyFunctions) {
+    notifyFunction();
+  }
+  lock.lock();
+}
+
+void ControlSystemAdapterPVProvider::runCoalescedNotifications(
+    std::unique_lock<std::recursive_mutex> &lock) {
+  if (this->coalescedPVSupports.empty()) {
+    return;
+  }
+  std::vector<std::function<void()>> notifyFunctions;
+  for (auto i = this->coalescedPVSupports.begin();
+      i != this->coalescedPVSupports.end();) {
+    auto sharedPVSupport = i->lock();
+    // If the PV support has been destroyed in the meantime, there is nobody
+    // left who could be notified. If it is still busy with the previous value,
+    // we keep it in the list, and it is going to wake us up when it is ready.
+    if (sharedPVSupport && !sharedPVSupport->readyForNextNotification()) {
+      ++i;
+      continue;
+    }
+    if (sharedPVSupport) {
+      auto notifyFunction = sharedPVSupport->doCoalescedNotify();
+      if (notifyFunction) {
+        notifyFunctions.push_back(std::move(notifyFunction));
+      }
+    }
+    i = this->coalescedPVSupports.erase(i);
+  }
+  if (notifyFunctions.empty()) {
+    return;
+  }
+  // We do not want to hold the lock on the mutex while calling the callbacks.
+  lock.unlock();
+  for (auto &notifyFunction : notifyFunctions) {
+    notifyFunction();
+  }
+  lock.lock();
+}
+
 void ControlSystemAdapterPVProvider::runInNotificationThread(
     std::function<void()> const &task) {
   // This method is only called while already holding a lock on the mutex.
@@ -259,107 +868,385 @@ void ControlSystemAdapterPVProvider::runInNotificationThread(
   this->wakeUpNotificationThread();
 }
 
-void ControlSystemAdapterPVProvider::runNotificationThread() {
-  try {
-    // We create a read-any group that will allow us to wait for any of the PVs
-    // (supporting notifications) to receive an update notification. This list
-    // of PVs includes our special wake-up PV that we use to wake up this thread
-    // while it is waiting for a notification.
-    ReadAnyGroup notificationGroup(
-        this->pvsForNotification.begin(), this->pvsForNotification.end());
-    // We cannot check the abort condition here because we have to hold a lock on
-    // the mutex while checking the condition.
-    while (true) {
-      ReadAnyGroup::Notification notification;
-      // We have to call waitAny before acquiring the mutex. Otherwise, we would
-      // block the mutex while waiting and the thread could never be woken up,
-      // because the code sending the wake-up request has to acquire the mutex
-      // as well.
+void ControlSystemAdapterPVProvider::deliverNotifications(
+    std::vector<std::size_t> const &pvIndices,
+    ProcessVariable::SharedPtr const &wakeUpPVReceiver, bool mainThread) {
+  // We create a read-any group that will allow us to wait for any of the PVs
+  // (supporting notifications) to receive an update notification. This list
+  // of PVs includes our special wake-up PV that we use to wake up this thread
+  // while it is waiting for a notification.
+  std::vector<ProcessVariable::SharedPtr> pvs;
+  pvs.reserve(pvIndices.size() + 1);
+  for (auto index : pvIndices) {
+    pvs.push_back(this->pvsForNotification[index]);
+  }
+  pvs.push_back(wakeUpPVReceiver);
+  ReadAnyGroup notificationGroup(pvs.begin(), pvs.end());
+  // We cannot check the abort condition here because we have to hold a lock on
+  // the mutex while checking the condition.
+  while (true) {
+    ReadAnyGroup::Notification notification;
+    // We have to call waitAny before acquiring the mutex. Otherwise, we would
+    // block the mutex while waiting and the thread could never be woken up,
+    // because the code sending the wake-up request has to acquire the mutex
+    // as well.
+    // The high-priority notification thread may use busy polling instead of
+    // blocking, so that it does not have to be woken up.
+    std::size_t emptyPolls = 0;
+    bool polled = !mainThread && this->notificationBusyPollEnabled;
+    if (polled) {
+      notification = this->pollNotification(notificationGroup, emptyPolls);
+    } else {
       notification = notificationGroup.waitAny();
-      // We limit the code where we hold the mutex to the part where it is
-      // really needed. In particular, we do not want to hold the lock when
-      // calling notification callbacks as this could result in a deadlock in
-      // the worst case.
-      std::function<void()> notifyFunction;
-      {
-        std::unique_lock<std::recursive_mutex> lock(this->mutex);
-        // If there are any notification tasks, we execute them now.
-        while (!this->tasks.empty()) {
-          auto task = std::move(this->tasks.front());
-          this->tasks.pop();
-          // We do not want to hold the lock on the mutex while executing the
-          // task.
-          lock.unlock();
-          task();
-          lock.lock();
-        }
-        // If a shutdown has been requested, we quit immediately.
-        if (this->notificationThreadShutdownRequested) {
-          return;
-        }
-        auto sharedPVSupport =
-            this->sharedPVSupportsByIndex[notification.getIndex()].lock();
-        if (sharedPVSupport) {
-          // We cannot process the notification if an earlier notification for
-          // the same PV is still being processed. In this case we sleep until
-          // this thread is woken up and then check again. When a PV support is
-          // finished with the notification process, it will wake up this
-          // thread, so we should eventually wake up and find that we can
-          // process the notification.
-          while (!sharedPVSupport->readyForNextNotification()) {
-            this->notificationThreadCv.wait(lock);
-            // If there are any notification tasks, we execute them now. We have
-            // to do this here because we might sleep again if the PV support is
-            // still not ready for the next notification.
-            while (!this->tasks.empty()) {
-              auto task = std::move(this->tasks.front());
-              this->tasks.pop();
-              // We do not want to hold the lock on the mutex while executing
-              // the task.
-              lock.unlock();
-              task();
-              lock.lock();
+    }
+    auto receivedTime = std::chrono::steady_clock::now();
+    // We limit the code where we hold the mutex to the part where it is
+    // really needed. In particular, we do not want to hold the lock when
+    // calling notification callbacks as this could result in a deadlock in
+    // the worst case.
+    std::function<void()> notifyFunction;
+    {
+      std::unique_lock<std::recursive_mutex> lock(this->mutex);
+      if (polled) {
+        ++this->busyPollNotificationCount;
+        this->busyPollEmptyCount += emptyPolls;
+      }
+      // If there are any notification tasks or initial notifications, we
+      // process them now.
+      if (mainThread) {
+        this->runPendingTasks(lock);
+      }
+      // If a shutdown has been requested, we quit immediately.
+      if (this->notificationThreadShutdownRequested) {
+        return;
+      }
+      // The indices used by the read-any group are the indices into
+      // pvIndices. The wake-up PV comes after all other PVs, so it does not
+      // have a corresponding entry in pvIndices.
+      auto groupIndex = notification.getIndex();
+      std::size_t index = 0;
+      std::shared_ptr<ControlSystemAdapterSharedPVSupportBase> sharedPVSupport;
+      if (groupIndex < pvIndices.size()) {
+        index = pvIndices[groupIndex];
+        sharedPVSupport = this->sharedPVSupportsByIndex[index].lock();
+      }
+      if (sharedPVSupport) {
+        // We cannot process the notification if an earlier notification for
+        // the same PV is still being processed. In this case we sleep until
+        // this thread is woken up and then check again. When a PV support is
+        // finished with the notification process, it will wake up this
+        // thread, so we should eventually wake up and find that we can
+        // process the notification.
+        // If there is a coalesced value that has not been delivered yet, it
+        // has to be delivered before the new value, so we also have to wait
+        // in this case.
+        bool coalesced = false;
+        while (!sharedPVSupport->readyForNextNotification()
+            || sharedPVSupport->hasCoalescedNotification()) {
+          this->updateOverloadState(
+            std::chrono::steady_clock::now() - receivedTime);
+          // When notification delivery is overloaded, we do not wait for
+          // PVs with a low priority. Instead, we keep the new value, so that
+          // it can be delivered once the PV support is ready, and continue
+          // with the next notification.
+          if (this->overloaded && this->notificationPriorities[index]
+              == NotificationPriority::low) {
+            if (sharedPVSupport->coalesceNotification(notification)) {
+              ++this->coalescedNotificationReplacedCount;
+            } else {
+              this->coalescedPVSupports.push_back(sharedPVSupport);
             }
-            // If a shutdown has been requested, we quit immediately.
-            if (this->notificationThreadShutdownRequested) {
-              return;
+            ++this->coalescedNotificationCount;
+            coalesced = true;
+            break;
+          }
+          // If the next batch of initial notifications is due, we must not
+          // sleep. The PV support might be waiting for exactly these
+          // notifications, so we could end up waiting forever. We also do
+          // not sleep when the PV support is ready and only the coalesced
+          // value has to be delivered, because this is done by
+          // runPendingTasks(...). Both only apply to the main thread. The
+          // high-priority thread relies on the main thread for delivering
+          // initial notifications, and it never sees coalesced values.
+          if (!(mainThread && this->initialNotificationBatchDue())
+              && !sharedPVSupport->readyForNextNotification()) {
+            // If the overload governor checks the latency, we have to wake
+            // up when the latency threshold is exceeded, so that we can
+            // enter the overload mode even if the PV support does not
+            // become ready.
+            if (this->overloadLatencyThreshold.count() && !this->overloaded) {
+              this->notificationThreadCv.wait_until(
+                lock, receivedTime + this->overloadLatencyThreshold);
+            } else {
+              this->notificationThreadCv.wait(lock);
             }
           }
-          // We know that at that point, the task queue is empty. Tasks are only
-          // added while holding a lock on the mutex and we checked that the
-          // queue is empty after acquiring the mutex.
-          // This is important because we use the task queue to notify callbacks
-          // with the current value and the same callback will only be called
-          // when there actually is a new value (that we might accept right in
-          // the next line).
-          if (notification.accept()) {
-            notifyFunction = sharedPVSupport->doNotify();
+          // If there are any notification tasks or initial notifications, we
+          // process them now. We have to do this here because we might sleep
+          // again if the PV support is still not ready for the next
+          // notification.
+          if (mainThread) {
+            this->runPendingTasks(lock);
           }
-        } else {
-          // If the notification is for a PV for which there is no PV support
-          // (yet), we can simply accept it. Note that this would also happen
-          // through the destructor of the notification object, but doing it
-          // explicitly looks cleaner.
-          notification.accept();
+          // If a shutdown has been requested, we quit immediately.
+          if (this->notificationThreadShutdownRequested) {
+            return;
+          }
+        }
+        // We know that at that point, there are no initial notifications
+        // pending for this PV: Each initial notification increments the
+        // PV support's notification pending count, so the PV support is only
+        // ready for the next notification after all its initial
+        // notifications have been delivered and processed.
+        // This is important because the initial notifications notify
+        // callbacks with the current value and the same callback will only
+        // be called when there actually is a new value (that we might accept
+        // right in the next line).
+        auto &statistics = this->deliveryLatencies[
+          static_cast<std::size_t>(this->notificationPriorities[index])];
+        if (!coalesced && notification.accept()) {
+          notifyFunction = sharedPVSupport->doNotify();
+          // The version number of a value usually stores the time when the
+          // value was written by the application, so its age tells us the
+          // latency of the whole path up to this point, including the time
+          // needed for waking this thread up.
+          auto valueAge = std::chrono::system_clock::now()
+            - this->pvsForNotification[index]->getVersionNumber().getTime();
+          ++statistics.valueAgeCount;
+          statistics.valueAgeLast = valueAge;
+          statistics.valueAgeTotal += valueAge;
         }
+        auto latency = std::chrono::steady_clock::now() - receivedTime;
+        ++statistics.count;
+        statistics.last = latency;
+        statistics.total += latency;
+        if (latency > statistics.max) {
+          statistics.max = latency;
+        }
+        this->updateOverloadState(latency);
+      } else {
+        // If the notification is for a PV for which there is no PV support
+        // (yet), we can simply accept it. Note that this would also happen
+        // through the destructor of the notification object, but doing it
+        // explicitly looks cleaner.
+        notification.accept();
       }
-      // After releasing the lock, we call the notify function. It is important
-      // that we do not do this while holding the lock because we would risk a
-      // deadlock.
-      if (notifyFunction) {
-        notifyFunction();
+      // If there are more initial notifications that are due, we make sure
+      // that we do not block in the next call to waitAny().
+      if (mainThread && this->initialNotificationBatchDue()) {
+        this->wakeUpPV->write();
       }
     }
+    // After releasing the lock, we call the notify function. It is important
+    // that we do not do this while holding the lock because we would risk a
+    // deadlock.
+    if (notifyFunction) {
+      notifyFunction();
+    }
+  }
+}
+
+void ControlSystemAdapterPVProvider::runHighPriorityNotificationThread() {
+  try {
+    std::vector<std::size_t> pvIndices;
+    {
+      std::lock_guard<std::recursive_mutex> lock(this->mutex);
+      pvIndices = this->getNotificationPVIndices(true);
+    }
+    this->deliverNotifications(
+      pvIndices, this->highPriorityWakeUpPVReceiver, false);
   } catch (boost::thread_interrupted &) {
     return;
   }
 }
 
+void ControlSystemAdapterPVProvider::runNotificationThread() {
+  try {
+    std::vector<std::size_t> pvIndices;
+    {
+      std::unique_lock<std::recursive_mutex> lock(this->mutex);
+      // Until finalizeInitialization() has been called, the priorities of the
+      // PVs may still change, so we cannot create the read-any group yet.
+      // Until then, we only deliver initial notifications and run tasks.
+      // Regular notifications are queued by the PVs, so they are not lost.
+      while (!this->notificationDeliveryStarted) {
+        this->runPendingTasks(lock);
+        // If a shutdown has been requested, we quit immediately.
+        if (this->notificationThreadShutdownRequested) {
+          return;
+        }
+        if (!this->notificationDeliveryStarted
+            && !this->initialNotificationBatchDue()) {
+          this->notificationThreadCv.wait(lock);
+        }
+      }
+      pvIndices = this->getNotificationPVIndices(false);
+    }
+    this->deliverNotifications(
+      pvIndices, this->pvsForNotification.back(), true);
+  } catch (boost::thread_interrupted &) {
+    return;
+  }
+}
+
+void ControlSystemAdapterPVProvider::runPendingTasks(
+    std::unique_lock<std::recursive_mutex> &lock) {
+  while (!this->tasks.empty()) {
+    auto task = std::move(this->tasks.front());
+    this->tasks.pop();
+    // We do not want to hold the lock on the mutex while executing the task.
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+  this->runCoalescedNotifications(lock);
+  if (this->initialNotificationBatchDue()) {
+    this->runInitialNotificationBatch(lock);
+  } else if (!this->initialNotificationQueue.empty()
+      && !this->initialNotificationWakeUpScheduled) {
+    // The next batch is not due yet, so we schedule a task that wakes up this
+    // thread when it is due.
+    std::weak_ptr<ControlSystemAdapterPVProvider> weakThis =
+      this->shared_from_this();
+    auto delay = this->lastInitialNotificationBatchStart
+      + std::chrono::milliseconds(
+        ControlSystemAdapterPVProvider::initialNotificationBatchIntervalMs.load())
+      - std::chrono::steady_clock::now();
+    this->initialNotificationWakeUpScheduled = true;
+    Timer::shared().submitDelayedTask(delay, [weakThis](){
+      auto sharedThis = weakThis.lock();
+      if (!sharedThis) {
+        return;
+      }
+      std::lock_guard<std::recursive_mutex> lock(sharedThis->mutex);
+      sharedThis->initialNotificationWakeUpScheduled = false;
+      if (!sharedThis->notificationThreadShutdownRequested) {
+        sharedThis->wakeUpNotificationThread();
+      }
+    });
+  }
+}
+
+std::vector<std::string> ControlSystemAdapterPVProvider::runNotificationWatchdog() {
+  // This method is only called while already holding a lock on the mutex.
+  std::vector<std::string> messages;
+  // If the watchdog has been disabled in the meantime, we neither check nor
+  // schedule it again.
+  if (!this->notificationWatchdogTimeout.count()) {
+    return messages;
+  }
+  // Only PVs with pending notifications can be stuck, so we do not look at the
+  // other PVs.
+  auto now = std::chrono::steady_clock::now();
+  for (auto const &entry : this->pendingNotificationPVs) {
+    auto sharedPVSupport = entry.second.lock();
+    std::string message;
+    if (sharedPVSupport && sharedPVSupport->checkNotificationWatchdog(
+        now, this->notificationWatchdogTimeout, message)) {
+      ++this->notificationWatchdogTriggerCount;
+      messages.push_back(std::move(message));
+    }
+  }
+  this->scheduleNotificationWatchdog();
+  return messages;
+}
+
+void ControlSystemAdapterPVProvider::scheduleNotificationWatchdog() {
+  // This method is only called while already holding a lock on the mutex.
+  if (this->notificationWatchdogScheduled
+      || this->notificationThreadShutdownRequested
+      || !this->notificationWatchdogTimeout.count()) {
+    return;
+  }
+  // We check four times per timeout, so that a stuck notification is detected
+  // no later than 1.25 times the timeout. We check at least once per second,
+  // so that a shorter timeout set later takes effect quickly.
+  auto delay = std::max(
+    std::chrono::milliseconds(10),
+    std::min(std::chrono::milliseconds(1000),
+      this->notificationWatchdogTimeout / 4));
+  std::weak_ptr<ControlSystemAdapterPVProvider> weakThis =
+    this->shared_from_this();
+  this->notificationWatchdogScheduled = true;
+  Timer::shared().submitDelayedTask(delay, [weakThis](){
+    auto sharedThis = weakThis.lock();
+    if (!sharedThis) {
+      return;
+    }
+    std::unique_lock<std::recursive_mutex> lock(sharedThis->mutex);
+    sharedThis->notificationWatchdogScheduled = false;
+    auto messages = sharedThis->runNotificationWatchdog();
+    // Printing the messages might block, so we do not hold the lock while
+    // doing so.
+    lock.unlock();
+    for (auto const &message : messages) {
+      errorExtendedPrintf("%s", message.c_str());
+    }
+  });
+}
+
+void ControlSystemAdapterPVProvider::startNotificationDelivery() {
+  // This method is only called while already holding a lock on the mutex.
+  if (this->notificationDeliveryStarted) {
+    return;
+  }
+  this->notificationDeliveryStarted = true;
+  // We only start the high-priority notification thread if there is at least
+  // one PV that needs it.
+  if (!this->getNotificationPVIndices(true).empty()) {
+    auto wakeUpPVSenderAndReceiver = createSynchronizedProcessArray<int>(1);
+    this->highPriorityWakeUpPV = wakeUpPVSenderAndReceiver.first;
+    this->highPriorityWakeUpPVReceiver = wakeUpPVSenderAndReceiver.second;
+    this->highPriorityNotificationThread =
+      std::thread([this]{
+        applyThreadSettings(this->highPriorityNotificationThreadSettings);
+        this->runHighPriorityNotificationThread();
+      });
+  }
+  // The main notification thread is waiting for this flag to be set.
+  this->notificationThreadCv.notify_all();
+}
+
+void ControlSystemAdapterPVProvider::updateOverloadState(
+    std::chrono::steady_clock::duration latency) {
+  // This method is only called while already holding a lock on the mutex.
+  auto now = std::chrono::steady_clock::now();
+  bool aboveThreshold =
+    (this->overloadBacklogThreshold
+      && this->pendingNotificationPVs.size() > this->overloadBacklogThreshold)
+    || (this->overloadLatencyThreshold.count()
+      && latency > this->overloadLatencyThreshold);
+  if (aboveThreshold) {
+    this->overloadLastSeen = now;
+    if (!this->overloaded) {
+      this->overloaded = true;
+      ++this->overloadEnteredCount;
+      errorExtendedPrintf(
+        "Notification delivery is overloaded (%zu PVs with pending notifications, latency %.3f ms). Switching low-priority PVs to coalescing mode.",
+        this->pendingNotificationPVs.size(), toMilliseconds(latency));
+    }
+  } else if (this->overloaded
+      && now - this->overloadLastSeen >= this->overloadRestoreDelay) {
+    // If the overload governor has been disabled in the meantime, both
+    // thresholds are zero, so we also end up here.
+    this->overloaded = false;
+    ++this->overloadLeftCount;
+    errorExtendedPrintf(
+      "Notification delivery has recovered from overload (%zu PVs with pending notifications, latency %.3f ms). Switching low-priority PVs back to regular mode.",
+      this->pendingNotificationPVs.size(), toMilliseconds(latency));
+  }
+}
+
 void ControlSystemAdapterPVProvider::wakeUpNotificationThread() {
   // This method is only called while already holding a lock on the mutex.
   this->wakeUpPV->write();
   this->notificationThreadCv.notify_all();
 }
 
+// Static member variables need an instance...
+std::atomic<std::size_t> ControlSystemAdapterPVProvider::initialNotificationBatchSize(1000);
+std::atomic<std::chrono::milliseconds::rep> ControlSystemAdapterPVProvider::initialNotificationBatchIntervalMs(0);
+std::atomic<std::size_t> ControlSystemAdapterPVProvider::lastValueReleaseThreshold(0);
+
 } // namespace EPICS
 } // namespace ChimeraTK
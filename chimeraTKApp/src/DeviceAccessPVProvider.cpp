@@ -17,20 +17,59 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+#include <epicsStdio.h>
+} // extern "C"
 
 #include "ChimeraTK/EPICS/DeviceAccessPVSupport.h"
+#include "ChimeraTK/EPICS/InternedNameTable.h"
 
 #include "ChimeraTK/EPICS/DeviceAccessPVProviderImpl.h"
 
 namespace ChimeraTK {
 namespace EPICS {
 
+namespace {
+
+/**
+ * Returns the default type for a register with the specified data descriptor.
+ */
+std::type_info const &getDefaultTypeForDataDescriptor(
+    DataDescriptor const &dataDescriptor) {
+  switch (dataDescriptor.fundamentalType()) {
+    case DataDescriptor::FundamentalType::numeric:
+      if (dataDescriptor.isIntegral()) {
+        if (dataDescriptor.isSigned()) {
+          return typeid(std::int32_t);
+        } else {
+          return typeid(std::uint32_t);
+        }
+      } else {
+        return typeid(double);
+      }
+    case DataDescriptor::FundamentalType::boolean:
+      return typeid(std::uint32_t);
+    default:
+      return typeid(nullptr_t);
+  }
+}
+
+} // anonymous namespace
+
 DeviceAccessPVProvider::DeviceAccessPVProvider(
-    std::string const &deviceAliasName, int numberOfIoThreads)
-    : ioExecutor(numberOfIoThreads) {
+    std::string const &deviceAliasName, int numberOfIoThreads,
+    ThreadSettings const &ioThreadSettings)
+    : ioExecutor(numberOfIoThreads, ioThreadSettings),
+      numberOfIoThreads(numberOfIoThreads), readCachesUsed(false),
+      registerIndexBuilt(false) {
   if (numberOfIoThreads < 0) {
     throw std::invalid_argument(
       "The number of I/O threads must not be negative.");
@@ -56,32 +95,116 @@ DeviceAccessPVProvider::~DeviceAccessPVProvider() {
   this->device.close();
 }
 
+void DeviceAccessPVProvider::flushInitialValueRequests() {
+  std::vector<std::unique_ptr<detail::DeviceAccessInitialValueRequestBase>> requests;
+  {
+    std::lock_guard<std::mutex> lock(this->initialValueRequestsMutex);
+    requests.swap(this->initialValueRequests);
+  }
+  if (requests.empty()) {
+    return;
+  }
+  if (this->synchronous) {
+    this->processInitialValueRequests(requests);
+    return;
+  }
+  // We split the requests into one batch per I/O thread, so that a device that
+  // benefits from parallel I/O operations can process them in parallel, while
+  // each batch still benefits from using a single transfer group.
+  auto numberOfBatches = std::min(this->numberOfIoThreads, requests.size());
+  auto batchSize = (requests.size() + numberOfBatches - 1) / numberOfBatches;
+  auto sharedThis = this->shared_from_this();
+  for (std::size_t batchStart = 0; batchStart < requests.size();
+      batchStart += batchSize) {
+    auto batchEnd = std::min(batchStart + batchSize, requests.size());
+    auto batch = std::make_shared<std::vector<std::unique_ptr<detail::DeviceAccessInitialValueRequestBase>>>(
+      std::make_move_iterator(requests.begin() + batchStart),
+      std::make_move_iterator(requests.begin() + batchEnd));
+    this->ioExecutor.submitTask([sharedThis, batch](){
+      sharedThis->processInitialValueRequests(*batch);
+    });
+  }
+}
+
 std::type_info const &DeviceAccessPVProvider::getDefaultType(
     std::string const &processVariableName) {
-  auto registerCatalog = this->device.getRegisterCatalogue();
-  RegisterPath registerPath(processVariableName);
-  if (!registerCatalog.hasRegister(registerPath)) {
+  auto registerInfo = this->findRegister(processVariableName);
+  if (!registerInfo) {
     throw std::invalid_argument(
       std::string("The process variable '") + processVariableName
       + "' does not exist.");
   }
-  auto registerInfo = registerCatalog.getRegister(registerPath);
-  auto &dataDescriptor = registerInfo.getDataDescriptor();
-  switch (dataDescriptor.fundamentalType()) {
-    case DataDescriptor::FundamentalType::numeric:
-      if (dataDescriptor.isIntegral()) {
-        if (dataDescriptor.isSigned()) {
-          return typeid(std::int32_t);
-        } else {
-          return typeid(std::uint32_t);
-        }
-      } else {
-        return typeid(double);
-      }
-    case DataDescriptor::FundamentalType::boolean:
-      return typeid(std::uint32_t);
-    default:
-      return typeid(nullptr_t);
+  return *registerInfo->defaultType;
+}
+
+PVProvider::MemoryUsage DeviceAccessPVProvider::getMemoryUsage() {
+  MemoryUsage usage{{}, this->ioExecutor.getQueuedTaskCount()};
+  {
+    std::lock_guard<std::mutex> lock(this->initialValueRequestsMutex);
+    usage.queuedTasks += this->initialValueRequests.size();
+  }
+  // Each record has its own PV support (with its own accessor), so we combine
+  // the PV supports that refer to the same register.
+  std::unordered_map<std::string, std::size_t> indexByName;
+  std::lock_guard<std::mutex> lock(this->pvSupportsMutex);
+  auto end = std::remove_if(this->pvSupports.begin(), this->pvSupports.end(),
+    [](std::weak_ptr<detail::DeviceAccessPVSupportBase> const &pvSupport) {
+      return pvSupport.expired();
+    });
+  this->pvSupports.erase(end, this->pvSupports.end());
+  for (auto const &weakPVSupport : this->pvSupports) {
+    auto pvSupport = weakPVSupport.lock();
+    if (!pvSupport) {
+      continue;
+    }
+    auto pvUsage = pvSupport->getMemoryUsage();
+    auto entry = indexByName.emplace(
+      pvUsage.name, usage.processVariables.size());
+    if (entry.second) {
+      usage.processVariables.push_back(std::move(pvUsage));
+    } else {
+      auto &existing = usage.processVariables[entry.first->second];
+      existing.valueBytes += pvUsage.valueBytes;
+      existing.transportBytes += pvUsage.transportBytes;
+      existing.pendingNotifications += pvUsage.pendingNotifications;
+    }
+  }
+  return usage;
+}
+
+DeviceAccessPVProvider::RegisterIndexEntry const *DeviceAccessPVProvider::findRegister(
+    std::string const &registerName) {
+  auto &normalizedName =
+    InternedNameTable::internNormalizedRegisterPath(registerName);
+  std::lock_guard<std::mutex> lock(this->registerIndexMutex);
+  if (!this->registerIndexBuilt) {
+    auto registerCatalog = this->device.getRegisterCatalogue();
+    for (auto const &registerInfo : registerCatalog) {
+      auto &name = InternedNameTable::internNormalizedRegisterPath(
+        registerInfo.getRegisterName());
+      this->registerIndex.emplace(&name, RegisterIndexEntry{
+        &getDefaultTypeForDataDescriptor(registerInfo.getDataDescriptor()),
+        registerInfo.getNumberOfElements(), registerInfo.isReadable(),
+        registerInfo.isWriteable()});
+    }
+    this->registerIndexBuilt = true;
+  }
+  auto entry = this->registerIndex.find(&normalizedName);
+  if (entry == this->registerIndex.end()) {
+    return nullptr;
+  }
+  return &entry->second;
+}
+
+void DeviceAccessPVProvider::invalidateReadCaches(
+    std::string const *internedRegisterName) {
+  std::lock_guard<std::mutex> lock(this->readCachesMutex);
+  auto readCachesForRegister = this->readCaches.find(internedRegisterName);
+  if (readCachesForRegister == this->readCaches.end()) {
+    return;
+  }
+  for (auto &entry : readCachesForRegister->second) {
+    entry.second->invalidate();
   }
 }
 
@@ -89,6 +212,97 @@ bool DeviceAccessPVProvider::isSynchronous() {
   return this->synchronous;
 }
 
+void DeviceAccessPVProvider::processInitialValueRequests(
+    std::vector<std::unique_ptr<detail::DeviceAccessInitialValueRequestBase>> &requests) {
+  std::vector<detail::DeviceAccessInitialValueRequestBase *> groupRequests;
+  std::vector<detail::DeviceAccessInitialValueRequestBase *> individualRequests;
+  groupRequests.reserve(requests.size());
+  bool groupReadSucceeded = false;
+  {
+    // The transfer group holds the accessors of the PV supports, so it has to
+    // be destroyed before any of the requests is completed (see
+    // DeviceAccessPVSupport::InitialValueRequest).
+    TransferGroup transferGroup;
+    for (auto &request : requests) {
+      bool added = false;
+      try {
+        added = request->addToTransferGroup(transferGroup);
+      } catch (...) {
+        // If the accessor cannot be added, we read the register individually,
+        // so that the request still gets completed.
+      }
+      if (added) {
+        groupRequests.push_back(request.get());
+      } else {
+        individualRequests.push_back(request.get());
+      }
+    }
+    if (!groupRequests.empty()) {
+      try {
+        transferGroup.read();
+        groupReadSucceeded = true;
+      } catch (...) {
+        // If a single register cannot be read, reading the whole transfer
+        // group fails. In this case, we fall back to reading each register
+        // individually, so that the other registers still get their initial
+        // values.
+      }
+    }
+  }
+  for (auto request : groupRequests) {
+    if (groupReadSucceeded) {
+      request->complete();
+    } else {
+      request->completeIndividually();
+    }
+  }
+  for (auto request : individualRequests) {
+    request->completeIndividually();
+  }
+}
+
+void DeviceAccessPVProvider::report(int level) {
+  std::lock_guard<std::mutex> lock(this->readCachesMutex);
+  if (this->readCaches.empty()) {
+    return;
+  }
+  detail::DeviceAccessReadCacheBase::Statistics total{0, 0, 0};
+  for (auto const &readCachesForRegister : this->readCaches) {
+    for (auto const &entry : readCachesForRegister.second) {
+      auto statistics = entry.second->getStatistics();
+      total.hits += statistics.hits;
+      total.misses += statistics.misses;
+      total.sharedReads += statistics.sharedReads;
+    }
+  }
+  auto totalReads = total.hits + total.misses + total.sharedReads;
+  ::epicsStdoutPrintf(
+    "  Read caches: %zu registers, %zu hits, %zu shared reads, %zu misses, hit ratio %.1f %%\n",
+    this->readCaches.size(), total.hits, total.sharedReads, total.misses,
+    totalReads ? 100.0 * (total.hits + total.sharedReads) / totalReads : 0.0);
+  if (level > 0) {
+    for (auto const &readCachesForRegister : this->readCaches) {
+      for (auto const &entry : readCachesForRegister.second) {
+        auto statistics = entry.second->getStatistics();
+        auto reads =
+          statistics.hits + statistics.misses + statistics.sharedReads;
+        ::epicsStdoutPrintf(
+          "    %s: %zu hits, %zu shared reads, %zu misses, hit ratio %.1f %%\n",
+          readCachesForRegister.first->c_str(), statistics.hits,
+          statistics.sharedReads, statistics.misses,
+          reads ? 100.0 * (statistics.hits + statistics.sharedReads) / reads
+          : 0.0);
+      }
+    }
+  }
+}
+
+void DeviceAccessPVProvider::submitInitialValueRequest(
+    std::unique_ptr<detail::DeviceAccessInitialValueRequestBase> &&request) {
+  std::lock_guard<std::mutex> lock(this->initialValueRequestsMutex);
+  this->initialValueRequests.push_back(std::move(request));
+}
+
 std::shared_ptr<PVSupportBase> DeviceAccessPVProvider::createPVSupport(
     std::string const &processVariableName,
     std::type_info const &elementType) {
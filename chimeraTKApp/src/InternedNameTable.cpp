@@ -0,0 +1,157 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include <ChimeraTK/RegisterPath.h>
+
+#include "ChimeraTK/EPICS/InternedNameTable.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace {
+
+/**
+ * Entry in the table of interned names.
+ */
+struct Entry {
+
+  Entry(char const *name, std::size_t length)
+      : name(name, length), normalizedRegisterPath(nullptr) {
+  }
+
+  /**
+   * Interned name.
+   */
+  std::string const name;
+
+  /**
+   * Interned normalized form of the name. This is null until the normalized
+   * form has been requested for the first time.
+   */
+  std::string const *normalizedRegisterPath;
+
+};
+
+/**
+ * Key used for looking up entries. The key only refers to the characters, so
+ * looking up a name does not require a copy of it.
+ */
+struct Key {
+
+  char const *data;
+  std::size_t length;
+
+  bool operator==(Key const &other) const {
+    return this->length == other.length
+      && std::memcmp(this->data, other.data, this->length) == 0;
+  }
+
+};
+
+/**
+ * Hash function for Key. This uses the FNV-1a algorithm, which is fast and
+ * good enough for short strings like names.
+ */
+struct KeyHash {
+
+  std::size_t operator()(Key const &key) const {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < key.length; ++i) {
+      hash ^= static_cast<unsigned char>(key.data[i]);
+      hash *= 1099511628211ULL;
+    }
+    return static_cast<std::size_t>(hash);
+  }
+
+};
+
+/**
+ * Storage for the table entries. We use a deque because it does not move
+ * existing elements when adding new ones, so the keys in the index and the
+ * references handed out to callers stay valid.
+ */
+std::deque<Entry> &entryStorage() {
+  static std::deque<Entry> entries;
+  return entries;
+}
+
+/**
+ * Index mapping the names to the table entries.
+ */
+std::unordered_map<Key, Entry *, KeyHash> &entryIndex() {
+  static std::unordered_map<Key, Entry *, KeyHash> index;
+  return index;
+}
+
+/**
+ * Mutex protecting the entries and the index.
+ */
+std::mutex &tableMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+/**
+ * Returns the entry for the specified name, creating it if necessary. The
+ * calling code must hold a lock on the mutex.
+ */
+Entry &findOrInsert(char const *name, std::size_t length) {
+  auto &index = entryIndex();
+  auto iterator = index.find(Key{name, length});
+  if (iterator != index.end()) {
+    return *iterator->second;
+  }
+  auto &entries = entryStorage();
+  entries.emplace_back(name, length);
+  auto &entry = entries.back();
+  index.emplace(Key{entry.name.data(), entry.name.size()}, &entry);
+  return entry;
+}
+
+} // anonymous namespace
+
+std::string const &InternedNameTable::intern(
+    char const *name, std::size_t length) {
+  std::lock_guard<std::mutex> lock(tableMutex());
+  return findOrInsert(name, length).name;
+}
+
+std::string const &InternedNameTable::internNormalizedRegisterPath(
+    std::string const &name) {
+  std::lock_guard<std::mutex> lock(tableMutex());
+  auto &entry = findOrInsert(name.data(), name.size());
+  if (!entry.normalizedRegisterPath) {
+    std::string normalized = RegisterPath(name);
+    auto &normalizedEntry = findOrInsert(normalized.data(), normalized.size());
+    // The normalized form of a normalized path is the path itself, so we can
+    // set this for the other entry as well.
+    normalizedEntry.normalizedRegisterPath = &normalizedEntry.name;
+    entry.normalizedRegisterPath = &normalizedEntry.name;
+  }
+  return *entry.normalizedRegisterPath;
+}
+
+} // namespace EPICS
+} // namespace ChimeraTK
@@ -0,0 +1,99 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include <epicsStdio.h>
+
+#include "ChimeraTK/EPICS/NotificationBuffer.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace {
+
+/**
+ * Mutex protecting access to the list returned by registeredBuffers().
+ */
+std::mutex &registeredBuffersMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+/**
+ * List of all notification buffers that currently exist. Buffers are only
+ * created and destroyed when records are initialized, so this list does not
+ * change while the IOC is running.
+ */
+std::vector<NotificationBufferBase const *> &registeredBuffers() {
+  static std::vector<NotificationBufferBase const *> buffers;
+  return buffers;
+}
+
+} // anonymous namespace
+
+NotificationBufferBase::NotificationBufferBase(char const *recordName)
+    : overflowCount(0), skippedCount(0), recordName(recordName) {
+  std::lock_guard<std::mutex> lock(registeredBuffersMutex());
+  registeredBuffers().push_back(this);
+}
+
+NotificationBufferBase::~NotificationBufferBase() noexcept {
+  std::lock_guard<std::mutex> lock(registeredBuffersMutex());
+  auto &buffers = registeredBuffers();
+  buffers.erase(
+    std::remove(buffers.begin(), buffers.end(), this), buffers.end());
+}
+
+void NotificationBufferBase::report(int level) {
+  std::lock_guard<std::mutex> lock(registeredBuffersMutex());
+  std::size_t memorySize = 0;
+  std::size_t overflowCount = 0;
+  std::size_t skippedCount = 0;
+  for (auto buffer : registeredBuffers()) {
+    memorySize += buffer->getMemorySize();
+    overflowCount += buffer->getOverflowCount();
+    skippedCount += buffer->getSkippedCount();
+  }
+  ::epicsStdoutPrintf(
+    "Notification buffers of records with the latest or queue option: %zu (%zu bytes)\n",
+    registeredBuffers().size(), memorySize);
+  ::epicsStdoutPrintf("Values skipped by records with the latest option: %zu\n",
+    skippedCount);
+  ::epicsStdoutPrintf("Queue overflows of records with the queue option: %zu\n",
+    overflowCount);
+  if (level <= 0) {
+    return;
+  }
+  for (auto buffer : registeredBuffers()) {
+    auto bufferOverflowCount = buffer->getOverflowCount();
+    auto bufferSkippedCount = buffer->getSkippedCount();
+    if (bufferOverflowCount || bufferSkippedCount) {
+      ::epicsStdoutPrintf(
+        "  %s: %zu values skipped, %zu queue overflows, %zu bytes\n",
+        buffer->getRecordName(), bufferSkippedCount, bufferOverflowCount,
+        buffer->getMemorySize());
+    }
+  }
+}
+
+} // namespace EPICS
+} // namespace ChimeraTK
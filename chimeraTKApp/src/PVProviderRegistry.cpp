@@ -17,16 +17,134 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <map>
 #include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <ChimeraTK/RegisterPath.h>
+
+extern "C" {
+#include <dbAccess.h>
+#include <dbStaticLib.h>
+#include <epicsStdio.h>
+#include <epicsTypes.h>
+} // extern "C"
 
 #include "ChimeraTK/EPICS/ControlSystemAdapterPVProvider.h"
 #include "ChimeraTK/EPICS/DeviceAccessPVProviderImpl.h"
+#include "ChimeraTK/EPICS/NotificationBuffer.h"
+#include "ChimeraTK/EPICS/ParallelCopyEngine.h"
+#include "ChimeraTK/EPICS/RecordAddress.h"
+#include "ChimeraTK/EPICS/RecordBufferAllocator.h"
+#include "ChimeraTK/EPICS/ThreadSettings.h"
+#include "ChimeraTK/EPICS/ensureScanIoRequest.h"
+#include "ChimeraTK/EPICS/errorPrint.h"
 
 #include "ChimeraTK/EPICS/PVProviderRegistry.h"
 
 namespace ChimeraTK {
 namespace EPICS {
 
+namespace {
+
+/**
+ * Memory used by the records that refer to a process variable.
+ */
+struct RecordMemoryUsage {
+
+  std::size_t bufferBytes;
+  std::size_t numberOfRecords;
+
+};
+
+/**
+ * Returns the normalized form of the specified register path. Unlike
+ * InternedNameTable::internNormalizedRegisterPath(...), this does not add the
+ * name to the intern table, so it is used for names that are only needed for
+ * generating a report.
+ */
+std::string normalizedRegisterPath(std::string const &name) {
+  return RegisterPath(name);
+}
+
+/**
+ * Returns the size of a record's value buffer in bytes. Most records store
+ * their value directly in the record structure, so for them the size is zero.
+ * The record's fields are read through the static database access library, so
+ * the entry must point to an initialized record.
+ */
+std::size_t recordBufferSize(::DBENTRY &entry) {
+  // The aai and aao records allocate a buffer of NELM elements of type FTVL.
+  if (!::dbFindField(&entry, "FTVL")) {
+    auto ftvl = *static_cast<epicsEnum16 const *>(entry.pfield);
+    if (::dbFindField(&entry, "NELM")) {
+      return 0;
+    }
+    auto nelm = *static_cast<epicsUInt32 const *>(entry.pfield);
+    return static_cast<std::size_t>(nelm) * ::dbValueSize(ftvl);
+  }
+  // The lsi and lso records allocate a buffer of SIZV bytes.
+  if (!::dbFindField(&entry, "SIZV")) {
+    return *static_cast<epicsUInt16 const *>(entry.pfield);
+  }
+  return 0;
+}
+
+/**
+ * Collects the memory used by the buffers of all records using this device
+ * support. The keys of the returned map are the names of the application or
+ * device and the normalized form of the process variable name, so that
+ * "foo/bar" and "/foo/bar" are counted for the same process variable.
+ */
+std::map<std::pair<std::string, std::string>, RecordMemoryUsage> collectRecordMemoryUsage() {
+  std::map<std::pair<std::string, std::string>, RecordMemoryUsage> usage;
+  if (!::pdbbase) {
+    return usage;
+  }
+  ::DBENTRY entry;
+  ::dbInitEntry(::pdbbase, &entry);
+  for (long recordTypeStatus = ::dbFirstRecordType(&entry); !recordTypeStatus;
+      recordTypeStatus = ::dbNextRecordType(&entry)) {
+    for (long recordStatus = ::dbFirstRecord(&entry); !recordStatus;
+        recordStatus = ::dbNextRecord(&entry)) {
+      if (::dbIsAlias(&entry)) {
+        continue;
+      }
+      if (::dbFindField(&entry, "DTYP")
+          || std::strcmp(::dbGetString(&entry), "ChimeraTK")) {
+        continue;
+      }
+      if (::dbFindField(&entry, "INP") && ::dbFindField(&entry, "OUT")) {
+        continue;
+      }
+      char const *linkString = ::dbGetString(&entry);
+      if (!linkString) {
+        continue;
+      }
+      try {
+        auto address = RecordAddress::parse(linkString);
+        auto &recordUsage = usage[std::make_pair(
+          address.getApplicationOrDeviceName(),
+          normalizedRegisterPath(address.getProcessVariableName()))];
+        recordUsage.bufferBytes += recordBufferSize(entry);
+        ++recordUsage.numberOfRecords;
+      } catch (...) {
+        // Records with an invalid address have not been initialized, so they
+        // do not use any memory for buffers either.
+      }
+    }
+  }
+  ::dbFinishEntry(&entry);
+  return usage;
+}
+
+} // anonymous namespace
+
 void PVProviderRegistry::finalizeInitialization() {
   {
     std::lock_guard<std::recursive_mutex> lock(PVProviderRegistry::mutex);
@@ -76,7 +194,9 @@ void PVProviderRegistry::registerApplication(
     throw std::invalid_argument(
       std::string("The name '") + appName + "' is already in use.");
   }
-  auto pvProvider = std::make_shared<ControlSystemAdapterPVProvider>(pvManager);
+  auto pvProvider = std::make_shared<ControlSystemAdapterPVProvider>(
+    pvManager, getThreadSettings(appName, "notification"),
+    getThreadSettings(appName, "highPriorityNotification"));
   PVProviderRegistry::pvProviders.insert(std::make_pair(appName, pvProvider));
 }
 
@@ -96,10 +216,119 @@ void PVProviderRegistry::registerDevice(
       std::string("The name '") + devName + "' is already in use.");
   }
   auto pvProvider = std::make_shared<DeviceAccessPVProvider>(
-    deviceNameAlias, numberOfIoThreads);
+    deviceNameAlias, numberOfIoThreads, getThreadSettings(devName, "io"));
   PVProviderRegistry::pvProviders.insert(std::make_pair(devName, pvProvider));
 }
 
+void PVProviderRegistry::report(int level) {
+  std::vector<std::pair<std::string, PVProvider::SharedPtr>> pvProviders;
+  {
+    std::lock_guard<std::recursive_mutex> lock(PVProviderRegistry::mutex);
+    pvProviders.assign(
+      PVProviderRegistry::pvProviders.begin(),
+      PVProviderRegistry::pvProviders.end());
+  }
+  // We sort the PV providers by name, so that the output is easier to read.
+  std::sort(pvProviders.begin(), pvProviders.end(),
+    [](std::pair<std::string, PVProvider::SharedPtr> const &a,
+        std::pair<std::string, PVProvider::SharedPtr> const &b){
+      return a.first < b.first;
+    });
+  ::epicsStdoutPrintf("scanIoRequest retries: %zu\n",
+    getScanIoRequestRetryCount());
+  NotificationBufferBase::report(level);
+  ::epicsStdoutPrintf("Error messages suppressed: %zu, dropped: %zu\n",
+    getErrorPrintSuppressedCount(), getErrorPrintDroppedCount());
+  ParallelCopyEngine::report();
+  RecordBufferAllocator::report();
+  // We do not hold the lock while calling the PV providers' report methods for
+  // the same reasons as in finalizeInitialization().
+  for (auto const &entry : pvProviders) {
+    ::epicsStdoutPrintf("%s:\n", entry.first.c_str());
+    entry.second->report(level);
+  }
+}
+
+void PVProviderRegistry::memoryReport(std::size_t maxProcessVariables) {
+  std::vector<std::pair<std::string, PVProvider::SharedPtr>> pvProviders;
+  {
+    std::lock_guard<std::recursive_mutex> lock(PVProviderRegistry::mutex);
+    pvProviders.assign(
+      PVProviderRegistry::pvProviders.begin(),
+      PVProviderRegistry::pvProviders.end());
+  }
+  std::sort(pvProviders.begin(), pvProviders.end(),
+    [](std::pair<std::string, PVProvider::SharedPtr> const &a,
+        std::pair<std::string, PVProvider::SharedPtr> const &b){
+      return a.first < b.first;
+    });
+  auto recordUsage = collectRecordMemoryUsage();
+  // For each process variable, we remember the name of its PV provider, its
+  // memory usage, and the memory used by the records referring to it.
+  using Entry = std::tuple<std::string const *,
+    PVProvider::ProcessVariableMemoryUsage, RecordMemoryUsage>;
+  std::vector<Entry> entries;
+  std::size_t totalBytes = 0;
+  ::epicsStdoutPrintf("Memory usage by application or device:\n");
+  // We do not hold the lock while calling the PV providers' methods for the
+  // same reasons as in finalizeInitialization().
+  for (auto const &provider : pvProviders) {
+    auto usage = provider.second->getMemoryUsage();
+    std::size_t valueBytes = 0;
+    std::size_t transportBytes = 0;
+    std::size_t recordBytes = 0;
+    std::size_t pendingNotifications = 0;
+    for (auto &pvUsage : usage.processVariables) {
+      RecordMemoryUsage pvRecordUsage{0, 0};
+      // Not all PV providers report the normalized name, so we have to
+      // normalize it before looking for the records.
+      auto recordEntry = recordUsage.find(std::make_pair(provider.first,
+        normalizedRegisterPath(pvUsage.name)));
+      if (recordEntry != recordUsage.end()) {
+        pvRecordUsage = recordEntry->second;
+      }
+      valueBytes += pvUsage.valueBytes;
+      transportBytes += pvUsage.transportBytes;
+      recordBytes += pvRecordUsage.bufferBytes;
+      pendingNotifications += pvUsage.pendingNotifications;
+      entries.emplace_back(
+        &provider.first, std::move(pvUsage), pvRecordUsage);
+    }
+    std::size_t providerBytes = valueBytes + transportBytes + recordBytes;
+    totalBytes += providerBytes;
+    ::epicsStdoutPrintf(
+      "  %s: %zu bytes for %zu PVs (values %zu, transport %zu, records %zu), "
+      "%zu pending notifications, %zu queued tasks\n",
+      provider.first.c_str(), providerBytes, usage.processVariables.size(),
+      valueBytes, transportBytes, recordBytes, pendingNotifications,
+      usage.queuedTasks);
+  }
+  ::epicsStdoutPrintf("Total: %zu bytes\n", totalBytes);
+  if (maxProcessVariables == 0 || entries.empty()) {
+    return;
+  }
+  auto entryBytes = [](Entry const &entry) {
+    return std::get<1>(entry).valueBytes + std::get<1>(entry).transportBytes
+      + std::get<2>(entry).bufferBytes;
+  };
+  auto numberOfEntries = std::min(maxProcessVariables, entries.size());
+  std::partial_sort(entries.begin(), entries.begin() + numberOfEntries,
+    entries.end(), [&entryBytes](Entry const &a, Entry const &b) {
+      return entryBytes(a) > entryBytes(b);
+    });
+  ::epicsStdoutPrintf("Process variables using the most memory:\n");
+  for (std::size_t i = 0; i < numberOfEntries; ++i) {
+    auto const &entry = entries[i];
+    auto const &pvUsage = std::get<1>(entry);
+    auto const &pvRecordUsage = std::get<2>(entry);
+    ::epicsStdoutPrintf(
+      "  %s/%s: %zu bytes (values %zu, transport %zu, %zu records %zu)\n",
+      std::get<0>(entry)->c_str(), pvUsage.name.c_str(), entryBytes(entry),
+      pvUsage.valueBytes, pvUsage.transportBytes,
+      pvRecordUsage.numberOfRecords, pvRecordUsage.bufferBytes);
+  }
+}
+
 // Static member variables need an instance...
 bool PVProviderRegistry::finalizeInitializationCalled(false);
 std::recursive_mutex PVProviderRegistry::mutex;
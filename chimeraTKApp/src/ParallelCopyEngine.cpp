@@ -0,0 +1,116 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <epicsStdio.h>
+
+#include "ChimeraTK/EPICS/ThreadSettings.h"
+
+#include "ChimeraTK/EPICS/ParallelCopyEngine.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+void ParallelCopyEngine::configure(
+    std::size_t numberOfThreads, std::size_t threshold) {
+  std::shared_ptr<ThreadPoolExecutor> newPool;
+  if (numberOfThreads) {
+    newPool = std::make_shared<ThreadPoolExecutor>(
+      numberOfThreads, getThreadSettings(std::string(), "copy"));
+  }
+  std::shared_ptr<ThreadPoolExecutor> oldPool;
+  {
+    std::lock_guard<std::mutex> lock(ParallelCopyEngine::poolMutex);
+    oldPool = std::move(ParallelCopyEngine::pool);
+    ParallelCopyEngine::pool = std::move(newPool);
+    ParallelCopyEngine::poolSize = numberOfThreads;
+    ParallelCopyEngine::threshold = threshold;
+  }
+  // The old pool is destroyed when the last transfer using it has finished.
+  // If there is no such transfer, it is destroyed here, outside the lock.
+}
+
+void ParallelCopyEngine::copy(
+    void *destination, void const *source, std::size_t size) {
+  auto destinationBytes = static_cast<char *>(destination);
+  auto sourceBytes = static_cast<char const *>(source);
+  forEachChunk(size, 1,
+    [destinationBytes, sourceBytes](std::size_t begin, std::size_t end){
+      std::memcpy(destinationBytes + begin, sourceBytes + begin, end - begin);
+    });
+}
+
+std::shared_ptr<ThreadPoolExecutor> ParallelCopyEngine::getPoolForTransfer(
+    std::size_t size) {
+  // We check the cheap conditions first, so that small transfers never have
+  // to acquire the mutex.
+  auto threshold = ParallelCopyEngine::threshold.load();
+  if (!ParallelCopyEngine::poolSize || size < threshold
+      || size < 2 * chunkAlignment) {
+    return std::shared_ptr<ThreadPoolExecutor>();
+  }
+  std::lock_guard<std::mutex> lock(ParallelCopyEngine::poolMutex);
+  return ParallelCopyEngine::pool;
+}
+
+void ParallelCopyEngine::report() {
+  ::epicsStdoutPrintf(
+    "Parallel copies: %zu helper threads, threshold %zu bytes, %zu transfers split (%zu bytes)\n",
+    ParallelCopyEngine::poolSize.load(), ParallelCopyEngine::threshold.load(),
+    ParallelCopyEngine::parallelTransferCount.load(),
+    ParallelCopyEngine::parallelTransferSize.load());
+}
+
+void ParallelCopyEngine::runChunks(ThreadPoolExecutor &pool,
+    std::size_t numberOfChunks,
+    std::function<void(std::size_t)> const &chunkTask) {
+  std::vector<std::future<void>> futures;
+  futures.reserve(numberOfChunks - 1);
+  for (std::size_t chunk = 1; chunk < numberOfChunks; ++chunk) {
+    try {
+      futures.push_back(pool.submitTask(chunkTask, chunk));
+    } catch (...) {
+      // If the pool is being shut down because it is replaced, we process
+      // the chunk ourselves.
+      chunkTask(chunk);
+    }
+  }
+  chunkTask(0);
+  // The chunk tasks refer to data owned by our caller, so we have to wait for
+  // all of them before returning.
+  for (auto &future : futures) {
+    future.wait();
+  }
+}
+
+// Static member variables need an instance...
+constexpr std::size_t ParallelCopyEngine::chunkAlignment;
+std::atomic<std::size_t> ParallelCopyEngine::parallelTransferCount(0);
+std::atomic<std::size_t> ParallelCopyEngine::parallelTransferSize(0);
+std::shared_ptr<ThreadPoolExecutor> ParallelCopyEngine::pool;
+std::mutex ParallelCopyEngine::poolMutex;
+std::atomic<std::size_t> ParallelCopyEngine::poolSize(0);
+std::atomic<std::size_t> ParallelCopyEngine::threshold(16 * 1024 * 1024);
+
+} // namespace EPICS
+} // namespace ChimeraTK
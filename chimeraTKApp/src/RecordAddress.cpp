@@ -17,13 +17,18 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <string>
 #include <utility>
 
 #include <ChimeraTK/SupportedUserTypes.h>
 
+#include "ChimeraTK/EPICS/InternedNameTable.h"
+
 #include "ChimeraTK/EPICS/RecordAddress.h"
 
 namespace ChimeraTK {
@@ -32,15 +37,51 @@ namespace EPICS {
 namespace {
 
 struct Options {
+  bool decimationAverage = false;
+  std::uint32_t decimationFactor = 0;
+  bool flightRecorder = false;
+  std::chrono::milliseconds historyInterval{0};
+  std::uint32_t historySize = 0;
+  bool latest = false;
   bool noBidirectional = false;
+  bool noInitialRead = false;
+  std::uint32_t queueSize = 0;
+  bool readCache = false;
+  std::chrono::milliseconds readCacheMaxAge{0};
+  Reduction reduction = Reduction::NONE;
+  // Bit mask of the options that have been specified. The bit for each option
+  // is determined by its index in Parser::optionNames.
+  std::uint32_t specifiedOptions = 0;
 };
 
+/**
+ * Reference to a sequence of characters inside the address string. We cannot
+ * use std::string_view because we are limited to C++ 14.
+ */
+struct StringRef {
+
+  char const *data;
+  std::size_t length;
+
+  bool operator==(char const *str) const {
+    return std::strlen(str) == this->length
+      && std::memcmp(this->data, str, this->length) == 0;
+  }
+
+};
+
+/**
+ * Parser for record addresses. The parser works in a single pass directly on
+ * the characters of the link field and does not allocate any memory unless an
+ * error is found. Only the names that are finally stored in the record address
+ * are copied, and only if they have not been interned before.
+ */
 class Parser {
 
 public:
 
-  Parser(std::string const &addressString)
-      : addressString(addressString), position(0) {
+  Parser(char const *addressString, std::size_t length)
+      : addressString(addressString), length(length), position(0) {
   }
 
   RecordAddress parse() {
@@ -78,35 +119,54 @@ public:
       throwException(std::string("Expected end of string, but found \"")
         + excerpt() + "\".");
     }
-    return RecordAddress(foundAppOrDevName, foundPvName, foundValueType,
-      expectValueType, foundOptions.noBidirectional);
+    return RecordAddress(RecordAddress::InternedNames(),
+      InternedNameTable::intern(
+        foundAppOrDevName.data, foundAppOrDevName.length),
+      InternedNameTable::intern(foundPvName.data, foundPvName.length),
+      foundValueType, expectValueType, foundOptions.noBidirectional,
+      foundOptions.noInitialRead, foundOptions.latest,
+      foundOptions.queueSize, foundOptions.flightRecorder,
+      foundOptions.historySize, foundOptions.historyInterval,
+      foundOptions.reduction, foundOptions.decimationFactor,
+      foundOptions.decimationAverage, foundOptions.readCache,
+      foundOptions.readCacheMaxAge);
   }
 
 private:
 
-  static std::string const appOrDevNameChars;
-  static std::string const separatorChars;
+  static constexpr std::uint32_t maxDecimationFactor = 1000000;
+  static constexpr std::uint32_t maxHistorySize = 1000000;
+  static constexpr std::uint32_t maxInterval = 86400000;
+  static constexpr std::uint32_t maxQueueSize = 10000;
 
-  std::string addressString;
+  static char const appOrDevNameChars[];
+  static char const * const optionNames[];
+  static char const optionNameChars[];
+  static char const optionValueTerminatorChars[];
+  static char const separatorChars[];
+
+  char const *addressString;
+  std::size_t length;
   std::size_t position;
 
-  bool accept(std::string const &str) {
-    if (addressString.length() - position < str.length()) {
+  bool accept(char const *str) {
+    auto strLength = std::strlen(str);
+    if (length - position < strLength) {
       return false;
     }
-    if (addressString.substr(position, str.length()) == str) {
-      position += str.length();
+    if (std::memcmp(addressString + position, str, strLength) == 0) {
+      position += strLength;
       return true;
     } else {
       return false;
     }
   }
 
-  bool acceptAnyOf(std::string const &characters) {
+  bool acceptAnyOf(char const *characters) {
     if (isEndOfString()) {
       return false;
     }
-    if (characters.find(peek()) != std::string::npos) {
+    if (isAnyOf(peek(), characters)) {
       ++position;
       return true;
     } else {
@@ -114,11 +174,11 @@ private:
     }
   }
 
-  bool acceptAnyNotOf(std::string const &characters) {
+  bool acceptAnyNotOf(char const *characters) {
     if (isEndOfString()) {
       return false;
     }
-    if (characters.find(peek()) == std::string::npos) {
+    if (!isAnyOf(peek(), characters)) {
       ++position;
       return true;
     } else {
@@ -126,24 +186,20 @@ private:
     }
   }
 
-  std::string appOrDevName() {
+  StringRef appOrDevName() {
     auto startPos = position;
     expectAnyOf(appOrDevNameChars);
     do {
     } while (acceptAnyOf(appOrDevNameChars));
-    auto endPos = position;
-    return addressString.substr(startPos, endPos - startPos);
+    return StringRef{addressString + startPos, position - startPos};
   }
 
   std::string excerpt() {
-    if (addressString.length() - position > 5) {
-      return addressString.substr(position, 5);
-    } else {
-      return addressString.substr(position);
-    }
+    return std::string(
+      addressString + position, std::min<std::size_t>(length - position, 5));
   }
 
-  void expect(std::string const &str) {
+  void expect(char const *str) {
     if (!accept(str)) {
       if (isEndOfString()) {
         throwException(std::string("Expected \"") + str
@@ -155,7 +211,7 @@ private:
     }
   }
 
-  void expectAnyOf(std::string const &characters) {
+  void expectAnyOf(char const *characters) {
     if (!acceptAnyOf(characters)) {
       if (isEndOfString()) {
         throwException(std::string("Expected any of \"") + characters
@@ -167,7 +223,7 @@ private:
     }
   }
 
-  void expectAnyNotOf(std::string const &characters) {
+  void expectAnyNotOf(char const *characters) {
     if (!acceptAnyNotOf(characters)) {
       if (isEndOfString()) {
         throwException(
@@ -181,31 +237,234 @@ private:
     }
   }
 
+  static bool isAnyOf(char c, char const *characters) {
+    // We have to check for the null character explicitly because std::strchr
+    // would find the terminating null character of the characters string.
+    return c != 0 && std::strchr(characters, c) != nullptr;
+  }
+
   bool isEndOfString() {
-    return position == addressString.length();
+    return position == length;
+  }
+
+  void option(Options &options) {
+    auto startPos = position;
+    auto name = optionName();
+    bool hasValue = accept("=");
+    StringRef value{nullptr, 0};
+    if (hasValue) {
+      value = optionValue();
+    }
+    // Unknown options are reported below, so we only have to check for
+    // options that have been specified before.
+    for (std::uint32_t i = 0; optionNames[i]; ++i) {
+      if (name == optionNames[i]) {
+        if (options.specifiedOptions & (1u << i)) {
+          position = startPos;
+          throwException(std::string("The option \"") + optionNames[i]
+            + "\" must not be specified more than once.");
+        }
+        options.specifiedOptions |= 1u << i;
+        break;
+      }
+    }
+    if (name == "avg" && !hasValue) {
+      options.decimationAverage = true;
+    } else if (name == "decimate" && hasValue) {
+      options.decimationFactor = number(value, startPos, maxDecimationFactor,
+        "The decimation factor");
+    } else if (name == "flightrecorder" && !hasValue) {
+      options.flightRecorder = true;
+    } else if (name == "history" && hasValue) {
+      options.historySize = number(value, startPos, maxHistorySize,
+        "The history size");
+    } else if (name == "interval" && hasValue) {
+      options.historyInterval = duration(value, startPos, "The interval");
+    } else if (name == "latest" && !hasValue) {
+      options.latest = true;
+    } else if (name == "queue" && hasValue) {
+      options.queueSize = number(value, startPos, maxQueueSize,
+        "The queue size");
+    } else if (name == "reduce" && hasValue) {
+      options.reduction = reduction(value, startPos);
+    } else if (name == "maxage" && hasValue) {
+      options.readCache = true;
+      options.readCacheMaxAge = duration(value, startPos, "The max. age");
+    } else if (name == "nobidirectional" && !hasValue) {
+      options.noBidirectional = true;
+    } else if (name == "noinitialread" && !hasValue) {
+      options.noInitialRead = true;
+    } else {
+      position = startPos;
+      throwException(std::string("Unknown option \"")
+        + excerpt() + "\".");
+    }
+  }
+
+  /**
+   * Parses a duration. The value must be a decimal number that does not exceed
+   * maxInterval milliseconds, optionally followed by the unit "ms" or "s".
+   * Without a unit, the number is interpreted as milliseconds. The description
+   * is used as the subject of the error message.
+   */
+  std::chrono::milliseconds duration(StringRef const &value,
+      std::size_t startPos, char const *description) {
+    std::uint64_t milliseconds = 0;
+    std::size_t i = 0;
+    bool valid = value.length > 0;
+    for (; valid && i < value.length; ++i) {
+      char c = value.data[i];
+      if (c < '0' || c > '9') {
+        break;
+      }
+      milliseconds = milliseconds * 10 + (c - '0');
+      valid = milliseconds <= maxInterval;
+    }
+    if (valid && i == 0) {
+      valid = false;
+    }
+    if (valid && i < value.length) {
+      StringRef unit{value.data + i, value.length - i};
+      if (unit == "s") {
+        milliseconds *= 1000;
+      } else if (!(unit == "ms")) {
+        valid = false;
+      }
+    }
+    if (!valid || milliseconds > maxInterval) {
+      position = startPos;
+      std::ostringstream os;
+      os << description << " must be a number of milliseconds between 0 and "
+        << maxInterval << ", optionally followed by \"ms\" or \"s\".";
+      throwException(os.str());
+    }
+    return std::chrono::milliseconds(milliseconds);
+  }
+
+  /**
+   * Parses a positive decimal number that does not exceed the specified
+   * maximum. The description is used as the subject of the error message.
+   */
+  std::uint32_t number(StringRef const &value, std::size_t startPos,
+      std::uint32_t maximum, char const *description) {
+    std::uint32_t number = 0;
+    bool valid = true;
+    for (std::size_t i = 0; valid && i < value.length; ++i) {
+      char c = value.data[i];
+      if (c < '0' || c > '9') {
+        valid = false;
+      } else {
+        number = number * 10 + (c - '0');
+        valid = number <= maximum;
+      }
+    }
+    if (!valid || number == 0) {
+      position = startPos;
+      std::ostringstream os;
+      os << description << " must be a number between 1 and " << maximum
+        << ".";
+      throwException(os.str());
+    }
+    return number;
+  }
+
+  /**
+   * Parses the value of the "reduce" option.
+   */
+  Reduction reduction(StringRef const &value, std::size_t startPos) {
+    if (value == "max") {
+      return Reduction::MAX;
+    } else if (value == "mean") {
+      return Reduction::MEAN;
+    } else if (value == "min") {
+      return Reduction::MIN;
+    } else if (value == "rms") {
+      return Reduction::RMS;
+    }
+    position = startPos;
+    throwException(
+      "The reduction must be one of \"max\", \"mean\", \"min\", or \"rms\".");
+    // throwException always throws, but we need this statement in order to
+    // avoid getting a compiler warning.
+    throw std::logic_error("This code should not have been reached.");
+  }
+
+  StringRef optionName() {
+    auto startPos = position;
+    expectAnyOf(optionNameChars);
+    do {
+    } while (acceptAnyOf(optionNameChars));
+    return StringRef{addressString + startPos, position - startPos};
+  }
+
+  StringRef optionValue() {
+    auto startPos = position;
+    expectAnyNotOf(optionValueTerminatorChars);
+    do {
+    } while (acceptAnyNotOf(optionValueTerminatorChars));
+    return StringRef{addressString + startPos, position - startPos};
   }
 
   Options options() {
     Options options;
     expect("(");
-    if (accept("nobidirectional")) {
-      options.noBidirectional = true;
+    if (accept(")")) {
+      return options;
+    }
+    auto startPos = position;
+    do {
+      option(options);
+    } while (accept(","));
+    // All checks that involve more than one option are done here, after the
+    // complete list has been parsed, so that the result does not depend on the
+    // order of the options.
+    if (options.latest && options.queueSize) {
+      position = startPos;
+      throwException(
+        "The options \"latest\" and \"queue\" cannot be combined.");
+    }
+    if (options.flightRecorder && options.historySize) {
+      position = startPos;
+      throwException(
+        "The options \"flightrecorder\" and \"history\" cannot be combined.");
+    }
+    if (options.reduction != Reduction::NONE
+        && (options.flightRecorder || options.historySize)) {
+      position = startPos;
+      throwException(
+        "The option \"reduce\" cannot be combined with \"flightrecorder\" or \"history\".");
+    }
+    if (options.decimationFactor
+        && (options.flightRecorder || options.historySize
+          || options.reduction != Reduction::NONE)) {
+      position = startPos;
+      throwException(
+        "The option \"decimate\" cannot be combined with \"flightrecorder\", \"history\", or \"reduce\".");
+    }
+    if (options.decimationAverage && !options.decimationFactor) {
+      position = startPos;
+      throwException(
+        "The option \"avg\" can only be used together with \"decimate\".");
+    }
+    if (options.historyInterval.count() && !options.historySize) {
+      position = startPos;
+      throwException(
+        "The option \"interval\" can only be used together with \"history\".");
     }
     expect(")");
     return options;
   }
 
   char peek() {
-    return addressString.at(position);
+    return addressString[position];
   }
 
-  std::string pvName() {
+  StringRef pvName() {
     auto startPos = position;
     expectAnyNotOf(separatorChars);
     do {
     } while (acceptAnyNotOf(separatorChars));
-    auto endPos = position;
-    return addressString.substr(startPos, endPos - startPos);
+    return StringRef{addressString + startPos, position - startPos};
   }
 
   void separator() {
@@ -261,8 +520,17 @@ private:
 
 };
 
-std::string const Parser::appOrDevNameChars = std::string("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_0123456789");
-std::string const Parser::separatorChars = std::string(" \t");
+constexpr std::uint32_t Parser::maxDecimationFactor;
+constexpr std::uint32_t Parser::maxHistorySize;
+constexpr std::uint32_t Parser::maxInterval;
+constexpr std::uint32_t Parser::maxQueueSize;
+char const Parser::appOrDevNameChars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz_0123456789";
+char const * const Parser::optionNames[] = {"avg", "decimate",
+  "flightrecorder", "history", "interval", "latest", "maxage",
+  "nobidirectional", "noinitialread", "queue", "reduce", nullptr};
+char const Parser::optionNameChars[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+char const Parser::optionValueTerminatorChars[] = ",) \t";
+char const Parser::separatorChars[] = " \t";
 
 } // anonymous namespace
 
@@ -273,7 +541,17 @@ RecordAddress RecordAddress::parse(::DBLINK const &addressField) {
     throw std::invalid_argument(
       "Invalid device address. Maybe mixed up INP/OUT or forgot '@'?");
   }
-  return Parser(addressField.value.instio.string).parse();
+  return Parser(
+    addressField.value.instio.string,
+    std::strlen(addressField.value.instio.string)).parse();
+}
+
+RecordAddress RecordAddress::parse(char const *linkString) {
+  if (linkString == nullptr || linkString[0] != '@' || linkString[1] == 0) {
+    throw std::invalid_argument(
+      "Invalid device address. Maybe mixed up INP/OUT or forgot '@'?");
+  }
+  return Parser(linkString + 1, std::strlen(linkString + 1)).parse();
 }
 
 } // namespace EPICS
@@ -0,0 +1,142 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+extern "C" {
+#include <sys/mman.h>
+}
+
+#include <epicsStdio.h>
+
+#include "ChimeraTK/EPICS/RecordBufferAllocator.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace {
+
+/**
+ * Alignment (in bytes) of all buffers. This is the size of a cache line on
+ * the platforms we care about.
+ */
+constexpr std::size_t cacheLineSize = 64;
+
+/**
+ * Size (in bytes) of a huge page. This is the default huge page size on
+ * x86-64 and on most ARM64 systems.
+ */
+constexpr std::size_t hugePageSize = 2 * 1024 * 1024;
+
+/**
+ * Rounds the size up to the next multiple of the alignment, which must be a
+ * power of two.
+ */
+std::size_t roundUp(std::size_t size, std::size_t alignment) {
+  return (size + alignment - 1) & ~(alignment - 1);
+}
+
+} // anonymous namespace
+
+void *RecordBufferAllocator::allocate(std::size_t size) {
+  auto threshold = RecordBufferAllocator::hugePageThreshold.load();
+  auto mode = RecordBufferAllocator::hugePageMode.load();
+  bool useHugePages =
+    threshold && size >= threshold && mode != HugePageMode::none;
+#if defined(__linux__) && defined(MAP_HUGETLB)
+  if (useHugePages && mode == HugePageMode::hugetlb) {
+    auto mappedSize = roundUp(size, hugePageSize);
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+    if (RecordBufferAllocator::prefault) {
+      flags |= MAP_POPULATE;
+    }
+    void *buffer = ::mmap(
+      nullptr, mappedSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (buffer != MAP_FAILED) {
+      // Anonymous mappings are always zero-initialized.
+      ++RecordBufferAllocator::hugetlbBufferCount;
+      RecordBufferAllocator::hugetlbBufferSize += mappedSize;
+      return buffer;
+    }
+    // If there are not enough huge pages in the pool, we rather use
+    // transparent huge pages than failing.
+    ++RecordBufferAllocator::hugetlbFallbackCount;
+  }
+#endif
+  // Buffers that should use huge pages are aligned to the huge page size and
+  // their size is rounded up to it, so that they can be backed by huge pages
+  // completely.
+  auto alignment = useHugePages ? hugePageSize : cacheLineSize;
+  auto allocatedSize = roundUp(size ? size : 1, alignment);
+  void *buffer;
+  if (::posix_memalign(&buffer, alignment, allocatedSize)) {
+    throw std::bad_alloc();
+  }
+  if (useHugePages) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // This is only advice, so we do not care whether it succeeds.
+    ::madvise(buffer, allocatedSize, MADV_HUGEPAGE);
+#endif
+    ++RecordBufferAllocator::transparentBufferCount;
+    RecordBufferAllocator::transparentBufferSize += allocatedSize;
+  } else {
+    ++RecordBufferAllocator::heapBufferCount;
+    RecordBufferAllocator::heapBufferSize += allocatedSize;
+  }
+  // Zeroing the buffer also faults in all of its pages, so that the first
+  // access by the record does not cause page faults.
+  std::memset(buffer, 0, allocatedSize);
+  return buffer;
+}
+
+void RecordBufferAllocator::report() {
+  ::epicsStdoutPrintf(
+    "Record buffers: %zu on heap (%zu bytes), %zu with transparent huge pages (%zu bytes), %zu from huge page pool (%zu bytes), %zu huge page pool fallbacks\n",
+    RecordBufferAllocator::heapBufferCount.load(),
+    RecordBufferAllocator::heapBufferSize.load(),
+    RecordBufferAllocator::transparentBufferCount.load(),
+    RecordBufferAllocator::transparentBufferSize.load(),
+    RecordBufferAllocator::hugetlbBufferCount.load(),
+    RecordBufferAllocator::hugetlbBufferSize.load(),
+    RecordBufferAllocator::hugetlbFallbackCount.load());
+}
+
+void RecordBufferAllocator::setHugePagePolicy(
+    std::size_t threshold, HugePageMode mode, bool prefault) {
+  RecordBufferAllocator::hugePageThreshold = threshold;
+  RecordBufferAllocator::hugePageMode = mode;
+  RecordBufferAllocator::prefault = prefault;
+}
+
+// Static member variables need an instance...
+std::atomic<std::size_t> RecordBufferAllocator::heapBufferCount(0);
+std::atomic<std::size_t> RecordBufferAllocator::heapBufferSize(0);
+std::atomic<RecordBufferAllocator::HugePageMode> RecordBufferAllocator::hugePageMode(RecordBufferAllocator::HugePageMode::none);
+std::atomic<std::size_t> RecordBufferAllocator::hugePageThreshold(0);
+std::atomic<std::size_t> RecordBufferAllocator::hugetlbFallbackCount(0);
+std::atomic<std::size_t> RecordBufferAllocator::hugetlbBufferCount(0);
+std::atomic<std::size_t> RecordBufferAllocator::hugetlbBufferSize(0);
+std::atomic<bool> RecordBufferAllocator::prefault(false);
+std::atomic<std::size_t> RecordBufferAllocator::transparentBufferCount(0);
+std::atomic<std::size_t> RecordBufferAllocator::transparentBufferSize(0);
+
+} // namespace EPICS
+} // namespace ChimeraTK
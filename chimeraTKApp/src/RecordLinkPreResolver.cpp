@@ -0,0 +1,227 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <dbAccess.h>
+#include <dbStaticLib.h>
+} // extern "C"
+
+#include "ChimeraTK/EPICS/RecordDeviceSupportBase.h"
+#include "ChimeraTK/EPICS/ThreadPoolExecutor.h"
+
+#include "ChimeraTK/EPICS/RecordLinkPreResolver.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace {
+
+/**
+ * Record found in the database, that still needs to have its link resolved.
+ */
+struct UnresolvedRecord {
+
+  RecordAddress address;
+  bool output;
+  void const *record;
+
+};
+
+/**
+ * Returns the default number of threads used for pre-resolving links. This is
+ * the number of CPU cores, but at least one.
+ */
+std::size_t defaultNumberOfThreads() {
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+} // anonymous namespace
+
+void RecordLinkPreResolver::clear() {
+  std::lock_guard<std::mutex> lock(RecordLinkPreResolver::mutex);
+  RecordLinkPreResolver::resolvedLinks.clear();
+}
+
+ResolvedRecordLink const *RecordLinkPreResolver::find(void const *record) {
+  std::lock_guard<std::mutex> lock(RecordLinkPreResolver::mutex);
+  auto entry = RecordLinkPreResolver::resolvedLinks.find(record);
+  if (entry == RecordLinkPreResolver::resolvedLinks.end()) {
+    return nullptr;
+  }
+  return &entry->second;
+}
+
+std::size_t RecordLinkPreResolver::getNumberOfThreads() {
+  std::lock_guard<std::mutex> lock(RecordLinkPreResolver::mutex);
+  return RecordLinkPreResolver::numberOfThreads;
+}
+
+void RecordLinkPreResolver::preResolve() {
+  auto numberOfThreads = RecordLinkPreResolver::getNumberOfThreads();
+  if (numberOfThreads == 0 || !::pdbbase) {
+    return;
+  }
+  // First, we collect all records that use this device support, grouped by
+  // the application or device that they reference. Parsing the addresses is
+  // cheap, so we do not need to do this in parallel.
+  std::unordered_map<std::string, std::vector<UnresolvedRecord>> recordsByProvider;
+  ::DBENTRY entry;
+  ::dbInitEntry(::pdbbase, &entry);
+  for (long recordTypeStatus = ::dbFirstRecordType(&entry); !recordTypeStatus;
+      recordTypeStatus = ::dbNextRecordType(&entry)) {
+    for (long recordStatus = ::dbFirstRecord(&entry); !recordStatus;
+        recordStatus = ::dbNextRecord(&entry)) {
+      if (::dbIsAlias(&entry)) {
+        continue;
+      }
+      if (::dbFindField(&entry, "DTYP")
+          || std::strcmp(::dbGetString(&entry), "ChimeraTK")) {
+        continue;
+      }
+      // Input records have an INP field and output records have an OUT
+      // field. We only need to know the direction because only output records
+      // need an initial value.
+      bool output = false;
+      if (::dbFindField(&entry, "INP")) {
+        if (::dbFindField(&entry, "OUT")) {
+          continue;
+        }
+        output = true;
+      }
+      // The links have not been initialized yet, so we have to use the string
+      // representation provided by the static database access library.
+      char const *linkString = ::dbGetString(&entry);
+      if (!linkString) {
+        continue;
+      }
+      try {
+        auto address = RecordAddress::parse(linkString);
+        auto &records =
+          recordsByProvider[address.getApplicationOrDeviceName()];
+        records.push_back(
+          UnresolvedRecord{address, output, entry.precnode->precord});
+      } catch (...) {
+        // If the address is invalid, the error is reported when the record is
+        // initialized.
+      }
+    }
+  }
+  ::dbFinishEntry(&entry);
+  if (recordsByProvider.empty()) {
+    return;
+  }
+  // Now we resolve the links. We use one task per PV provider because the PV
+  // providers are not necessarily designed for creating PV supports from
+  // different threads in parallel. Within each task, reading the initial
+  // values is delegated to the I/O threads of the respective PV provider.
+  {
+    ThreadPoolExecutor executor(
+      std::min(numberOfThreads, recordsByProvider.size()));
+    for (auto &providerAndRecords : recordsByProvider) {
+      auto &records = providerAndRecords.second;
+      executor.submitTask([&records](){
+        PVProvider::SharedPtr pvProvider;
+        for (auto &unresolvedRecord : records) {
+          try {
+            auto link = RecordDeviceSupportBase::resolveRecordLink(
+              unresolvedRecord.address);
+            pvProvider = link.pvProvider;
+            if (unresolvedRecord.output
+                && !unresolvedRecord.address.isNoInitialRead()) {
+              RecordDeviceSupportBase::prefetchInitialValue(link);
+            }
+            std::lock_guard<std::mutex> lock(RecordLinkPreResolver::mutex);
+            RecordLinkPreResolver::resolvedLinks.emplace(
+              unresolvedRecord.record, std::move(link));
+          } catch (...) {
+            // If the link cannot be resolved, we simply skip the record. In
+            // this case, the link is resolved again when the record is
+            // initialized and the error is reported at that point.
+          }
+        }
+        // The PV provider might have collected the initial value requests in
+        // order to process them in a single operation, so we have to tell it
+        // that there will not be any further requests.
+        if (pvProvider) {
+          try {
+            pvProvider->flushInitialValueRequests();
+          } catch (...) {
+            // If processing the requests fails, the futures for the initial
+            // values hold the exception, so we do not have to handle it here.
+          }
+        }
+      });
+    }
+    // The destructor of the executor waits for all tasks to finish.
+  }
+  // Finally, we wait for all initial values. The PV supports must not be used
+  // before their initial values are available, so we have to do this before
+  // the records get initialized. We do not hold the mutex while waiting, so
+  // that other threads are not blocked for the whole time. The links are only
+  // taken when the records are initialized, which does not happen before this
+  // method returns, so the pointers stay valid.
+  std::vector<detail::PrefetchedInitialValueBase *> initialValues;
+  {
+    std::lock_guard<std::mutex> lock(RecordLinkPreResolver::mutex);
+    initialValues.reserve(RecordLinkPreResolver::resolvedLinks.size());
+    for (auto &recordAndLink : RecordLinkPreResolver::resolvedLinks) {
+      auto &initialValue = recordAndLink.second.initialValue;
+      if (initialValue) {
+        initialValues.push_back(initialValue.get());
+      }
+    }
+  }
+  for (auto initialValue : initialValues) {
+    initialValue->wait();
+  }
+}
+
+void RecordLinkPreResolver::setNumberOfThreads(std::size_t numberOfThreads) {
+  std::lock_guard<std::mutex> lock(RecordLinkPreResolver::mutex);
+  RecordLinkPreResolver::numberOfThreads = numberOfThreads;
+}
+
+ResolvedRecordLink RecordLinkPreResolver::takeOrResolve(
+    void const *record, ::DBLINK const &linkField) {
+  {
+    std::lock_guard<std::mutex> lock(RecordLinkPreResolver::mutex);
+    auto entry = RecordLinkPreResolver::resolvedLinks.find(record);
+    if (entry != RecordLinkPreResolver::resolvedLinks.end()) {
+      auto link = std::move(entry->second);
+      RecordLinkPreResolver::resolvedLinks.erase(entry);
+      return link;
+    }
+  }
+  return RecordDeviceSupportBase::resolveRecordLink(
+    RecordAddress::parse(linkField));
+}
+
+// Static member variables need an instance...
+std::mutex RecordLinkPreResolver::mutex;
+std::size_t RecordLinkPreResolver::numberOfThreads(defaultNumberOfThreads());
+std::unordered_map<void const *, ResolvedRecordLink> RecordLinkPreResolver::resolvedLinks;
+
+} // namespace EPICS
+} // namespace ChimeraTK
@@ -0,0 +1,30 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "ChimeraTK/EPICS/RecordMutexPool.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+// Static member variables need an instance...
+constexpr std::size_t RecordMutexPool::numberOfMutexes;
+RecordMutexPool::PaddedMutex RecordMutexPool::mutexes[RecordMutexPool::numberOfMutexes];
+
+} // namespace EPICS
+} // namespace ChimeraTK
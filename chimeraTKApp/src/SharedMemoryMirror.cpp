@@ -0,0 +1,231 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+#include "ChimeraTK/EPICS/SharedMemoryMirror.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace {
+
+/**
+ * Alignment (in bytes) of the segment header and of each slot. This is the
+ * size of a cache line on the platforms we care about, so that updating one
+ * slot does not affect readers of other slots.
+ */
+constexpr std::size_t slotAlignment = 64;
+
+/**
+ * Rounds the specified size up to a multiple of the slot alignment.
+ */
+std::size_t alignSize(std::size_t size) {
+  return (size + slotAlignment - 1) / slotAlignment * slotAlignment;
+}
+
+/**
+ * Returns an error message consisting of the specified message and the
+ * description of the current errno.
+ */
+std::string errnoMessage(std::string const &message) {
+  return message + ": " + std::strerror(errno);
+}
+
+/**
+ * Header at the start of the shared-memory segment.
+ */
+struct SegmentHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t numberOfSlots;
+  std::uint64_t size;
+};
+
+static_assert(sizeof(SegmentHeader) <= slotAlignment,
+  "The segment header must fit into the space reserved for it.");
+
+} // anonymous namespace
+
+constexpr std::size_t SharedMemoryMirror::slotDataOffset;
+
+static_assert(sizeof(SharedMemoryMirror::SlotHeader) <= 64,
+  "The slot header must fit into the space reserved for it.");
+
+// Readers in other processes access the sequence numbers without any locks,
+// so the atomic operations must be lock-free and the atomic type must have the
+// same layout as a plain 64-bit integer. C++14 has no is_always_lock_free, so
+// we use the macro for the type that std::uint64_t is based on.
+static_assert(
+  (std::is_same<std::uint64_t, unsigned long>::value
+    ? ATOMIC_LONG_LOCK_FREE : ATOMIC_LLONG_LOCK_FREE) == 2,
+  "Atomic 64-bit integers must always be lock-free for the shared-memory mirror.");
+static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t),
+  "Atomic 64-bit integers must have the size of a plain 64-bit integer.");
+
+SharedMemoryMirror::SharedMemoryMirror(
+    std::string const &segmentName, std::string const &indexFileName,
+    std::vector<SlotDefinition> const &slotDefinitions)
+    : indexFileName(indexFileName), mapping(nullptr),
+      segmentName(
+        (segmentName.empty() || segmentName[0] != '/')
+          ? "/" + segmentName : segmentName),
+      size(0) {
+  if (slotDefinitions.empty()) {
+    throw std::invalid_argument(
+      "The shared-memory mirror must contain at least one process variable.");
+  }
+  // We calculate the layout first, so that we know the size of the segment.
+  std::vector<std::size_t> offsets;
+  offsets.reserve(slotDefinitions.size());
+  std::size_t offset = alignSize(sizeof(SegmentHeader));
+  for (auto const &slotDefinition : slotDefinitions) {
+    if (slotDefinition.numberOfElements
+        > std::numeric_limits<std::uint32_t>::max()
+        || slotDefinition.elementSize
+        > std::numeric_limits<std::uint32_t>::max()) {
+      throw std::invalid_argument(
+        std::string("The process variable '") + slotDefinition.name
+          + "' is too large for the shared-memory mirror.");
+    }
+    offsets.push_back(offset);
+    offset += alignSize(slotDataOffset
+      + slotDefinition.elementSize * slotDefinition.numberOfElements);
+  }
+  this->size = offset;
+  // We never replace an existing segment, because it might belong to another
+  // IOC that is still running, and removing it would silently disconnect that
+  // IOC's readers.
+  int fd = ::shm_open(
+    this->segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd == -1) {
+    if (errno == EEXIST) {
+      throw std::runtime_error(
+        std::string("The shared-memory segment '") + this->segmentName
+          + "' already exists. It might be used by another IOC. If it has been left over by an IOC that has not been shut down cleanly, it has to be removed manually.");
+    }
+    throw std::runtime_error(errnoMessage(
+      std::string("Could not create the shared-memory segment '")
+        + this->segmentName + "'"));
+  }
+  if (::ftruncate(fd, static_cast<::off_t>(this->size)) == -1) {
+    auto message = errnoMessage(
+      std::string("Could not resize the shared-memory segment '")
+        + this->segmentName + "'");
+    ::close(fd);
+    ::shm_unlink(this->segmentName.c_str());
+    throw std::runtime_error(message);
+  }
+  this->mapping = ::mmap(
+    nullptr, this->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // The mapping stays valid after closing the file descriptor.
+  ::close(fd);
+  if (this->mapping == MAP_FAILED) {
+    this->mapping = nullptr;
+    auto message = errnoMessage(
+      std::string("Could not map the shared-memory segment '")
+        + this->segmentName + "'");
+    ::shm_unlink(this->segmentName.c_str());
+    throw std::runtime_error(message);
+  }
+  // The segment is zero-filled, so we only have to initialize the fields that
+  // are not zero.
+  auto base = static_cast<char *>(this->mapping);
+  this->slots.reserve(slotDefinitions.size());
+  for (std::size_t i = 0; i < slotDefinitions.size(); ++i) {
+    auto slot = new (base + offsets[i]) SlotHeader();
+    slot->numberOfElements =
+      static_cast<std::uint32_t>(slotDefinitions[i].numberOfElements);
+    slot->elementSize =
+      static_cast<std::uint32_t>(slotDefinitions[i].elementSize);
+    this->slots.push_back(slot);
+  }
+  auto header = reinterpret_cast<SegmentHeader *>(base);
+  header->version = 1;
+  header->numberOfSlots = static_cast<std::uint32_t>(slotDefinitions.size());
+  header->size = this->size;
+  // We write the magic string last, so that a reader that checks it never
+  // sees an incomplete header.
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, "CTKSHMIR", sizeof(header->magic));
+  // We write the index file to a temporary file and rename it, so that
+  // readers never see an incomplete file.
+  try {
+    auto temporaryFileName = indexFileName + ".tmp";
+    std::ofstream indexFile(temporaryFileName, std::ios::trunc);
+    if (!indexFile) {
+      throw std::runtime_error(
+        std::string("The file '") + temporaryFileName
+          + "' could not be opened.");
+    }
+    indexFile << "# CTKSHMIR 1 " << this->segmentName << " " << this->size
+      << "\n";
+    for (std::size_t i = 0; i < slotDefinitions.size(); ++i) {
+      auto const &slotDefinition = slotDefinitions[i];
+      indexFile << offsets[i] << " " << slotDefinition.typeName << " "
+        << slotDefinition.elementSize << " "
+        << slotDefinition.numberOfElements << " " << slotDefinition.name
+        << "\n";
+    }
+    indexFile.close();
+    if (!indexFile) {
+      throw std::runtime_error(
+        std::string("The file '") + temporaryFileName
+          + "' could not be written.");
+    }
+    if (std::rename(temporaryFileName.c_str(), indexFileName.c_str()) != 0) {
+      throw std::runtime_error(errnoMessage(
+        std::string("Could not rename '") + temporaryFileName + "' to '"
+          + indexFileName + "'"));
+    }
+  } catch (...) {
+    ::munmap(this->mapping, this->size);
+    ::shm_unlink(this->segmentName.c_str());
+    throw;
+  }
+}
+
+SharedMemoryMirror::~SharedMemoryMirror() noexcept {
+  if (this->mapping) {
+    ::munmap(this->mapping, this->size);
+    ::shm_unlink(this->segmentName.c_str());
+    // Without the segment, the index file is useless, and leaving it behind
+    // would make readers believe that the segment still exists.
+    std::remove(this->indexFileName.c_str());
+  }
+}
+
+} // namespace EPICS
+} // namespace ChimeraTK
@@ -22,10 +22,14 @@
 namespace ChimeraTK {
 namespace EPICS {
 
-ThreadPoolExecutor::ThreadPoolExecutor(std::size_t numberOfPoolThreads)
-    : shutdownRequested(false) {
+ThreadPoolExecutor::ThreadPoolExecutor(std::size_t numberOfPoolThreads,
+    ThreadSettings const &threadSettings)
+    : shutdownRequested(false), threadSettings(threadSettings) {
   for (std::size_t i = 0; i < numberOfPoolThreads; ++i) {
-    this->threads.push_back(std::thread([this](){this->runThread();}));
+    this->threads.push_back(std::thread([this, i](){
+      applyThreadSettings(this->threadSettings, static_cast<int>(i));
+      this->runThread();
+    }));
   }
 }
 
@@ -33,6 +37,11 @@ ThreadPoolExecutor::~ThreadPoolExecutor() {
   shutdown();
 }
 
+std::size_t ThreadPoolExecutor::getQueuedTaskCount() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->tasks.size();
+}
+
 void ThreadPoolExecutor::runThread() {
   for (;;) {
     std::packaged_task<void()> nextTask;
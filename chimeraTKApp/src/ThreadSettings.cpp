@@ -0,0 +1,258 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+extern "C" {
+#include <pthread.h>
+#include <sched.h>
+}
+
+#include "ChimeraTK/EPICS/errorPrint.h"
+
+#include "ChimeraTK/EPICS/ThreadSettings.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace {
+
+/**
+ * Max. length of a thread name (excluding the terminating null byte) that is
+ * accepted by the operating system.
+ */
+constexpr std::size_t maxOsThreadNameLength = 15;
+
+/**
+ * Name of the calling thread, as set by applyThreadSettings(...).
+ */
+thread_local std::string currentThreadName;
+
+/**
+ * Thread classes and the suffixes that are appended to the name of the PV
+ * provider in order to build the default thread name. The copy, error-print,
+ * and timer threads do not belong to a PV provider, so their suffix is the
+ * whole name.
+ */
+std::map<std::string, std::string> const &threadClassSuffixes() {
+  static std::map<std::string, std::string> const suffixes{
+    {"copy", "ctkCopy"},
+    {"errorPrint", "ctkErrorPrint"},
+    {"highPriorityNotification", "-notifyHi"},
+    {"io", "-io"},
+    {"notification", "-notify"},
+    {"timer", "ctkTimer"}};
+  return suffixes;
+}
+
+/**
+ * Mutex protecting access to the map returned by threadSettingsMap().
+ */
+std::mutex &threadSettingsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+/**
+ * Map storing the thread settings. The key is the pair of the PV provider name
+ * and the thread class.
+ */
+std::map<std::pair<std::string, std::string>, ThreadSettings> &threadSettingsMap() {
+  static std::map<std::pair<std::string, std::string>, ThreadSettings> map;
+  return map;
+}
+
+/**
+ * Tells whether threads of the specified class are shared by all PV providers
+ * (and thus configured without a provider name).
+ */
+bool isSharedThreadClass(std::string const &threadClass) {
+  return threadClass == "copy" || threadClass == "errorPrint"
+    || threadClass == "timer";
+}
+
+/**
+ * Parses a CPU number. Throws an exception if the string is not a valid CPU
+ * number.
+ */
+int parseCpu(std::string const &cpuString) {
+  std::size_t endPosition;
+  int cpu;
+  try {
+    cpu = std::stoi(cpuString, &endPosition);
+  } catch (std::exception &) {
+    endPosition = 0;
+  }
+  if (endPosition == 0 || endPosition != cpuString.size()) {
+    throw std::invalid_argument(
+      std::string("Invalid CPU number: '") + cpuString + "'");
+  }
+#ifdef __linux__
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+#else
+  if (cpu < 0) {
+#endif
+    throw std::invalid_argument(
+      std::string("CPU number out of range: '") + cpuString + "'");
+  }
+  return cpu;
+}
+
+} // anonymous namespace
+
+void applyThreadSettings(ThreadSettings const &settings, int index) noexcept {
+  try {
+    currentThreadName = settings.name;
+    if (index >= 0) {
+      currentThreadName += "-" + std::to_string(index);
+    }
+  } catch (...) {
+    // If we cannot allocate memory for the name, we simply use no name.
+  }
+  char const *name =
+    currentThreadName.empty() ? "(unnamed)" : currentThreadName.c_str();
+#ifdef __linux__
+  if (!currentThreadName.empty()) {
+    char osName[maxOsThreadNameLength + 1];
+    std::strncpy(osName, currentThreadName.c_str(), maxOsThreadNameLength);
+    osName[maxOsThreadNameLength] = 0;
+    ::pthread_setname_np(::pthread_self(), osName);
+  }
+  if (!settings.cpus.empty()) {
+    ::cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto cpu : settings.cpus) {
+      CPU_SET(cpu, &cpuSet);
+    }
+    int result = ::pthread_setaffinity_np(
+      ::pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (result) {
+      errorPrintf("Could not set the CPU affinity of thread %s: %s", name,
+        std::strerror(result));
+    }
+  }
+  if (settings.realtimePriority > 0) {
+    ::sched_param schedParam;
+    std::memset(&schedParam, 0, sizeof(schedParam));
+    schedParam.sched_priority = settings.realtimePriority;
+    int result = ::pthread_setschedparam(
+      ::pthread_self(), SCHED_FIFO, &schedParam);
+    if (result) {
+      errorPrintf("Could not set the real-time priority of thread %s: %s",
+        name, std::strerror(result));
+    }
+  }
+#else
+  if (!settings.cpus.empty() || settings.realtimePriority > 0) {
+    errorPrintf(
+      "Could not apply the settings of thread %s: CPU affinity and real-time priorities are only supported on Linux.",
+      name);
+  }
+#endif
+}
+
+char const *getCurrentThreadName() noexcept {
+  return currentThreadName.empty() ? nullptr : currentThreadName.c_str();
+}
+
+ThreadSettings getThreadSettings(
+    std::string const &providerName, std::string const &threadClass) {
+  ThreadSettings settings;
+  {
+    std::lock_guard<std::mutex> lock(threadSettingsMutex());
+    auto &map = threadSettingsMap();
+    auto entry = map.find(std::make_pair(providerName, threadClass));
+    if (entry != map.end()) {
+      settings = entry->second;
+    }
+  }
+  if (settings.name.empty()) {
+    auto suffix = threadClassSuffixes().find(threadClass);
+    if (suffix != threadClassSuffixes().end()) {
+      settings.name = providerName + suffix->second;
+    }
+  }
+  return settings;
+}
+
+std::vector<int> parseCpuList(std::string const &cpuList) {
+  std::vector<int> cpus;
+  std::size_t start = 0;
+  while (start < cpuList.size()) {
+    auto end = cpuList.find(',', start);
+    if (end == std::string::npos) {
+      end = cpuList.size();
+    }
+    auto item = cpuList.substr(start, end - start);
+    auto dashPosition = item.find('-');
+    if (dashPosition == std::string::npos) {
+      cpus.push_back(parseCpu(item));
+    } else {
+      auto first = parseCpu(item.substr(0, dashPosition));
+      auto last = parseCpu(item.substr(dashPosition + 1));
+      if (first > last) {
+        throw std::invalid_argument(
+          std::string("Invalid CPU range: '") + item + "'");
+      }
+      for (auto cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    }
+    start = end + 1;
+  }
+  return cpus;
+}
+
+void setThreadSettings(std::string const &providerName,
+    std::string const &threadClass, ThreadSettings const &settings) {
+  if (threadClassSuffixes().find(threadClass) == threadClassSuffixes().end()) {
+    throw std::invalid_argument(
+      std::string("Unknown thread class: '") + threadClass + "'");
+  }
+  if (isSharedThreadClass(threadClass) && !providerName.empty()) {
+    throw std::invalid_argument(
+      std::string("The threads of class '") + threadClass
+        + "' are shared by all PV providers, so they must be configured without a provider name.");
+  }
+  if (!isSharedThreadClass(threadClass) && providerName.empty()) {
+    throw std::invalid_argument(
+      std::string("A provider name must be specified for the thread class '")
+        + threadClass + "'.");
+  }
+  if (settings.realtimePriority < 0) {
+    throw std::invalid_argument("The real-time priority must not be negative.");
+  }
+#ifdef __linux__
+  if (settings.realtimePriority > 0
+      && (settings.realtimePriority < ::sched_get_priority_min(SCHED_FIFO)
+        || settings.realtimePriority > ::sched_get_priority_max(SCHED_FIFO))) {
+    throw std::invalid_argument(
+      "The real-time priority is outside the range supported by SCHED_FIFO.");
+  }
+#endif
+  std::lock_guard<std::mutex> lock(threadSettingsMutex());
+  threadSettingsMap()[std::make_pair(providerName, threadClass)] = settings;
+}
+
+} // namespace EPICS
+} // namespace ChimeraTK
@@ -17,6 +17,8 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include "ChimeraTK/EPICS/ThreadSettings.h"
+
 #include "ChimeraTK/EPICS/Timer.h"
 
 namespace ChimeraTK {
@@ -57,7 +59,13 @@ void Timer::Impl::submitTask(Task &&task) {
       // We use a shared pointer to this instead of this so that this object
       // cannot be destructed while the thread is running.
       auto impl = this->shared_from_this();
-      std::thread t([impl]{ impl->runThread(); });
+      // The timer thread is not associated with a specific PV provider, so
+      // its settings are stored without a provider name.
+      auto threadSettings = getThreadSettings(std::string(), "timer");
+      std::thread t([impl, threadSettings]{
+        applyThreadSettings(threadSettings);
+        impl->runThread();
+      });
       this->threadRunning = true;
       t.detach();
     }
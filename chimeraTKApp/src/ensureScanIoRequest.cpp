@@ -0,0 +1,52 @@
+/*
+ * ChimeraTK control-system adapter for EPICS.
+ *
+ * Copyright 2018-2022 aquenos GmbH
+ *
+ * The ChimeraTK Control System Adapter for EPICS is free software: you can
+ * redistribute it and/or modify it under the terms of the GNU Lesser General
+ * Public License version 3 as published by the Free Software Foundation.
+ *
+ * The ChimeraTK Control System Adapter for EPICS is distributed in the hope
+ * that it will be useful, but WITHOUT ANY WARRANTY; without even the implied
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the ChimeraTK Control System Adapter for EPICS. If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+
+#include "ChimeraTK/EPICS/Timer.h"
+
+#include "ChimeraTK/EPICS/ensureScanIoRequest.h"
+
+namespace ChimeraTK {
+namespace EPICS {
+
+namespace {
+
+std::atomic<std::size_t> scanIoRequestRetryCount(0);
+
+} // anonymous namespace
+
+void ensureScanIoRequest(::IOSCANPVT ioScanPvt) {
+  if (!::scanIoRequest(ioScanPvt)) {
+    scanIoRequestRetryCount.fetch_add(1, std::memory_order_relaxed);
+    Timer::shared().submitDelayedTask(
+      std::chrono::milliseconds(100),
+      [ioScanPvt](){
+        ensureScanIoRequest(ioScanPvt);
+      });
+  }
+}
+
+std::size_t getScanIoRequestRetryCount() {
+  return scanIoRequestRetryCount.load(std::memory_order_relaxed);
+}
+
+} // namespace EPICS
+} // namespace ChimeraTK
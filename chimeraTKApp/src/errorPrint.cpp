@@ -17,28 +17,99 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
 
 extern "C" {
 #include <unistd.h>
 }
 
+#include <epicsEvent.h>
+#include <epicsExit.h>
 #include <epicsThread.h>
 #include <epicsTime.h>
 
+#include "ChimeraTK/EPICS/ThreadSettings.h"
+
 #include "ChimeraTK/EPICS/errorPrint.h"
 
 namespace ChimeraTK {
 namespace EPICS {
 
-static void errorPrintInternal(const char *format, const char *timeString,
+namespace {
+
+/**
+ * Max. size of a message (including the terminating null byte) passed to
+ * errorPrintfRateLimited(...). Longer messages are truncated.
+ */
+constexpr std::size_t maxQueuedMessageSize = 512;
+
+/**
+ * Number of messages that can be queued. This must be a power of two.
+ */
+constexpr std::size_t queueCapacity = 256;
+
+/**
+ * Number of entries in the table that is used for detecting repeated messages.
+ * Sources that map to the same entry evict each other. In this case, repeated
+ * messages might not be suppressed, but no message is lost.
+ */
+constexpr std::size_t repetitionTableSize = 1021;
+
+std::atomic<std::size_t> droppedCount(0);
+
+std::atomic<std::size_t> suppressedCount(0);
+
+std::atomic<std::int64_t> suppressionIntervalNanoseconds(10000000000);
+
+/**
+ * Tells whether ANSI escape sequences should be used for formatting the
+ * messages. Calling isatty(...) for every message is comparatively expensive,
+ * so we only do it once.
+ */
+bool useAnsiSequences() noexcept {
+  static bool useAnsiSequences = ::isatty(STDERR_FILENO);
+  return useAnsiSequences;
+}
+
+/**
+ * Returns the current time (of the monotonic clock) in nanoseconds.
+ */
+std::int64_t currentTimeNanoseconds() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Calculates the FNV-1a hash of a null-terminated string.
+ */
+std::uint64_t hashMessage(const char *message) noexcept {
+  std::uint64_t hash = 14695981039346656037ULL;
+  for (; *message; ++message) {
+    hash ^= static_cast<unsigned char>(*message);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+ * Writes a message to stderr. The stream is locked while writing, so that
+ * messages written by different threads are not interleaved. The stream is not
+ * flushed by this function.
+ */
+void writeMessageV(const char *format, const char *timeString,
     const char *threadString, std::va_list varArgs) noexcept {
-  bool useAnsiSequences = ::isatty(STDERR_FILENO);
-  if (useAnsiSequences) {
+  bool ansi = useAnsiSequences();
+  ::flockfile(stderr);
+  if (ansi) {
     // Set format to bold, red.
-    std::fprintf(stderr, "\x1b[1;31m");
+    std::fputs("\x1b[1;31m", stderr);
   }
   if (timeString) {
     std::fprintf(stderr, "%s ", timeString);
@@ -47,11 +118,322 @@ static void errorPrintInternal(const char *format, const char *timeString,
     std::fprintf(stderr, "%s ", threadString);
   }
   std::vfprintf(stderr, format, varArgs);
-  if (useAnsiSequences) {
+  if (ansi) {
     // Reset format
-    std::fprintf(stderr, "\x1b[0m");
+    std::fputs("\x1b[0m", stderr);
+  }
+  std::fputc('\n', stderr);
+  ::funlockfile(stderr);
+}
+
+/**
+ * Formats a time stamp in the format used for error messages. Returns the
+ * buffer or null if the time stamp cannot be formatted.
+ */
+const char *formatTimeStamp(
+    ::epicsTimeStamp const &timeStamp, char *buffer, std::size_t bufferSize)
+    noexcept {
+  if (::epicsTimeToStrftime(
+      buffer, bufferSize, "%Y/%m/%d %H:%M:%S.%06f", &timeStamp)) {
+    return buffer;
+  }
+  return nullptr;
+}
+
+/**
+ * Writes a message prefixed with the specified time stamp to stderr. If the
+ * time stamp is null, the message is written without a time stamp.
+ */
+void writeTimedMessage(
+    ::epicsTimeStamp const *timeStamp, const char *format, ...) noexcept {
+  char timeBuffer[64];
+  const char *timeString = nullptr;
+  if (timeStamp) {
+    timeString = formatTimeStamp(*timeStamp, timeBuffer, sizeof(timeBuffer));
+  }
+  std::va_list varArgs;
+  va_start(varArgs, format);
+  writeMessageV(format, timeString, nullptr, varArgs);
+  va_end(varArgs);
+}
+
+/**
+ * Writes a message prefixed with the current time to stderr.
+ */
+void writeCurrentTimeMessage(const char *format, ...) noexcept {
+  char timeBuffer[64];
+  const char *timeString = nullptr;
+  ::epicsTimeStamp timeStamp;
+  if (!::epicsTimeGetCurrent(&timeStamp)) {
+    timeString = formatTimeStamp(timeStamp, timeBuffer, sizeof(timeBuffer));
+  }
+  std::va_list varArgs;
+  va_start(varArgs, format);
+  writeMessageV(format, timeString, nullptr, varArgs);
+  va_end(varArgs);
+}
+
+/**
+ * Queue for messages passed to errorPrintfRateLimited(...) and the state
+ * needed for detecting repeated messages.
+ *
+ * The queue is a bounded, lock-free multi-producer queue (using the algorithm
+ * by Dmitry Vyukov). Each slot has a sequence number that tells whether it is
+ * ready for being written by a producer or being read by the consumer. There
+ * is only one consumer at a time (the writer thread or the exit handler),
+ * which is ensured by the consumer mutex.
+ */
+class ErrorMessageQueue {
+
+public:
+
+  /**
+   * Returns the only instance of this class. The instance is created on first
+   * use and never destroyed, because the writer thread might still use it
+   * while static objects are being destroyed.
+   */
+  static ErrorMessageQueue &getInstance() {
+    static ErrorMessageQueue *instance = new ErrorMessageQueue();
+    return *instance;
+  }
+
+  /**
+   * Prints a message for a source, unless it repeats the last message printed
+   * for the same source within the suppression interval.
+   */
+  void print(const char *source, const char *message) noexcept {
+    auto hash = hashMessage(message);
+    auto now = currentTimeNanoseconds();
+    auto interval =
+      suppressionIntervalNanoseconds.load(std::memory_order_relaxed);
+    auto &entry = this->repetitions[
+      reinterpret_cast<std::uintptr_t>(source) % repetitionTableSize];
+    // The fields of an entry are not updated atomically as a whole. In the
+    // worst case, a race results in a message being printed even though it
+    // could have been suppressed (or the other way round), which is
+    // acceptable.
+    if (interval > 0
+        && entry.source.load(std::memory_order_acquire) == source
+        && entry.messageHash.load(std::memory_order_relaxed) == hash
+        && now - entry.lastPrintTime.load(std::memory_order_relaxed)
+        < interval) {
+      entry.repeatCount.fetch_add(1, std::memory_order_relaxed);
+      suppressedCount.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    auto previousSource =
+      entry.source.exchange(source, std::memory_order_acq_rel);
+    auto repeatCount =
+      entry.repeatCount.exchange(0, std::memory_order_relaxed);
+    entry.messageHash.store(hash, std::memory_order_relaxed);
+    entry.lastPrintTime.store(now, std::memory_order_relaxed);
+    if (previousSource && repeatCount) {
+      char summary[64];
+      std::snprintf(summary, sizeof(summary),
+        "Last message repeated %lu times.",
+        static_cast<unsigned long>(repeatCount));
+      this->enqueue(previousSource, summary);
+    }
+    this->enqueue(source, message);
+  }
+
+  /**
+   * Writes all queued messages and the summaries for all suppressed messages.
+   * This is called when the process exits.
+   */
+  void flush() noexcept {
+    std::lock_guard<std::mutex> lock(this->consumerMutex);
+    this->processQueue(true);
+  }
+
+private:
+
+  /**
+   * Slot in the message queue.
+   */
+  struct QueuedMessage {
+    std::atomic<std::size_t> sequence;
+    const char *source;
+    ::epicsTimeStamp timeStamp;
+    bool timeStampValid;
+    char message[maxQueuedMessageSize];
+  };
+
+  /**
+   * Entry in the table used for detecting repeated messages.
+   */
+  struct RepetitionEntry {
+    std::atomic<const char *> source;
+    std::atomic<std::uint64_t> messageHash;
+    std::atomic<std::int64_t> lastPrintTime;
+    std::atomic<std::uint32_t> repeatCount;
+  };
+
+  QueuedMessage messages[queueCapacity];
+  RepetitionEntry repetitions[repetitionTableSize];
+  std::atomic<std::size_t> enqueuePosition;
+
+  // The following fields are protected by the consumer mutex.
+  std::mutex consumerMutex;
+  std::size_t dequeuePosition;
+  std::int64_t lastRepetitionScanTime;
+  std::size_t reportedDroppedCount;
+
+  ::epicsEventId wakeUpEvent;
+  std::once_flag threadStartedFlag;
+
+  ErrorMessageQueue()
+      : enqueuePosition(0), dequeuePosition(0), lastRepetitionScanTime(0),
+        reportedDroppedCount(0),
+        wakeUpEvent(::epicsEventMustCreate(::epicsEventEmpty)) {
+    for (std::size_t i = 0; i < queueCapacity; ++i) {
+      this->messages[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    for (auto &entry : this->repetitions) {
+      entry.source.store(nullptr, std::memory_order_relaxed);
+      entry.messageHash.store(0, std::memory_order_relaxed);
+      entry.lastPrintTime.store(0, std::memory_order_relaxed);
+      entry.repeatCount.store(0, std::memory_order_relaxed);
+    }
   }
-  std::fprintf(stderr, "\n");
+
+  // Delete copy constructors and assignment operators.
+  ErrorMessageQueue(ErrorMessageQueue const &) = delete;
+  ErrorMessageQueue &operator=(ErrorMessageQueue const &) = delete;
+
+  void enqueue(const char *source, const char *message) noexcept {
+    auto position = this->enqueuePosition.load(std::memory_order_relaxed);
+    QueuedMessage *slot;
+    for (;;) {
+      slot = &this->messages[position & (queueCapacity - 1)];
+      auto sequence = slot->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<std::intptr_t>(sequence)
+        - static_cast<std::intptr_t>(position);
+      if (difference == 0) {
+        if (this->enqueuePosition.compare_exchange_weak(
+            position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        // The queue is full. We rather drop the message than block the
+        // calling thread.
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+      } else {
+        position = this->enqueuePosition.load(std::memory_order_relaxed);
+      }
+    }
+    slot->source = source;
+    // The message might only be written much later, so we have to remember
+    // when it was generated.
+    slot->timeStampValid = !::epicsTimeGetCurrent(&slot->timeStamp);
+    auto length = ::strnlen(message, maxQueuedMessageSize - 1);
+    std::memcpy(slot->message, message, length);
+    slot->message[length] = '\0';
+    slot->sequence.store(position + 1, std::memory_order_release);
+    this->startThread();
+    ::epicsEventSignal(this->wakeUpEvent);
+  }
+
+  /**
+   * Writes the queued messages. If forceRepetitionScan is false, the
+   * summaries for suppressed messages are only written if at least one second
+   * has passed since they were last checked. Must only be called while
+   * holding the consumer mutex.
+   */
+  void processQueue(bool forceRepetitionScan) noexcept {
+    bool written = false;
+    for (;;) {
+      auto &slot =
+        this->messages[this->dequeuePosition & (queueCapacity - 1)];
+      if (slot.sequence.load(std::memory_order_acquire)
+          != this->dequeuePosition + 1) {
+        break;
+      }
+      writeTimedMessage(slot.timeStampValid ? &slot.timeStamp : nullptr,
+        "%s %s", slot.source, slot.message);
+      written = true;
+      slot.sequence.store(
+        this->dequeuePosition + queueCapacity, std::memory_order_release);
+      ++this->dequeuePosition;
+    }
+    auto dropped = droppedCount.load(std::memory_order_relaxed);
+    if (dropped != this->reportedDroppedCount) {
+      writeCurrentTimeMessage(
+        "%lu error messages were dropped because the queue was full.",
+        static_cast<unsigned long>(dropped - this->reportedDroppedCount));
+      this->reportedDroppedCount = dropped;
+      written = true;
+    }
+    auto now = currentTimeNanoseconds();
+    if (forceRepetitionScan
+        || now - this->lastRepetitionScanTime >= 1000000000) {
+      this->lastRepetitionScanTime = now;
+      auto interval =
+        suppressionIntervalNanoseconds.load(std::memory_order_relaxed);
+      for (auto &entry : this->repetitions) {
+        if (!entry.repeatCount.load(std::memory_order_relaxed)) {
+          continue;
+        }
+        if (!forceRepetitionScan
+            && now - entry.lastPrintTime.load(std::memory_order_relaxed)
+            < interval) {
+          continue;
+        }
+        auto repeatCount =
+          entry.repeatCount.exchange(0, std::memory_order_relaxed);
+        auto source = entry.source.load(std::memory_order_acquire);
+        if (repeatCount && source) {
+          writeCurrentTimeMessage("%s Last message repeated %lu times.", source,
+            static_cast<unsigned long>(repeatCount));
+          written = true;
+        }
+      }
+    }
+    if (written) {
+      std::fflush(stderr);
+    }
+  }
+
+  static void flushAtExit(void *queue) noexcept {
+    static_cast<ErrorMessageQueue *>(queue)->flush();
+  }
+
+  void runThread() noexcept {
+    for (;;) {
+      // We wake up at least once per second, so that the summaries for
+      // suppressed messages are written in time.
+      ::epicsEventWaitWithTimeout(this->wakeUpEvent, 1.0);
+      std::lock_guard<std::mutex> lock(this->consumerMutex);
+      this->processQueue(false);
+    }
+  }
+
+  void startThread() noexcept {
+    try {
+      std::call_once(this->threadStartedFlag, [this]{
+        // The writer thread is not associated with a specific PV provider, so
+        // its settings are stored without a provider name.
+        auto threadSettings = getThreadSettings(std::string(), "errorPrint");
+        std::thread([this, threadSettings]{
+          applyThreadSettings(threadSettings);
+          this->runThread();
+        }).detach();
+        ::epicsAtExit(ErrorMessageQueue::flushAtExit, this);
+      });
+    } catch (...) {
+      // If the thread cannot be started, the messages stay in the queue and
+      // we try again when the next message is queued.
+    }
+  }
+
+};
+
+} // anonymous namespace
+
+static void errorPrintInternal(const char *format, const char *timeString,
+    const char *threadString, std::va_list varArgs) noexcept {
+  writeMessageV(format, timeString, threadString, varArgs);
   std::fflush(stderr);
 }
 
@@ -78,9 +460,48 @@ void errorExtendedPrintf(const char *format, ...) noexcept {
   }
   std::va_list varArgs;
   va_start(varArgs, format);
-  errorPrintInternal(format, timeString, ::epicsThreadGetNameSelf(), varArgs);
+  // Threads started by this library have a name that is more meaningful than
+  // the one assigned by EPICS for non-EPICS threads.
+  const char *threadString = getCurrentThreadName();
+  if (!threadString) {
+    threadString = ::epicsThreadGetNameSelf();
+  }
+  errorPrintInternal(format, timeString, threadString, varArgs);
   va_end(varArgs);
 }
 
+void errorPrintfRateLimited(
+    const char *source, const char *format, ...) noexcept {
+  // Formatting the message is cheap compared to writing it, so we do it on
+  // the calling thread. This way, we do not have to copy the arguments.
+  char message[maxQueuedMessageSize];
+  std::va_list varArgs;
+  va_start(varArgs, format);
+  std::vsnprintf(message, maxQueuedMessageSize, format, varArgs);
+  va_end(varArgs);
+  try {
+    ErrorMessageQueue::getInstance().print(source, message);
+  } catch (...) {
+    // Creating the queue can only fail if we are out of memory. In this case,
+    // the message is dropped.
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+std::size_t getErrorPrintDroppedCount() noexcept {
+  return droppedCount.load(std::memory_order_relaxed);
+}
+
+std::size_t getErrorPrintSuppressedCount() noexcept {
+  return suppressedCount.load(std::memory_order_relaxed);
+}
+
+void setErrorPrintSuppressionInterval(
+    std::chrono::milliseconds interval) noexcept {
+  suppressionIntervalNanoseconds.store(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count(),
+    std::memory_order_relaxed);
+}
+
 } // namespace EPICS
 } // namespace ChimeraTK
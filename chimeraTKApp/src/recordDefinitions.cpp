@@ -18,22 +18,30 @@
  */
 
 #include <cstdarg>
+#include <cstring>
+#include <new>
 
 extern "C" {
 #include <unistd.h>
 }
 
+#include <epicsStdio.h>
 #include <epicsThread.h>
 #include <epicsTime.h>
 
 extern "C" {
 #include <alarm.h>
+#include <dbAccess.h>
+#include <dbBase.h>
+#include <dbStaticLib.h>
 #include <devSup.h>
 #include <epicsExport.h>
 #include <recGbl.h>
 }
 
 #include "ChimeraTK/EPICS/RecordDeviceSupport.h"
+#include "ChimeraTK/EPICS/RecordDeviceSupportArena.h"
+#include "ChimeraTK/EPICS/RecordMutexPool.h"
 #include "ChimeraTK/EPICS/errorPrint.h"
 
 using namespace ChimeraTK::EPICS;
@@ -110,15 +118,74 @@ long getInterruptInfo(int command, void *recordAsVoid, IOSCANPVT *iopvt) {
     }
     deviceSupport->getInterruptInfo(command, iopvt);
   } catch (std::exception const & e) {
-    errorPrintf("%s Record processing failed: %s", record->name, e.what());
+    errorPrintfRateLimited(
+        record->name, "Record processing failed: %s", e.what());
     return -1;
   } catch (...) {
-    errorPrintf("%s Record processing failed: Unknown error.", record->name);
+    errorPrintfRateLimited(
+        record->name, "Record processing failed: Unknown error.");
     return -1;
   }
   return 0;
 }
 
+/**
+ * Reserves space in the arena for the device supports of all records that have
+ * the same type as the specified record and use this device support. This way,
+ * all these device supports are allocated from a single, contiguous slab.
+ *
+ * This only has an effect when it is called for the first time for a record
+ * type. This is safe because init_record is always called from the same
+ * thread.
+ */
+template<typename RecordType>
+void reserveDeviceSupportArena(RecordType *record) {
+  static bool reserved = false;
+  if (reserved || !::pdbbase) {
+    return;
+  }
+  reserved = true;
+  std::size_t numberOfRecords = 0;
+  ::DBENTRY entry;
+  ::dbInitEntry(::pdbbase, &entry);
+  if (!::dbFindRecordType(&entry, record->rdes->name)) {
+    for (long status = ::dbFirstRecord(&entry); !status;
+        status = ::dbNextRecord(&entry)) {
+      if (::dbIsAlias(&entry) || ::dbFindField(&entry, "DTYP")) {
+        continue;
+      }
+      if (!std::strcmp(::dbGetString(&entry), "ChimeraTK")) {
+        ++numberOfRecords;
+      }
+    }
+  }
+  ::dbFinishEntry(&entry);
+  RecordDeviceSupportArena<RecordDeviceSupport<RecordType>>::reserve(
+    numberOfRecords);
+}
+
+/**
+ * Template function for printing a report about a record type's device
+ * supports. This function is called by the dbior IOC shell command.
+ */
+template<typename RecordType>
+long reportRecordType(int level) {
+  auto statistics =
+    RecordDeviceSupportArena<RecordDeviceSupport<RecordType>>::getStatistics();
+  ::epicsStdoutPrintf(
+    "  %zu records, %zu bytes per device support, %zu bytes in %zu slabs\n",
+    statistics.used, statistics.objectSize,
+    statistics.capacity * statistics.objectSize, statistics.numberOfSlabs);
+  if (level > 0
+      && RecordDeviceSupportTraits<RecordType>::direction
+      == RecordDirection::OUTPUT) {
+    ::epicsStdoutPrintf(
+      "  Record mutex pool (shared by all output records): %zu bytes\n",
+      RecordMutexPool::getMemorySize());
+  }
+  return 0;
+}
+
 /**
  * Template function for initializing the device support for a record.
  */
@@ -131,8 +198,18 @@ long initRecord(void *recordAsVoid) {
   }
   RecordType *record = static_cast<RecordType *>(recordAsVoid);
   try {
-    RecordDeviceSupport<RecordType> *deviceSupport =
-        new RecordDeviceSupport<RecordType>(record);
+    using Arena = RecordDeviceSupportArena<RecordDeviceSupport<RecordType>>;
+    reserveDeviceSupportArena(record);
+    // The device support is never destroyed, so we can allocate it from the
+    // arena and only have to give the memory back if the constructor fails.
+    void *memory = Arena::allocate();
+    RecordDeviceSupport<RecordType> *deviceSupport;
+    try {
+      deviceSupport = new (memory) RecordDeviceSupport<RecordType>(record);
+    } catch (...) {
+      Arena::deallocate(memory);
+      throw;
+    }
     record->dpvt = deviceSupport;
   } catch (std::exception const & e) {
     errorPrintf("%s Record initialization failed: %s", record->name, e.what());
@@ -165,11 +242,13 @@ long processRecord(void *recordAsVoid) {
     }
     deviceSupport->process();
   } catch (std::exception const & e) {
-    errorPrintf("%s Record processing failed: %s", record->name, e.what());
+    errorPrintfRateLimited(
+        record->name, "Record processing failed: %s", e.what());
     recGblSetSevr(record, getProcessErrorAlarmStatus<RecordType>(), INVALID_ALARM);
     return -1;
   } catch (...) {
-    errorPrintf("%s Record processing failed: Unknown error.", record->name);
+    errorPrintfRateLimited(
+        record->name, "Record processing failed: Unknown error.");
     recGblSetSevr(record, getProcessErrorAlarmStatus<RecordType>(), INVALID_ALARM);
     return -1;
   }
@@ -183,6 +262,12 @@ long processRecord(void *recordAsVoid) {
  */
 typedef long (*DEVSUPFUN_GET_IOINT_INFO)(int, void *, ::IOSCANPVT *);
 
+/**
+ * Type alias for the report functions. Like the get_ioint_info functions, these
+ * functions have a different signature than the other functions.
+ */
+typedef long (*DEVSUPFUN_REPORT)(int);
+
 /**
  * Helper template structure for getting a pointer to the getInterruptInfo
  * function. This function can only be compiled for certain records (those for
@@ -217,7 +302,7 @@ struct GetInterruptInfoFunc<RecordType, true> {
  */
 typedef struct {
   long numberOfFunctionPointers;
-  DEVSUPFUN report;
+  DEVSUPFUN_REPORT report;
   DEVSUPFUN init;
   DEVSUPFUN init_record;
   DEVSUPFUN_GET_IOINT_INFO get_ioint_info;
@@ -226,7 +311,7 @@ typedef struct {
 
 template<typename RecordType>
 constexpr DeviceSupportStruct deviceSupportStruct() {
-  return {5, nullptr, nullptr, initRecord<RecordType>,
+  return {5, reportRecordType<RecordType>, nullptr, initRecord<RecordType>,
       GetInterruptInfoFunc<RecordType>()(), processRecord<RecordType>};
 }
 
@@ -253,14 +338,14 @@ epicsExportAddress(dset, devAaoChimeraTK);
  */
 struct {
   long numberOfFunctionPointers;
-  DEVSUPFUN report;
+  DEVSUPFUN_REPORT report;
   DEVSUPFUN init;
   DEVSUPFUN init_record;
   DEVSUPFUN_GET_IOINT_INFO get_ioint_info;
   DEVSUPFUN read;
   DEVSUPFUN special_linconv;
-} devAiChimeraTK = {6, nullptr, nullptr, initRecord<::aiRecord>,
-    getInterruptInfo<::aiRecord>, processRecord<::aiRecord>, nullptr};
+} devAiChimeraTK = {6, reportRecordType<::aiRecord>, nullptr,
+    initRecord<::aiRecord>, getInterruptInfo<::aiRecord>, processRecord<::aiRecord>, nullptr};
 epicsExportAddress(dset, devAiChimeraTK);
 
 /**
@@ -270,14 +355,14 @@ epicsExportAddress(dset, devAiChimeraTK);
  */
 struct {
   long numberOfFunctionPointers;
-  DEVSUPFUN report;
+  DEVSUPFUN_REPORT report;
   DEVSUPFUN init;
   DEVSUPFUN init_record;
   DEVSUPFUN_GET_IOINT_INFO get_ioint_info;
   DEVSUPFUN write;
   DEVSUPFUN special_linconv;
-} devAoChimeraTK = {6, nullptr, nullptr, initRecord<::aoRecord>, nullptr,
-    processRecord<::aoRecord>, nullptr};
+} devAoChimeraTK = {6, reportRecordType<::aoRecord>, nullptr,
+    initRecord<::aoRecord>, nullptr, processRecord<::aoRecord>, nullptr};
 epicsExportAddress(dset, devAoChimeraTK);
 
 /**
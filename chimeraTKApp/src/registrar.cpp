@@ -17,11 +17,24 @@
  * <http://www.gnu.org/licenses/>.
  */
 
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
 #include <ChimeraTK/ControlSystemAdapter/ApplicationBase.h>
 #include <ChimeraTK/ControlSystemAdapter/PVManager.h>
 #include <ChimeraTK/Utilities.h>
 
+#include "ChimeraTK/EPICS/ControlSystemAdapterPVProvider.h"
 #include "ChimeraTK/EPICS/PVProviderRegistry.h"
+#include "ChimeraTK/EPICS/ParallelCopyEngine.h"
+#include "ChimeraTK/EPICS/RecordBufferAllocator.h"
+#include "ChimeraTK/EPICS/RecordLinkPreResolver.h"
+#include "ChimeraTK/EPICS/ThreadSettings.h"
 #include "ChimeraTK/EPICS/errorPrint.h"
 
 extern "C" {
@@ -33,8 +46,96 @@ extern "C" {
 using namespace ChimeraTK;
 using namespace ChimeraTK::EPICS;
 
+namespace {
+
+  /**
+   * Converts the name of a notification priority ("high", "normal", or "low")
+   * to the respective value. Returns false if the name is not valid.
+   */
+  bool parseNotificationPriority(char const *name,
+      ControlSystemAdapterPVProvider::NotificationPriority &priority) {
+    if (!name) {
+      return false;
+    } else if (!std::strcmp(name, "high")) {
+      priority = ControlSystemAdapterPVProvider::NotificationPriority::high;
+    } else if (!std::strcmp(name, "normal")) {
+      priority = ControlSystemAdapterPVProvider::NotificationPriority::normal;
+    } else if (!std::strcmp(name, "low")) {
+      priority = ControlSystemAdapterPVProvider::NotificationPriority::low;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Returns the PV provider for the application with the specified name.
+   * Throws an exception if there is no such application.
+   */
+  ControlSystemAdapterPVProvider::SharedPtr getApplicationPVProvider(
+      std::string const &appName) {
+    auto pvProvider =
+      std::dynamic_pointer_cast<ControlSystemAdapterPVProvider>(
+        PVProviderRegistry::getPVProvider(appName));
+    if (!pvProvider) {
+      throw std::invalid_argument(
+        std::string("The name '") + appName
+          + "' does not reference a registered application.");
+    }
+    return pvProvider;
+  }
+
+} // anonymous namespace
+
 extern "C" {
 
+  // Data structures needed for the iocsh chimeraTKAddSharedMemoryMirrorPV
+  // function.
+  static const iocshArg iocshChimeraTKAddSharedMemoryMirrorPVArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKAddSharedMemoryMirrorPVArg1 = {
+      "process variable name", iocshArgString };
+  static const iocshArg * const iocshChimeraTKAddSharedMemoryMirrorPVArgs[] = {
+      &iocshChimeraTKAddSharedMemoryMirrorPVArg0,
+      &iocshChimeraTKAddSharedMemoryMirrorPVArg1 };
+  static const iocshFuncDef iocshChimeraTKAddSharedMemoryMirrorPVFuncDef = {
+      "chimeraTKAddSharedMemoryMirrorPV", 2,
+      iocshChimeraTKAddSharedMemoryMirrorPVArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKAddSharedMemoryMirrorPV function.
+   *
+   * This function adds a process variable of an application to the
+   * shared-memory mirror of that application.
+   */
+  static void iocshChimeraTKAddSharedMemoryMirrorPVFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    char *pvName = args[1].sval;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not add the process variable to the shared-memory mirror: Application name must be specified.");
+      return;
+    }
+    if (!pvName || !std::strlen(pvName)) {
+      errorPrintf(
+        "Could not add the process variable to the shared-memory mirror: Process variable name must be specified.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->addSharedMemoryMirrorPV(pvName);
+    } catch (std::exception &e) {
+      errorPrintf(
+        "Could not add the process variable to the shared-memory mirror: %s",
+        e.what());
+      return;
+    } catch (...) {
+      errorPrintf(
+        "Could not add the process variable to the shared-memory mirror: Unknown error.");
+      return;
+    }
+  }
+
   // Data structures needed for the iocsh chimeraTKConfigureApplication
   // function.
   static const iocshArg iocshChimeraTKConfigureApplicationArg0 = {
@@ -63,6 +164,38 @@ extern "C" {
     }
   }
 
+  // Init hook that resolves the links of all records before the records are
+  // initialized and discards the resolved links that have not been used after
+  // the records have been initialized. This hook is registered by the
+  // chimeraTKControlSystemAdapterRegistrar function.
+  static void preResolveRecordLinksInitHook(::initHookState state) noexcept {
+    if (state != initHookAfterInitDevSup
+        && state != initHookAfterInitDatabase) {
+      return;
+    }
+    try {
+      if (state == initHookAfterInitDevSup) {
+        RecordLinkPreResolver::preResolve();
+        return;
+      }
+    } catch (std::exception &e) {
+      errorPrintf("Could not resolve the record links: %s", e.what());
+    } catch (...) {
+      errorPrintf("Could not resolve the record links: Unknown error.");
+    }
+    // After the records have been initialized or when resolving the links in
+    // advance failed, we discard the resolved links. In the latter case, the
+    // records resolve their links themselves.
+    try {
+      RecordLinkPreResolver::clear();
+    } catch (std::exception &e) {
+      errorPrintf("Could not discard the resolved record links: %s", e.what());
+    } catch (...) {
+      errorPrintf(
+        "Could not discard the resolved record links: Unknown error.");
+    }
+  }
+
   /**
    * Implementation of the iocsh chimeraTKConfigureApplication function.
    *
@@ -238,6 +371,288 @@ extern "C" {
     }
   }
 
+  // Data structures needed for the iocsh chimeraTKReport function.
+  static const iocshArg iocshChimeraTKReportArg0 = {
+      "level", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKReportArgs[] = {
+      &iocshChimeraTKReportArg0 };
+  static const iocshFuncDef iocshChimeraTKReportFuncDef = {
+      "chimeraTKReport", 1, iocshChimeraTKReportArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKReport function.
+   *
+   * This function prints information about the state of all registered
+   * applications and devices. The higher the level, the more details are
+   * printed.
+   */
+  static void iocshChimeraTKReportFunc(const iocshArgBuf *args) noexcept {
+    int level = args[0].ival;
+    try {
+      PVProviderRegistry::report(level);
+    } catch (std::exception &e) {
+      errorPrintf("Could not print the report: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not print the report: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKDumpFlightRecorders
+  // function.
+  static const iocshArg iocshChimeraTKDumpFlightRecordersArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKDumpFlightRecordersArg1 = {
+      "file name", iocshArgString };
+  static const iocshArg * const iocshChimeraTKDumpFlightRecordersArgs[] = {
+      &iocshChimeraTKDumpFlightRecordersArg0,
+      &iocshChimeraTKDumpFlightRecordersArg1 };
+  static const iocshFuncDef iocshChimeraTKDumpFlightRecordersFuncDef = {
+      "chimeraTKDumpFlightRecorders", 2,
+      iocshChimeraTKDumpFlightRecordersArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKDumpFlightRecorders function.
+   *
+   * This function writes the contents of all flight recorders of an
+   * application to a binary file.
+   */
+  static void iocshChimeraTKDumpFlightRecordersFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    char *fileName = args[1].sval;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not dump the flight recorders: Application name must be specified.");
+      return;
+    }
+    if (!fileName || !std::strlen(fileName)) {
+      errorPrintf(
+        "Could not dump the flight recorders: File name must be specified.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->dumpFlightRecorders(fileName);
+    } catch (std::exception &e) {
+      errorPrintf("Could not dump the flight recorders: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not dump the flight recorders: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKEnableFlightRecorder
+  // function.
+  static const iocshArg iocshChimeraTKEnableFlightRecorderArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKEnableFlightRecorderArg1 = {
+      "process variable name", iocshArgString };
+  static const iocshArg iocshChimeraTKEnableFlightRecorderArg2 = {
+      "depth", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKEnableFlightRecorderArgs[] = {
+      &iocshChimeraTKEnableFlightRecorderArg0,
+      &iocshChimeraTKEnableFlightRecorderArg1,
+      &iocshChimeraTKEnableFlightRecorderArg2 };
+  static const iocshFuncDef iocshChimeraTKEnableFlightRecorderFuncDef = {
+      "chimeraTKEnableFlightRecorder", 3,
+      iocshChimeraTKEnableFlightRecorderArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKEnableFlightRecorder function.
+   *
+   * This function enables the flight recorder for a process variable of an
+   * application. The flight recorder keeps the specified number of values
+   * that have been received last.
+   */
+  static void iocshChimeraTKEnableFlightRecorderFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    char *pvName = args[1].sval;
+    int depth = args[2].ival;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not enable the flight recorder: Application name must be specified.");
+      return;
+    }
+    if (!pvName || !std::strlen(pvName)) {
+      errorPrintf(
+        "Could not enable the flight recorder: Process variable name must be specified.");
+      return;
+    }
+    if (depth <= 0) {
+      errorPrintf(
+        "Could not enable the flight recorder: The depth must be greater than zero.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->enableFlightRecorder(pvName, depth);
+    } catch (std::exception &e) {
+      errorPrintf("Could not enable the flight recorder: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not enable the flight recorder: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKFreezeFlightRecorders
+  // function.
+  static const iocshArg iocshChimeraTKFreezeFlightRecordersArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKFreezeFlightRecordersArg1 = {
+      "freeze", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKFreezeFlightRecordersArgs[] = {
+      &iocshChimeraTKFreezeFlightRecordersArg0,
+      &iocshChimeraTKFreezeFlightRecordersArg1 };
+  static const iocshFuncDef iocshChimeraTKFreezeFlightRecordersFuncDef = {
+      "chimeraTKFreezeFlightRecorders", 2,
+      iocshChimeraTKFreezeFlightRecordersArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKFreezeFlightRecorders function.
+   *
+   * This function freezes (if the second argument is not zero) or unfreezes
+   * (if it is zero) all flight recorders of an application.
+   */
+  static void iocshChimeraTKFreezeFlightRecordersFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    bool freeze = args[1].ival != 0;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not freeze the flight recorders: Application name must be specified.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->setFlightRecordersFrozen(freeze);
+    } catch (std::exception &e) {
+      errorPrintf("Could not freeze the flight recorders: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not freeze the flight recorders: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKLoadNotificationPriorities
+  // function.
+  static const iocshArg iocshChimeraTKLoadNotificationPrioritiesArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKLoadNotificationPrioritiesArg1 = {
+      "file name", iocshArgString };
+  static const iocshArg * const iocshChimeraTKLoadNotificationPrioritiesArgs[] = {
+      &iocshChimeraTKLoadNotificationPrioritiesArg0,
+      &iocshChimeraTKLoadNotificationPrioritiesArg1 };
+  static const iocshFuncDef iocshChimeraTKLoadNotificationPrioritiesFuncDef = {
+      "chimeraTKLoadNotificationPriorities", 2,
+      iocshChimeraTKLoadNotificationPrioritiesArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKLoadNotificationPriorities function.
+   *
+   * This function reads a table of notification priorities from a file and
+   * applies it to the process variables of an application. Each line of the
+   * file contains the name of a process variable and its priority, separated
+   * by white space. Empty lines and lines starting with "#" are ignored.
+   * Invalid lines are reported, but do not stop the processing of the
+   * remaining lines.
+   */
+  static void iocshChimeraTKLoadNotificationPrioritiesFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    char *fileName = args[1].sval;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not load the notification priorities: Application name must be specified.");
+      return;
+    }
+    if (!fileName || !std::strlen(fileName)) {
+      errorPrintf(
+        "Could not load the notification priorities: File name must be specified.");
+      return;
+    }
+    try {
+      auto pvProvider = getApplicationPVProvider(appName);
+      std::ifstream file(fileName);
+      if (!file) {
+        errorPrintf(
+          "Could not load the notification priorities: The file '%s' could not be opened.",
+          fileName);
+        return;
+      }
+      std::string line;
+      std::size_t lineNumber = 0;
+      while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream lineStream(line);
+        std::string pvName, priorityString, extra;
+        if (!(lineStream >> pvName) || pvName[0] == '#') {
+          continue;
+        }
+        ControlSystemAdapterPVProvider::NotificationPriority priority;
+        if (!(lineStream >> priorityString) || (lineStream >> extra)
+            || !parseNotificationPriority(priorityString.c_str(), priority)) {
+          errorPrintf(
+            "Invalid line %zu in '%s': Expected a process variable name followed by \"high\", \"normal\", or \"low\".",
+            lineNumber, fileName);
+          continue;
+        }
+        try {
+          pvProvider->setNotificationPriority(pvName, priority);
+        } catch (std::exception &e) {
+          errorPrintf("Invalid line %zu in '%s': %s", lineNumber, fileName,
+            e.what());
+        }
+      }
+    } catch (std::exception &e) {
+      errorPrintf("Could not load the notification priorities: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf(
+        "Could not load the notification priorities: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKMemoryReport function.
+  static const iocshArg iocshChimeraTKMemoryReportArg0 = {
+      "number of process variables", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKMemoryReportArgs[] = {
+      &iocshChimeraTKMemoryReportArg0 };
+  static const iocshFuncDef iocshChimeraTKMemoryReportFuncDef = {
+      "chimeraTKMemoryReport", 1, iocshChimeraTKMemoryReportArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKMemoryReport function.
+   *
+   * This function prints the memory used by all registered applications and
+   * devices and lists the process variables that use the most memory. If the
+   * number of process variables is zero (or not specified), ten process
+   * variables are listed.
+   */
+  static void iocshChimeraTKMemoryReportFunc(const iocshArgBuf *args) noexcept {
+    int maxProcessVariables = args[0].ival;
+    if (maxProcessVariables < 0) {
+      errorPrintf(
+        "Could not print the memory report: The number of process variables must not be negative.");
+      return;
+    }
+    if (maxProcessVariables == 0) {
+      maxProcessVariables = 10;
+    }
+    try {
+      PVProviderRegistry::memoryReport(maxProcessVariables);
+    } catch (std::exception &e) {
+      errorPrintf("Could not print the memory report: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not print the memory report: Unknown error.");
+      return;
+    }
+  }
+
   // Data structures needed for the iocsh chimeraTKSetDMapFilePath function.
   static const iocshArg iocshChimeraTKSetDMapFilePathArg0 = {
       "file path", iocshArgString };
@@ -276,16 +691,683 @@ extern "C" {
     }
   }
 
+  // Data structures needed for the iocsh chimeraTKSetErrorSuppressionInterval
+  // function.
+  static const iocshArg iocshChimeraTKSetErrorSuppressionIntervalArg0 = {
+      "interval in milliseconds", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetErrorSuppressionIntervalArgs[] = {
+      &iocshChimeraTKSetErrorSuppressionIntervalArg0 };
+  static const iocshFuncDef iocshChimeraTKSetErrorSuppressionIntervalFuncDef = {
+      "chimeraTKSetErrorSuppressionInterval", 1,
+      iocshChimeraTKSetErrorSuppressionIntervalArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetErrorSuppressionInterval function.
+   *
+   * This function sets the interval in which an error message that is
+   * repeatedly generated for the same record is only printed once. An interval
+   * of zero means that repeated messages are never suppressed.
+   */
+  static void iocshChimeraTKSetErrorSuppressionIntervalFunc(const iocshArgBuf *args) noexcept {
+    int interval = args[0].ival;
+    if (interval < 0) {
+      errorPrintf(
+        "Could not set the error suppression interval: The interval must not be negative.");
+      return;
+    }
+    setErrorPrintSuppressionInterval(std::chrono::milliseconds(interval));
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetFlightRecorderTrigger
+  // function.
+  static const iocshArg iocshChimeraTKSetFlightRecorderTriggerArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetFlightRecorderTriggerArg1 = {
+      "process variable name", iocshArgString };
+  static const iocshArg * const iocshChimeraTKSetFlightRecorderTriggerArgs[] = {
+      &iocshChimeraTKSetFlightRecorderTriggerArg0,
+      &iocshChimeraTKSetFlightRecorderTriggerArg1 };
+  static const iocshFuncDef iocshChimeraTKSetFlightRecorderTriggerFuncDef = {
+      "chimeraTKSetFlightRecorderTrigger", 2,
+      iocshChimeraTKSetFlightRecorderTriggerArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetFlightRecorderTrigger function.
+   *
+   * This function makes a process variable of an application a trigger that
+   * freezes all flight recorders of the application when it receives a value
+   * that is not zero.
+   */
+  static void iocshChimeraTKSetFlightRecorderTriggerFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    char *pvName = args[1].sval;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not set the flight recorder trigger: Application name must be specified.");
+      return;
+    }
+    if (!pvName || !std::strlen(pvName)) {
+      errorPrintf(
+        "Could not set the flight recorder trigger: Process variable name must be specified.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->setFlightRecorderTrigger(pvName);
+    } catch (std::exception &e) {
+      errorPrintf("Could not set the flight recorder trigger: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not set the flight recorder trigger: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh
+  // chimeraTKSetInitialNotificationBatching function.
+  static const iocshArg iocshChimeraTKSetInitialNotificationBatchingArg0 = {
+      "batch size", iocshArgInt };
+  static const iocshArg iocshChimeraTKSetInitialNotificationBatchingArg1 = {
+      "batch interval in milliseconds", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetInitialNotificationBatchingArgs[] = {
+      &iocshChimeraTKSetInitialNotificationBatchingArg0,
+      &iocshChimeraTKSetInitialNotificationBatchingArg1 };
+  static const iocshFuncDef iocshChimeraTKSetInitialNotificationBatchingFuncDef = {
+      "chimeraTKSetInitialNotificationBatching", 2,
+      iocshChimeraTKSetInitialNotificationBatchingArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetInitialNotificationBatching
+   * function.
+   *
+   * This function sets the max. number of process variables for which initial
+   * notifications are delivered in a single batch and the min. time between
+   * two batches. A batch size of zero means that the batch size is unlimited.
+   */
+  static void iocshChimeraTKSetInitialNotificationBatchingFunc(const iocshArgBuf *args) noexcept {
+    int batchSize = args[0].ival;
+    int batchInterval = args[1].ival;
+    if (batchSize < 0) {
+      errorPrintf(
+        "Could not set the initial notification batching: The batch size must not be negative.");
+      return;
+    }
+    if (batchInterval < 0) {
+      errorPrintf(
+        "Could not set the initial notification batching: The batch interval must not be negative.");
+      return;
+    }
+    try {
+      ControlSystemAdapterPVProvider::setInitialNotificationBatching(
+        batchSize, std::chrono::milliseconds(batchInterval));
+    } catch (std::exception &e) {
+      errorPrintf(
+        "Could not set the initial notification batching: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf(
+        "Could not set the initial notification batching: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh
+  // chimeraTKSetLastValueReleaseThreshold function.
+  static const iocshArg iocshChimeraTKSetLastValueReleaseThresholdArg0 = {
+      "threshold in bytes", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetLastValueReleaseThresholdArgs[] = {
+      &iocshChimeraTKSetLastValueReleaseThresholdArg0 };
+  static const iocshFuncDef iocshChimeraTKSetLastValueReleaseThresholdFuncDef = {
+      "chimeraTKSetLastValueReleaseThreshold", 1,
+      iocshChimeraTKSetLastValueReleaseThresholdArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetLastValueReleaseThreshold
+   * function.
+   *
+   * This function sets the min. size of a value for which the last value of a
+   * process variable is released when it is not needed. A threshold of zero
+   * means that the last value is never released.
+   */
+  static void iocshChimeraTKSetLastValueReleaseThresholdFunc(const iocshArgBuf *args) noexcept {
+    int threshold = args[0].ival;
+    if (threshold < 0) {
+      errorPrintf(
+        "Could not set the last value release threshold: The threshold must not be negative.");
+      return;
+    }
+    ControlSystemAdapterPVProvider::setLastValueReleaseThreshold(threshold);
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetNotificationBusyPoll
+  // function.
+  static const iocshArg iocshChimeraTKSetNotificationBusyPollArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetNotificationBusyPollArg1 = {
+      "enabled", iocshArgInt };
+  static const iocshArg iocshChimeraTKSetNotificationBusyPollArg2 = {
+      "spin count", iocshArgInt };
+  static const iocshArg iocshChimeraTKSetNotificationBusyPollArg3 = {
+      "max. backoff in microseconds", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetNotificationBusyPollArgs[] = {
+      &iocshChimeraTKSetNotificationBusyPollArg0,
+      &iocshChimeraTKSetNotificationBusyPollArg1,
+      &iocshChimeraTKSetNotificationBusyPollArg2,
+      &iocshChimeraTKSetNotificationBusyPollArg3 };
+  static const iocshFuncDef iocshChimeraTKSetNotificationBusyPollFuncDef = {
+      "chimeraTKSetNotificationBusyPoll", 4,
+      iocshChimeraTKSetNotificationBusyPollArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetNotificationBusyPoll function.
+   *
+   * This function enables or disables busy polling in the high-priority
+   * notification thread of an application and sets the number of unsuccessful
+   * checks after which the thread starts backing off and the max. backoff
+   * time.
+   */
+  static void iocshChimeraTKSetNotificationBusyPollFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    int enabled = args[1].ival;
+    int spinCount = args[2].ival;
+    int maxBackoff = args[3].ival;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not set the notification busy-poll parameters: Application name must be specified.");
+      return;
+    }
+    if (spinCount < 0) {
+      errorPrintf(
+        "Could not set the notification busy-poll parameters: The spin count must not be negative.");
+      return;
+    }
+    if (maxBackoff < 0) {
+      errorPrintf(
+        "Could not set the notification busy-poll parameters: The max. backoff must not be negative.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->setNotificationBusyPoll(
+        enabled != 0, static_cast<std::size_t>(spinCount),
+        std::chrono::microseconds(maxBackoff));
+    } catch (std::exception &e) {
+      errorPrintf(
+        "Could not set the notification busy-poll parameters: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf(
+        "Could not set the notification busy-poll parameters: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetNotificationPriority
+  // function.
+  static const iocshArg iocshChimeraTKSetNotificationPriorityArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetNotificationPriorityArg1 = {
+      "process variable name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetNotificationPriorityArg2 = {
+      "priority", iocshArgString };
+  static const iocshArg * const iocshChimeraTKSetNotificationPriorityArgs[] = {
+      &iocshChimeraTKSetNotificationPriorityArg0,
+      &iocshChimeraTKSetNotificationPriorityArg1,
+      &iocshChimeraTKSetNotificationPriorityArg2 };
+  static const iocshFuncDef iocshChimeraTKSetNotificationPriorityFuncDef = {
+      "chimeraTKSetNotificationPriority", 3,
+      iocshChimeraTKSetNotificationPriorityArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetNotificationPriority function.
+   *
+   * This function sets the priority with which notifications for a process
+   * variable of an application are delivered. The priority must be "high",
+   * "normal", or "low".
+   */
+  static void iocshChimeraTKSetNotificationPriorityFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    char *pvName = args[1].sval;
+    char *priorityString = args[2].sval;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not set the notification priority: Application name must be specified.");
+      return;
+    }
+    if (!pvName || !std::strlen(pvName)) {
+      errorPrintf(
+        "Could not set the notification priority: Process variable name must be specified.");
+      return;
+    }
+    ControlSystemAdapterPVProvider::NotificationPriority priority;
+    if (!parseNotificationPriority(priorityString, priority)) {
+      errorPrintf(
+        "Could not set the notification priority: Priority must be \"high\", \"normal\", or \"low\".");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->setNotificationPriority(
+        pvName, priority);
+    } catch (std::exception &e) {
+      errorPrintf("Could not set the notification priority: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not set the notification priority: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetNotificationWatchdog
+  // function.
+  static const iocshArg iocshChimeraTKSetNotificationWatchdogArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetNotificationWatchdogArg1 = {
+      "timeout in milliseconds", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetNotificationWatchdogArgs[] = {
+      &iocshChimeraTKSetNotificationWatchdogArg0,
+      &iocshChimeraTKSetNotificationWatchdogArg1 };
+  static const iocshFuncDef iocshChimeraTKSetNotificationWatchdogFuncDef = {
+      "chimeraTKSetNotificationWatchdog", 2,
+      iocshChimeraTKSetNotificationWatchdogArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetNotificationWatchdog function.
+   *
+   * This function sets the time after which a notification of an application
+   * that has not been finished by a record is reported. A timeout of zero
+   * disables the watchdog.
+   */
+  static void iocshChimeraTKSetNotificationWatchdogFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    int timeout = args[1].ival;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not set the notification watchdog parameters: Application name must be specified.");
+      return;
+    }
+    if (timeout < 0) {
+      errorPrintf(
+        "Could not set the notification watchdog parameters: The timeout must not be negative.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->setNotificationWatchdog(
+        std::chrono::milliseconds(timeout));
+    } catch (std::exception &e) {
+      errorPrintf(
+        "Could not set the notification watchdog parameters: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf(
+        "Could not set the notification watchdog parameters: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetOverloadGovernor
+  // function.
+  static const iocshArg iocshChimeraTKSetOverloadGovernorArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetOverloadGovernorArg1 = {
+      "backlog threshold", iocshArgInt };
+  static const iocshArg iocshChimeraTKSetOverloadGovernorArg2 = {
+      "latency threshold in milliseconds", iocshArgInt };
+  static const iocshArg iocshChimeraTKSetOverloadGovernorArg3 = {
+      "restore delay in milliseconds", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetOverloadGovernorArgs[] = {
+      &iocshChimeraTKSetOverloadGovernorArg0,
+      &iocshChimeraTKSetOverloadGovernorArg1,
+      &iocshChimeraTKSetOverloadGovernorArg2,
+      &iocshChimeraTKSetOverloadGovernorArg3 };
+  static const iocshFuncDef iocshChimeraTKSetOverloadGovernorFuncDef = {
+      "chimeraTKSetOverloadGovernor", 4,
+      iocshChimeraTKSetOverloadGovernorArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetOverloadGovernor function.
+   *
+   * This function sets the number of process variables with pending
+   * notifications and the delivery latency above which notification delivery
+   * of an application is considered overloaded and the time for which the load
+   * has to stay below these thresholds before the overload mode is left. A
+   * threshold of zero disables the respective check.
+   */
+  static void iocshChimeraTKSetOverloadGovernorFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    int backlogThreshold = args[1].ival;
+    int latencyThreshold = args[2].ival;
+    int restoreDelay = args[3].ival;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not set the overload governor parameters: Application name must be specified.");
+      return;
+    }
+    if (backlogThreshold < 0) {
+      errorPrintf(
+        "Could not set the overload governor parameters: The backlog threshold must not be negative.");
+      return;
+    }
+    if (latencyThreshold < 0) {
+      errorPrintf(
+        "Could not set the overload governor parameters: The latency threshold must not be negative.");
+      return;
+    }
+    if (restoreDelay < 0) {
+      errorPrintf(
+        "Could not set the overload governor parameters: The restore delay must not be negative.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->setOverloadGovernor(
+        backlogThreshold, std::chrono::milliseconds(latencyThreshold),
+        std::chrono::milliseconds(restoreDelay));
+    } catch (std::exception &e) {
+      errorPrintf(
+        "Could not set the overload governor parameters: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf(
+        "Could not set the overload governor parameters: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetParallelCopy function.
+  static const iocshArg iocshChimeraTKSetParallelCopyArg0 = {
+      "number of helper threads", iocshArgInt };
+  static const iocshArg iocshChimeraTKSetParallelCopyArg1 = {
+      "threshold in bytes", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetParallelCopyArgs[] = {
+      &iocshChimeraTKSetParallelCopyArg0,
+      &iocshChimeraTKSetParallelCopyArg1 };
+  static const iocshFuncDef iocshChimeraTKSetParallelCopyFuncDef = {
+      "chimeraTKSetParallelCopy", 2, iocshChimeraTKSetParallelCopyArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetParallelCopy function.
+   *
+   * This function sets the number of helper threads that are used for copying
+   * the values of large array records and the min. size of a value for which
+   * these threads are used. Zero helper threads disable parallel copying.
+   */
+  static void iocshChimeraTKSetParallelCopyFunc(const iocshArgBuf *args) noexcept {
+    int numberOfThreads = args[0].ival;
+    int threshold = args[1].ival;
+    if (numberOfThreads < 0) {
+      errorPrintf(
+        "Could not set the parallel copy parameters: The number of helper threads must not be negative.");
+      return;
+    }
+    if (threshold < 0) {
+      errorPrintf(
+        "Could not set the parallel copy parameters: The threshold must not be negative.");
+      return;
+    }
+    try {
+      ParallelCopyEngine::configure(static_cast<std::size_t>(numberOfThreads),
+        static_cast<std::size_t>(threshold));
+    } catch (std::exception &e) {
+      errorPrintf("Could not set the parallel copy parameters: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not set the parallel copy parameters: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetPreResolveThreads
+  // function.
+  static const iocshArg iocshChimeraTKSetPreResolveThreadsArg0 = {
+      "number of threads", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetPreResolveThreadsArgs[] = {
+      &iocshChimeraTKSetPreResolveThreadsArg0 };
+  static const iocshFuncDef iocshChimeraTKSetPreResolveThreadsFuncDef = {
+      "chimeraTKSetPreResolveThreads", 1,
+      iocshChimeraTKSetPreResolveThreadsArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetPreResolveThreads function.
+   *
+   * This function sets the number of threads that are used for resolving the
+   * links of all records before they are initialized. Setting the number of
+   * threads to zero disables resolving the links in advance.
+   */
+  static void iocshChimeraTKSetPreResolveThreadsFunc(const iocshArgBuf *args) noexcept {
+    int numberOfThreads = args[0].ival;
+    if (numberOfThreads < 0) {
+      errorPrintf(
+        "Could not set the number of threads: The number of threads must not be negative.");
+      return;
+    }
+    RecordLinkPreResolver::setNumberOfThreads(numberOfThreads);
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetRecordBufferAllocation
+  // function.
+  static const iocshArg iocshChimeraTKSetRecordBufferAllocationArg0 = {
+      "huge page threshold in bytes", iocshArgInt };
+  static const iocshArg iocshChimeraTKSetRecordBufferAllocationArg1 = {
+      "huge page mode", iocshArgString };
+  static const iocshArg iocshChimeraTKSetRecordBufferAllocationArg2 = {
+      "prefault", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetRecordBufferAllocationArgs[] = {
+      &iocshChimeraTKSetRecordBufferAllocationArg0,
+      &iocshChimeraTKSetRecordBufferAllocationArg1,
+      &iocshChimeraTKSetRecordBufferAllocationArg2 };
+  static const iocshFuncDef iocshChimeraTKSetRecordBufferAllocationFuncDef = {
+      "chimeraTKSetRecordBufferAllocation", 3,
+      iocshChimeraTKSetRecordBufferAllocationArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetRecordBufferAllocation function.
+   *
+   * This function sets the min. size of a record buffer that is backed by
+   * huge pages, the way in which huge pages are used ("none", "transparent",
+   * or "hugetlb"), and whether buffers mapped from the huge page pool are
+   * populated when they are allocated.
+   */
+  static void iocshChimeraTKSetRecordBufferAllocationFunc(const iocshArgBuf *args) noexcept {
+    int threshold = args[0].ival;
+    char *modeString = args[1].sval;
+    int prefault = args[2].ival;
+    // Verify and convert the parameters.
+    if (threshold < 0) {
+      errorPrintf(
+        "Could not set the record buffer allocation parameters: The threshold must not be negative.");
+      return;
+    }
+    RecordBufferAllocator::HugePageMode mode;
+    if (!modeString || !std::strcmp(modeString, "none")) {
+      mode = RecordBufferAllocator::HugePageMode::none;
+    } else if (!std::strcmp(modeString, "transparent")) {
+      mode = RecordBufferAllocator::HugePageMode::transparent;
+    } else if (!std::strcmp(modeString, "hugetlb")) {
+      mode = RecordBufferAllocator::HugePageMode::hugetlb;
+    } else {
+      errorPrintf(
+        "Could not set the record buffer allocation parameters: Mode must be \"none\", \"transparent\", or \"hugetlb\".");
+      return;
+    }
+    try {
+      RecordBufferAllocator::setHugePagePolicy(
+        static_cast<std::size_t>(threshold), mode, prefault != 0);
+    } catch (std::exception &e) {
+      errorPrintf(
+        "Could not set the record buffer allocation parameters: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf(
+        "Could not set the record buffer allocation parameters: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetSharedMemoryMirror
+  // function.
+  static const iocshArg iocshChimeraTKSetSharedMemoryMirrorArg0 = {
+      "application name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetSharedMemoryMirrorArg1 = {
+      "segment name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetSharedMemoryMirrorArg2 = {
+      "index file name", iocshArgString };
+  static const iocshArg * const iocshChimeraTKSetSharedMemoryMirrorArgs[] = {
+      &iocshChimeraTKSetSharedMemoryMirrorArg0,
+      &iocshChimeraTKSetSharedMemoryMirrorArg1,
+      &iocshChimeraTKSetSharedMemoryMirrorArg2 };
+  static const iocshFuncDef iocshChimeraTKSetSharedMemoryMirrorFuncDef = {
+      "chimeraTKSetSharedMemoryMirror", 3,
+      iocshChimeraTKSetSharedMemoryMirrorArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetSharedMemoryMirror function.
+   *
+   * This function sets the POSIX shared-memory segment and the index file that
+   * are used for the shared-memory mirror of an application.
+   */
+  static void iocshChimeraTKSetSharedMemoryMirrorFunc(const iocshArgBuf *args) noexcept {
+    char *appName = args[0].sval;
+    char *segmentName = args[1].sval;
+    char *indexFileName = args[2].sval;
+    // Verify and convert the parameters.
+    if (!appName || !std::strlen(appName)) {
+      errorPrintf(
+        "Could not set the shared-memory mirror: Application name must be specified.");
+      return;
+    }
+    if (!segmentName || !std::strlen(segmentName)) {
+      errorPrintf(
+        "Could not set the shared-memory mirror: Segment name must be specified.");
+      return;
+    }
+    if (!indexFileName || !std::strlen(indexFileName)) {
+      errorPrintf(
+        "Could not set the shared-memory mirror: Index file name must be specified.");
+      return;
+    }
+    try {
+      getApplicationPVProvider(appName)->setSharedMemoryMirror(
+        segmentName, indexFileName);
+    } catch (std::exception &e) {
+      errorPrintf("Could not set the shared-memory mirror: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not set the shared-memory mirror: Unknown error.");
+      return;
+    }
+  }
+
+  // Data structures needed for the iocsh chimeraTKSetThreadSettings function.
+  static const iocshArg iocshChimeraTKSetThreadSettingsArg0 = {
+      "provider name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetThreadSettingsArg1 = {
+      "thread class", iocshArgString };
+  static const iocshArg iocshChimeraTKSetThreadSettingsArg2 = {
+      "thread name", iocshArgString };
+  static const iocshArg iocshChimeraTKSetThreadSettingsArg3 = {
+      "CPU list", iocshArgString };
+  static const iocshArg iocshChimeraTKSetThreadSettingsArg4 = {
+      "real-time priority", iocshArgInt };
+  static const iocshArg * const iocshChimeraTKSetThreadSettingsArgs[] = {
+      &iocshChimeraTKSetThreadSettingsArg0,
+      &iocshChimeraTKSetThreadSettingsArg1,
+      &iocshChimeraTKSetThreadSettingsArg2,
+      &iocshChimeraTKSetThreadSettingsArg3,
+      &iocshChimeraTKSetThreadSettingsArg4 };
+  static const iocshFuncDef iocshChimeraTKSetThreadSettingsFuncDef = {
+      "chimeraTKSetThreadSettings", 5, iocshChimeraTKSetThreadSettingsArgs };
+
+  /**
+   * Implementation of the iocsh chimeraTKSetThreadSettings function.
+   *
+   * This function sets the name, the CPU affinity, and the real-time priority
+   * for a class of threads ("notification", "highPriorityNotification", "io",
+   * "copy", "errorPrint", or "timer") of an application or device. The
+   * settings are applied when the threads are started, so this function has to
+   * be called before the application or device is configured. The copy,
+   * error-print, and timer threads are shared by all applications and devices,
+   * so the provider name must be empty for them.
+   */
+  static void iocshChimeraTKSetThreadSettingsFunc(const iocshArgBuf *args) noexcept {
+    char *providerName = args[0].sval;
+    char *threadClass = args[1].sval;
+    char *threadName = args[2].sval;
+    char *cpuList = args[3].sval;
+    int realtimePriority = args[4].ival;
+    // Verify and convert the parameters.
+    if (!threadClass || !std::strlen(threadClass)) {
+      errorPrintf(
+        "Could not set the thread settings: Thread class must be specified.");
+      return;
+    }
+    try {
+      ThreadSettings settings(threadName ? threadName : "");
+      settings.cpus = parseCpuList(cpuList ? cpuList : "");
+      settings.realtimePriority = realtimePriority;
+      setThreadSettings(
+        providerName ? providerName : "", threadClass, settings);
+    } catch (std::exception &e) {
+      errorPrintf("Could not set the thread settings: %s", e.what());
+      return;
+    } catch (...) {
+      errorPrintf("Could not set the thread settings: Unknown error.");
+      return;
+    }
+  }
+
   static void chimeraTKControlSystemAdapterRegistrar() {
+    ::iocshRegister(&iocshChimeraTKAddSharedMemoryMirrorPVFuncDef,
+        iocshChimeraTKAddSharedMemoryMirrorPVFunc);
     ::iocshRegister(&iocshChimeraTKConfigureApplicationFuncDef,
         iocshChimeraTKConfigureApplicationFunc);
+    ::iocshRegister(&iocshChimeraTKDumpFlightRecordersFuncDef,
+        iocshChimeraTKDumpFlightRecordersFunc);
+    ::iocshRegister(&iocshChimeraTKEnableFlightRecorderFuncDef,
+        iocshChimeraTKEnableFlightRecorderFunc);
+    ::iocshRegister(&iocshChimeraTKFreezeFlightRecordersFuncDef,
+        iocshChimeraTKFreezeFlightRecordersFunc);
     ::iocshRegister(&iocshChimeraTKOpenAsyncDeviceFuncDef,
         iocshChimeraTKOpenAsyncDeviceFunc);
     ::iocshRegister(&iocshChimeraTKOpenSyncDeviceFuncDef,
         iocshChimeraTKOpenSyncDeviceFunc);
+    ::iocshRegister(&iocshChimeraTKLoadNotificationPrioritiesFuncDef,
+        iocshChimeraTKLoadNotificationPrioritiesFunc);
+    ::iocshRegister(&iocshChimeraTKMemoryReportFuncDef,
+        iocshChimeraTKMemoryReportFunc);
+    ::iocshRegister(&iocshChimeraTKReportFuncDef,
+        iocshChimeraTKReportFunc);
     ::iocshRegister(&iocshChimeraTKSetDMapFilePathFuncDef,
         iocshChimeraTKSetDMapFilePathFunc);
+    ::iocshRegister(&iocshChimeraTKSetErrorSuppressionIntervalFuncDef,
+        iocshChimeraTKSetErrorSuppressionIntervalFunc);
+    ::iocshRegister(&iocshChimeraTKSetFlightRecorderTriggerFuncDef,
+        iocshChimeraTKSetFlightRecorderTriggerFunc);
+    ::iocshRegister(&iocshChimeraTKSetInitialNotificationBatchingFuncDef,
+        iocshChimeraTKSetInitialNotificationBatchingFunc);
+    ::iocshRegister(&iocshChimeraTKSetLastValueReleaseThresholdFuncDef,
+        iocshChimeraTKSetLastValueReleaseThresholdFunc);
+    ::iocshRegister(&iocshChimeraTKSetNotificationBusyPollFuncDef,
+        iocshChimeraTKSetNotificationBusyPollFunc);
+    ::iocshRegister(&iocshChimeraTKSetNotificationPriorityFuncDef,
+        iocshChimeraTKSetNotificationPriorityFunc);
+    ::iocshRegister(&iocshChimeraTKSetNotificationWatchdogFuncDef,
+        iocshChimeraTKSetNotificationWatchdogFunc);
+    ::iocshRegister(&iocshChimeraTKSetOverloadGovernorFuncDef,
+        iocshChimeraTKSetOverloadGovernorFunc);
+    ::iocshRegister(&iocshChimeraTKSetParallelCopyFuncDef,
+        iocshChimeraTKSetParallelCopyFunc);
+    ::iocshRegister(&iocshChimeraTKSetPreResolveThreadsFuncDef,
+        iocshChimeraTKSetPreResolveThreadsFunc);
+    ::iocshRegister(&iocshChimeraTKSetRecordBufferAllocationFuncDef,
+        iocshChimeraTKSetRecordBufferAllocationFunc);
+    ::iocshRegister(&iocshChimeraTKSetSharedMemoryMirrorFuncDef,
+        iocshChimeraTKSetSharedMemoryMirrorFunc);
+    ::iocshRegister(&iocshChimeraTKSetThreadSettingsFuncDef,
+        iocshChimeraTKSetThreadSettingsFunc);
     ::initHookRegister(finalizePVProvidersInitHook);
+    ::initHookRegister(preResolveRecordLinksInitHook);
   }
 
   epicsExportRegistrar(chimeraTKControlSystemAdapterRegistrar);